@@ -0,0 +1,682 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "blake3.h"
+#include "cpu.h"
+#include "kernel.h"
+
+/// @brief The IV is the SHA-256 one
+static const uint32_t blake3_iv[8] = {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
+/// @brief Order of the message words in each of the 7 rounds
+static const uint8_t blake3_schedule[7][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8},
+    {3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1},
+    {10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6},
+    {12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4},
+    {9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7},
+    {11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13},
+};
+
+/// @brief A round: the G function on the columns, then on the diagonals of the 4x4 state
+#define BLAKE3_ROUND(G, v, m, s) \
+    G(v, 0, 4, 8, 12, m[s[0]], m[s[1]]) G(v, 1, 5, 9, 13, m[s[2]], m[s[3]]) \
+    G(v, 2, 6, 10, 14, m[s[4]], m[s[5]]) G(v, 3, 7, 11, 15, m[s[6]], m[s[7]]) \
+    G(v, 0, 5, 10, 15, m[s[8]], m[s[9]]) G(v, 1, 6, 11, 12, m[s[10]], m[s[11]]) \
+    G(v, 2, 7, 8, 13, m[s[12]], m[s[13]]) G(v, 3, 4, 9, 14, m[s[14]], m[s[15]])
+
+#define BLAKE3_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define BLAKE3_G(v, a, b, c, d, x, y) \
+    v[a] = v[a] + v[b] + (x); v[d] = BLAKE3_ROTR(v[d] ^ v[a], 16); \
+    v[c] = v[c] + v[d];       v[b] = BLAKE3_ROTR(v[b] ^ v[c], 12); \
+    v[a] = v[a] + v[b] + (y); v[d] = BLAKE3_ROTR(v[d] ^ v[a], 8); \
+    v[c] = v[c] + v[d];       v[b] = BLAKE3_ROTR(v[b] ^ v[c], 7);
+
+static inline uint32_t blake3_load32(const uint8_t * bytes) {
+    return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
+
+static inline void blake3_store32(uint8_t * bytes, uint32_t word) {
+    bytes[0] = (uint8_t)word;
+    bytes[1] = (uint8_t)(word >> 8);
+    bytes[2] = (uint8_t)(word >> 16);
+    bytes[3] = (uint8_t)(word >> 24);
+}
+
+static void blake3_store_cv(uint8_t out[BLAKE3_OUT_LEN], const uint32_t cv[8]) {
+    for (size_t i = 0; i < 8; i++)
+        blake3_store32(out + 4 * i, cv[i]);
+}
+
+void blake3_compress_in_place(uint32_t cv[8], const uint8_t block[BLAKE3_BLOCK_LEN], uint8_t block_len, uint64_t counter, uint8_t flags) {
+
+    uint32_t m[16];
+    for (size_t i = 0; i < 16; i++)
+        m[i] = blake3_load32(block + 4 * i);
+
+    uint32_t v[16] = {
+        cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+        blake3_iv[0], blake3_iv[1], blake3_iv[2], blake3_iv[3],
+        (uint32_t)counter, (uint32_t)(counter >> 32), block_len, flags
+    };
+    for (size_t r = 0; r < 7; r++) {
+        const uint8_t * s = blake3_schedule[r];
+        BLAKE3_ROUND(BLAKE3_G, v, m, s)
+    }
+
+    for (size_t i = 0; i < 8; i++)
+        cv[i] = v[i] ^ v[i + 8];
+}
+
+/// @brief Hash the `blocks` blocks of one input into a chaining value
+static void blake3_hash_one(const uint8_t * input, size_t blocks, const uint32_t key[8], uint64_t counter, uint8_t flags,
+                            uint8_t flags_start, uint8_t flags_end, uint8_t out[BLAKE3_OUT_LEN]) {
+    uint32_t cv[8];
+    memcpy(cv, key, sizeof(cv));
+    uint8_t block_flags = flags | flags_start;
+    for (; blocks; blocks--, input += BLAKE3_BLOCK_LEN) {
+        if (blocks == 1)
+            block_flags |= flags_end;
+        blake3_compress_in_place(cv, input, BLAKE3_BLOCK_LEN, counter, block_flags);
+        block_flags = flags;
+    }
+    blake3_store_cv(out, cv);
+}
+
+void blake3_hash_many_portable(const uint8_t * const * inputs, size_t input_count, size_t blocks, const uint32_t key[8],
+                               uint64_t counter, bool increment_counter, uint8_t flags, uint8_t flags_start, uint8_t flags_end,
+                               uint8_t * out) {
+    for (size_t i = 0; i < input_count; i++) {
+        blake3_hash_one(inputs[i], blocks, key, counter, flags, flags_start, flags_end, out + i * BLAKE3_OUT_LEN);
+        if (increment_counter)
+            counter++;
+    }
+}
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+
+// Rotations by 16 and 8 are byte shuffles, the others shifts
+#define SSE41_ROTR(x, n) _mm_or_si128(_mm_srli_epi32((x), (n)), _mm_slli_epi32((x), 32 - (n)))
+#define SSE41_G(v, a, b, c, d, x, y) \
+    v[a] = _mm_add_epi32(_mm_add_epi32(v[a], v[b]), (x)); v[d] = _mm_shuffle_epi8(_mm_xor_si128(v[d], v[a]), rot16); \
+    v[c] = _mm_add_epi32(v[c], v[d]);                     v[b] = SSE41_ROTR(_mm_xor_si128(v[b], v[c]), 12); \
+    v[a] = _mm_add_epi32(_mm_add_epi32(v[a], v[b]), (y)); v[d] = _mm_shuffle_epi8(_mm_xor_si128(v[d], v[a]), rot8); \
+    v[c] = _mm_add_epi32(v[c], v[d]);                     v[b] = SSE41_ROTR(_mm_xor_si128(v[b], v[c]), 7);
+
+/// @brief Hash 4 inputs of `blocks` blocks, one per lane
+__attribute__((target("sse4.1")))
+static void blake3_hash4_sse41(const uint8_t * const * inputs, size_t blocks, const uint32_t key[8], uint64_t counter,
+                               bool increment_counter, uint8_t flags, uint8_t flags_start, uint8_t flags_end, uint8_t * out) {
+
+    const __m128i rot16 = _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    const __m128i rot8 = _mm_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+
+    // The chaining values, one vector per word with one lane per input
+    __m128i h[8];
+    for (size_t i = 0; i < 8; i++)
+        h[i] = _mm_set1_epi32((int)key[i]);
+
+    uint32_t counter_low[4];
+    uint32_t counter_high[4];
+    for (size_t lane = 0; lane < 4; lane++) {
+        const uint64_t lane_counter = counter + (increment_counter ? lane : 0);
+        counter_low[lane] = (uint32_t)lane_counter;
+        counter_high[lane] = (uint32_t)(lane_counter >> 32);
+    }
+
+    uint8_t block_flags = flags | flags_start;
+    for (size_t i = 0; i < blocks * BLAKE3_BLOCK_LEN; i += BLAKE3_BLOCK_LEN) {
+        if (i + BLAKE3_BLOCK_LEN == blocks * BLAKE3_BLOCK_LEN)
+            block_flags |= flags_end;
+
+        // Transpose the blocks so that m[j] holds word j of every lane
+        __m128i m[16];
+        for (size_t quarter = 0; quarter < 4; quarter++) {
+            const __m128i r0 = _mm_loadu_si128((const __m128i *)(inputs[0] + i + quarter * 16));
+            const __m128i r1 = _mm_loadu_si128((const __m128i *)(inputs[1] + i + quarter * 16));
+            const __m128i r2 = _mm_loadu_si128((const __m128i *)(inputs[2] + i + quarter * 16));
+            const __m128i r3 = _mm_loadu_si128((const __m128i *)(inputs[3] + i + quarter * 16));
+
+            const __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+            const __m128i t1 = _mm_unpackhi_epi32(r0, r1);
+            const __m128i t2 = _mm_unpacklo_epi32(r2, r3);
+            const __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+            __m128i * words = m + quarter * 4;
+            words[0] = _mm_unpacklo_epi64(t0, t2);
+            words[1] = _mm_unpackhi_epi64(t0, t2);
+            words[2] = _mm_unpacklo_epi64(t1, t3);
+            words[3] = _mm_unpackhi_epi64(t1, t3);
+        }
+
+        __m128i v[16] = {
+            h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7],
+            _mm_set1_epi32((int)blake3_iv[0]), _mm_set1_epi32((int)blake3_iv[1]),
+            _mm_set1_epi32((int)blake3_iv[2]), _mm_set1_epi32((int)blake3_iv[3]),
+            _mm_loadu_si128((const __m128i *)counter_low), _mm_loadu_si128((const __m128i *)counter_high),
+            _mm_set1_epi32(BLAKE3_BLOCK_LEN), _mm_set1_epi32(block_flags)
+        };
+        for (size_t r = 0; r < 7; r++) {
+            const uint8_t * s = blake3_schedule[r];
+            BLAKE3_ROUND(SSE41_G, v, m, s)
+        }
+
+        for (size_t j = 0; j < 8; j++)
+            h[j] = _mm_xor_si128(v[j], v[j + 8]);
+        block_flags = flags;
+    }
+
+    // Back to one chaining value per input
+    uint32_t words[8][4];
+    for (size_t j = 0; j < 8; j++)
+        _mm_storeu_si128((__m128i *)words[j], h[j]);
+    for (size_t lane = 0; lane < 4; lane++)
+        for (size_t j = 0; j < 8; j++)
+            blake3_store32(out + lane * BLAKE3_OUT_LEN + 4 * j, words[j][lane]);
+}
+
+void blake3_hash_many_sse41(const uint8_t * const * inputs, size_t input_count, size_t blocks, const uint32_t key[8],
+                            uint64_t counter, bool increment_counter, uint8_t flags, uint8_t flags_start, uint8_t flags_end,
+                            uint8_t * out) {
+    for (; input_count >= 4; input_count -= 4, inputs += 4, out += 4 * BLAKE3_OUT_LEN) {
+        blake3_hash4_sse41(inputs, blocks, key, counter, increment_counter, flags, flags_start, flags_end, out);
+        if (increment_counter)
+            counter += 4;
+    }
+    blake3_hash_many_portable(inputs, input_count, blocks, key, counter, increment_counter, flags, flags_start, flags_end, out);
+}
+
+#define AVX2_ROTR(x, n) _mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+#define AVX2_G(v, a, b, c, d, x, y) \
+    v[a] = _mm256_add_epi32(_mm256_add_epi32(v[a], v[b]), (x)); v[d] = _mm256_shuffle_epi8(_mm256_xor_si256(v[d], v[a]), rot16); \
+    v[c] = _mm256_add_epi32(v[c], v[d]);                        v[b] = AVX2_ROTR(_mm256_xor_si256(v[b], v[c]), 12); \
+    v[a] = _mm256_add_epi32(_mm256_add_epi32(v[a], v[b]), (y)); v[d] = _mm256_shuffle_epi8(_mm256_xor_si256(v[d], v[a]), rot8); \
+    v[c] = _mm256_add_epi32(v[c], v[d]);                        v[b] = AVX2_ROTR(_mm256_xor_si256(v[b], v[c]), 7);
+
+/// @brief Hash 8 inputs of `blocks` blocks, one per lane
+__attribute__((target("avx2")))
+static void blake3_hash8_avx2(const uint8_t * const * inputs, size_t blocks, const uint32_t key[8], uint64_t counter,
+                              bool increment_counter, uint8_t flags, uint8_t flags_start, uint8_t flags_end, uint8_t * out) {
+
+    const __m256i rot16 = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+                                           2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    const __m256i rot8 = _mm256_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12,
+                                          1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+
+    // The chaining values, one vector per word with one lane per input
+    __m256i h[8];
+    for (size_t i = 0; i < 8; i++)
+        h[i] = _mm256_set1_epi32((int)key[i]);
+
+    uint32_t counter_low[8];
+    uint32_t counter_high[8];
+    for (size_t lane = 0; lane < 8; lane++) {
+        const uint64_t lane_counter = counter + (increment_counter ? lane : 0);
+        counter_low[lane] = (uint32_t)lane_counter;
+        counter_high[lane] = (uint32_t)(lane_counter >> 32);
+    }
+
+    uint8_t block_flags = flags | flags_start;
+    for (size_t i = 0; i < blocks * BLAKE3_BLOCK_LEN; i += BLAKE3_BLOCK_LEN) {
+        if (i + BLAKE3_BLOCK_LEN == blocks * BLAKE3_BLOCK_LEN)
+            block_flags |= flags_end;
+
+        // Transpose the blocks so that m[j] holds word j of every lane
+        __m256i m[16];
+        for (size_t half = 0; half < 2; half++) {
+            __m256i r[8];
+            for (size_t lane = 0; lane < 8; lane++)
+                r[lane] = _mm256_loadu_si256((const __m256i *)(inputs[lane] + i + half * 32));
+
+            const __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+            const __m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+            const __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+            const __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+            const __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+            const __m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+            const __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+            const __m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+
+            const __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+            const __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+            const __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+            const __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+            const __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+            const __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+            const __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+            const __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+            __m256i * words = m + half * 8;
+            words[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+            words[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+            words[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+            words[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+            words[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+            words[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+            words[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+            words[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+        }
+
+        __m256i v[16] = {
+            h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7],
+            _mm256_set1_epi32((int)blake3_iv[0]), _mm256_set1_epi32((int)blake3_iv[1]),
+            _mm256_set1_epi32((int)blake3_iv[2]), _mm256_set1_epi32((int)blake3_iv[3]),
+            _mm256_loadu_si256((const __m256i *)counter_low), _mm256_loadu_si256((const __m256i *)counter_high),
+            _mm256_set1_epi32(BLAKE3_BLOCK_LEN), _mm256_set1_epi32(block_flags)
+        };
+        for (size_t r = 0; r < 7; r++) {
+            const uint8_t * s = blake3_schedule[r];
+            BLAKE3_ROUND(AVX2_G, v, m, s)
+        }
+
+        for (size_t j = 0; j < 8; j++)
+            h[j] = _mm256_xor_si256(v[j], v[j + 8]);
+        block_flags = flags;
+    }
+
+    // Back to one chaining value per input
+    uint32_t words[8][8];
+    for (size_t j = 0; j < 8; j++)
+        _mm256_storeu_si256((__m256i *)words[j], h[j]);
+    for (size_t lane = 0; lane < 8; lane++)
+        for (size_t j = 0; j < 8; j++)
+            blake3_store32(out + lane * BLAKE3_OUT_LEN + 4 * j, words[j][lane]);
+}
+
+void blake3_hash_many_avx2(const uint8_t * const * inputs, size_t input_count, size_t blocks, const uint32_t key[8],
+                           uint64_t counter, bool increment_counter, uint8_t flags, uint8_t flags_start, uint8_t flags_end,
+                           uint8_t * out) {
+    for (; input_count >= 8; input_count -= 8, inputs += 8, out += 8 * BLAKE3_OUT_LEN) {
+        blake3_hash8_avx2(inputs, blocks, key, counter, increment_counter, flags, flags_start, flags_end, out);
+        if (increment_counter)
+            counter += 8;
+    }
+    blake3_hash_many_sse41(inputs, input_count, blocks, key, counter, increment_counter, flags, flags_start, flags_end, out);
+}
+#endif
+
+/// @brief Kernel and its number of lanes, chosen at startup by the kernel registry (or with --engine)
+static blake3_hash_many_t blake3_hash_many = blake3_hash_many_portable;
+static size_t blake3_simd_degree = 1;
+
+/// @brief Threads a single update may use
+static size_t blake3_threads = 1;
+
+static void blake3_use_portable(void) {
+    blake3_hash_many = blake3_hash_many_portable;
+    blake3_simd_degree = 1;
+}
+
+#if defined(__x86_64__)
+static void blake3_use_sse41(void) {
+    blake3_hash_many = blake3_hash_many_sse41;
+    blake3_simd_degree = 4;
+}
+
+static void blake3_use_avx2(void) {
+    blake3_hash_many = blake3_hash_many_avx2;
+    blake3_simd_degree = 8;
+}
+#endif
+
+const ft_ssl_kernel_t blake3_kernels[] = {
+    {"reference", 0, blake3_use_portable},
+#if defined(__x86_64__)
+    {"sse41", CPU_FEATURE_SSE41, blake3_use_sse41},
+    {"avx2", CPU_FEATURE_AVX2 | CPU_FEATURE_SSE41, blake3_use_avx2},
+#endif
+    {NULL, 0, NULL}
+};
+
+__attribute__((constructor))
+static void blake3_select_kernel(void) {
+    kernel_select_default("blake3");
+}
+
+void blake3_set_threads(size_t threads) {
+    blake3_threads = threads ? threads : 1;
+}
+
+/// @brief The last block of a chunk or a parent node, compressed into a chaining value or into the root
+typedef struct {
+    uint32_t input_cv[8];            ///< Chaining value before the block
+    uint8_t block[BLAKE3_BLOCK_LEN]; ///< Block (zero-padded)
+    uint8_t block_len;               ///< Number of bytes of the block
+    uint64_t counter;                ///< Chunk index (0 for parents)
+    uint8_t flags;                   ///< Flags of the block, without ROOT
+} blake3_output_t;
+
+static void blake3_chunk_init(blake3_chunk_state_t * chunk, const uint32_t key[8], uint64_t chunk_counter, uint8_t flags) {
+    memcpy(chunk->cv, key, sizeof(chunk->cv));
+    chunk->chunk_counter = chunk_counter;
+    memset(chunk->buf, 0, sizeof(chunk->buf));
+    chunk->buf_len = 0;
+    chunk->blocks_compressed = 0;
+    chunk->flags = flags;
+}
+
+static size_t blake3_chunk_len(const blake3_chunk_state_t * chunk) {
+    return BLAKE3_BLOCK_LEN * (size_t)chunk->blocks_compressed + chunk->buf_len;
+}
+
+static uint8_t blake3_chunk_start_flag(const blake3_chunk_state_t * chunk) {
+    return chunk->blocks_compressed == 0 ? BLAKE3_CHUNK_START : 0;
+}
+
+/// @brief Feed bytes of the current chunk, keeping the last block buffered (it may be the one with CHUNK_END)
+static void blake3_chunk_update(blake3_chunk_state_t * chunk, const uint8_t * input, size_t size) {
+
+    if (chunk->buf_len) {
+        const size_t missing = BLAKE3_BLOCK_LEN - chunk->buf_len;
+        const size_t copied = size < missing ? size : missing;
+        memcpy(chunk->buf + chunk->buf_len, input, copied);
+        chunk->buf_len = (uint8_t)(chunk->buf_len + copied);
+        input += copied;
+        size -= copied;
+        if (!size)
+            return;
+        blake3_compress_in_place(chunk->cv, chunk->buf, BLAKE3_BLOCK_LEN, chunk->chunk_counter, chunk->flags | blake3_chunk_start_flag(chunk));
+        chunk->blocks_compressed++;
+        chunk->buf_len = 0;
+        memset(chunk->buf, 0, sizeof(chunk->buf));
+    }
+
+    for (; size > BLAKE3_BLOCK_LEN; input += BLAKE3_BLOCK_LEN, size -= BLAKE3_BLOCK_LEN) {
+        blake3_compress_in_place(chunk->cv, input, BLAKE3_BLOCK_LEN, chunk->chunk_counter, chunk->flags | blake3_chunk_start_flag(chunk));
+        chunk->blocks_compressed++;
+    }
+
+    memcpy(chunk->buf, input, size);
+    chunk->buf_len = (uint8_t)size;
+}
+
+static blake3_output_t blake3_chunk_output(const blake3_chunk_state_t * chunk) {
+    blake3_output_t output;
+    memcpy(output.input_cv, chunk->cv, sizeof(output.input_cv));
+    memcpy(output.block, chunk->buf, sizeof(output.block));
+    output.block_len = chunk->buf_len;
+    output.counter = chunk->chunk_counter;
+    output.flags = chunk->flags | blake3_chunk_start_flag(chunk) | BLAKE3_CHUNK_END;
+    return output;
+}
+
+/// @brief The parent of two chaining values, concatenated in `block`
+static blake3_output_t blake3_parent_output(const uint8_t block[BLAKE3_BLOCK_LEN], const uint32_t key[8], uint8_t flags) {
+    blake3_output_t output;
+    memcpy(output.input_cv, key, sizeof(output.input_cv));
+    memcpy(output.block, block, sizeof(output.block));
+    output.block_len = BLAKE3_BLOCK_LEN;
+    output.counter = 0;
+    output.flags = flags | BLAKE3_PARENT;
+    return output;
+}
+
+static void blake3_output_cv(const blake3_output_t * output, uint8_t cv[BLAKE3_OUT_LEN]) {
+    uint32_t words[8];
+    memcpy(words, output->input_cv, sizeof(words));
+    blake3_compress_in_place(words, output->block, output->block_len, output->counter, output->flags);
+    blake3_store_cv(cv, words);
+}
+
+/// @brief The first 32 bytes of the extendable output (the output block counter starts at 0)
+static void blake3_output_root(const blake3_output_t * output, uint8_t out[BLAKE3_OUT_LEN]) {
+    uint32_t words[8];
+    memcpy(words, output->input_cv, sizeof(words));
+    blake3_compress_in_place(words, output->block, output->block_len, 0, output->flags | BLAKE3_ROOT);
+    blake3_store_cv(out, words);
+}
+
+/// @brief Hash the whole chunks side by side, then the partial chunk at the end (if any)
+/// @return The number of chaining values written to `out`
+static size_t blake3_compress_chunks(const uint8_t * input, size_t size, const uint32_t key[8], uint64_t chunk_counter,
+                                     uint8_t flags, uint8_t * out) {
+
+    const uint8_t * chunks[BLAKE3_MAX_SIMD_DEGREE];
+    size_t chunk_count = 0;
+    for (; size - chunk_count * BLAKE3_CHUNK_LEN >= BLAKE3_CHUNK_LEN; chunk_count++)
+        chunks[chunk_count] = input + chunk_count * BLAKE3_CHUNK_LEN;
+    blake3_hash_many(chunks, chunk_count, BLAKE3_CHUNK_LEN / BLAKE3_BLOCK_LEN, key, chunk_counter, true, flags,
+                     BLAKE3_CHUNK_START, BLAKE3_CHUNK_END, out);
+
+    const size_t hashed = chunk_count * BLAKE3_CHUNK_LEN;
+    if (size == hashed)
+        return chunk_count;
+
+    blake3_chunk_state_t chunk;
+    blake3_chunk_init(&chunk, key, chunk_counter + chunk_count, flags);
+    blake3_chunk_update(&chunk, input + hashed, size - hashed);
+    const blake3_output_t output = blake3_chunk_output(&chunk);
+    blake3_output_cv(&output, out + chunk_count * BLAKE3_OUT_LEN);
+    return chunk_count + 1;
+}
+
+/// @brief Hash pairs of chaining values side by side, carrying an odd one over
+/// @return The number of chaining values written to `out`
+static size_t blake3_compress_parents(const uint8_t * child_cvs, size_t child_count, const uint32_t key[8], uint8_t flags,
+                                      uint8_t * out) {
+
+    const uint8_t * parents[BLAKE3_MAX_SIMD_DEGREE];
+    size_t parent_count = 0;
+    for (; child_count - 2 * parent_count >= 2; parent_count++)
+        parents[parent_count] = child_cvs + 2 * parent_count * BLAKE3_OUT_LEN;
+    blake3_hash_many(parents, parent_count, 1, key, 0, false, flags | BLAKE3_PARENT, 0, 0, out);
+
+    if (child_count == 2 * parent_count)
+        return parent_count;
+    memcpy(out + parent_count * BLAKE3_OUT_LEN, child_cvs + 2 * parent_count * BLAKE3_OUT_LEN, BLAKE3_OUT_LEN);
+    return parent_count + 1;
+}
+
+/// @brief Length of the left subtree: the largest power of 2 chunks that leaves at least one byte on the right
+static size_t blake3_left_len(size_t size) {
+    const size_t full_chunks = (size - 1) / BLAKE3_CHUNK_LEN;
+    return ((size_t)1 << (63 - __builtin_clzll(full_chunks | 1))) * BLAKE3_CHUNK_LEN;
+}
+
+/// @brief A subtree hashed on its own thread
+typedef struct {
+    const uint8_t * input;  ///< First byte of the subtree
+    size_t size;            ///< Size of the subtree
+    const uint32_t * key;   ///< Key words
+    uint64_t chunk_counter; ///< Index of the first chunk
+    uint8_t flags;          ///< Flags of every block
+    uint8_t * out;          ///< Where to write the chaining values
+    size_t threads;         ///< Threads the subtree may use
+    size_t cv_count;        ///< Number of chaining values written
+} blake3_subtree_t;
+
+static size_t blake3_compress_subtree_wide(const uint8_t * input, size_t size, const uint32_t key[8], uint64_t chunk_counter,
+                                           uint8_t flags, uint8_t * out, size_t threads);
+
+static void * blake3_subtree_thread(void * arg) {
+    blake3_subtree_t * subtree = arg;
+    subtree->cv_count = blake3_compress_subtree_wide(subtree->input, subtree->size, subtree->key, subtree->chunk_counter,
+                                                     subtree->flags, subtree->out, subtree->threads);
+    return NULL;
+}
+
+/// @brief Hash a subtree down to at most `blake3_simd_degree` chaining values (at least 2 if it has several chunks),
+///        so that every level of parents fills the SIMD lanes too
+/// @return The number of chaining values written to `out`
+static size_t blake3_compress_subtree_wide(const uint8_t * input, size_t size, const uint32_t key[8], uint64_t chunk_counter,
+                                           uint8_t flags, uint8_t * out, size_t threads) {
+
+    if (size <= blake3_simd_degree * BLAKE3_CHUNK_LEN)
+        return blake3_compress_chunks(input, size, key, chunk_counter, flags, out);
+
+    const size_t left_len = blake3_left_len(size);
+    // One lane still needs two chaining values per subtree above the chunks, but a single chunk on the left is one
+    const size_t degree = blake3_simd_degree == 1 && left_len > BLAKE3_CHUNK_LEN ? 2 : blake3_simd_degree;
+    uint8_t cv_array[2 * BLAKE3_MAX_SIMD_DEGREE * BLAKE3_OUT_LEN];
+    uint8_t * right_cvs = cv_array + degree * BLAKE3_OUT_LEN;
+
+    // The left subtree goes to another thread when the halves are worth it, each side keeping half of the threads
+    blake3_subtree_t left = {input, left_len, key, chunk_counter, flags, cv_array, threads / 2, 0};
+    pthread_t thread;
+    const bool threaded = threads > 1 && size >= BLAKE3_THREAD_MIN && pthread_create(&thread, NULL, blake3_subtree_thread, &left) == 0;
+    if (!threaded) {
+        left.threads = threads;
+        blake3_subtree_thread(&left);
+    }
+    const size_t right_count = blake3_compress_subtree_wide(input + left_len, size - left_len, key,
+                                                            chunk_counter + left_len / BLAKE3_CHUNK_LEN, flags, right_cvs,
+                                                            threaded ? threads - threads / 2 : threads);
+    if (threaded)
+        pthread_join(thread, NULL);
+
+    // A single chunk on the left means two chaining values in all, already a pair
+    if (left.cv_count == 1) {
+        memcpy(out, cv_array, 2 * BLAKE3_OUT_LEN);
+        return 2;
+    }
+    return blake3_compress_parents(cv_array, left.cv_count + right_count, key, flags, out);
+}
+
+/// @brief Hash a subtree of more than one chunk down to the two children of its root
+static void blake3_compress_subtree_to_parent(const uint8_t * input, size_t size, const uint32_t key[8], uint64_t chunk_counter,
+                                              uint8_t flags, uint8_t out[2 * BLAKE3_OUT_LEN]) {
+
+    uint8_t cv_array[BLAKE3_MAX_SIMD_DEGREE * BLAKE3_OUT_LEN];
+    size_t cv_count = blake3_compress_subtree_wide(input, size, key, chunk_counter, flags, cv_array, blake3_threads);
+
+    uint8_t parents[BLAKE3_MAX_SIMD_DEGREE * BLAKE3_OUT_LEN / 2];
+    while (cv_count > 2) {
+        cv_count = blake3_compress_parents(cv_array, cv_count, key, flags, parents);
+        memcpy(cv_array, parents, cv_count * BLAKE3_OUT_LEN);
+    }
+    memcpy(out, cv_array, 2 * BLAKE3_OUT_LEN);
+}
+
+void blake3_hasher_init(blake3_hasher_t * hasher) {
+    memcpy(hasher->key, blake3_iv, sizeof(hasher->key));
+    blake3_chunk_init(&hasher->chunk, hasher->key, 0, 0);
+    hasher->cv_stack_len = 0;
+}
+
+/// @brief Merge the stack down to one chaining value per complete subtree of the `total_chunks` first chunks
+/// @details The merge is lazy, only done when more input arrives: the last subtree must not get a parent before
+///          it is known not to be the root
+static void blake3_merge_cv_stack(blake3_hasher_t * hasher, uint64_t total_chunks) {
+    const size_t merged_len = (size_t)__builtin_popcountll(total_chunks);
+    while (hasher->cv_stack_len > merged_len) {
+        uint8_t * parent = hasher->cv_stack + (hasher->cv_stack_len - 2) * BLAKE3_OUT_LEN;
+        const blake3_output_t output = blake3_parent_output(parent, hasher->key, hasher->chunk.flags);
+        blake3_output_cv(&output, parent);
+        hasher->cv_stack_len--;
+    }
+}
+
+static void blake3_push_cv(blake3_hasher_t * hasher, const uint8_t cv[BLAKE3_OUT_LEN], uint64_t chunk_counter) {
+    blake3_merge_cv_stack(hasher, chunk_counter);
+    memcpy(hasher->cv_stack + hasher->cv_stack_len * BLAKE3_OUT_LEN, cv, BLAKE3_OUT_LEN);
+    hasher->cv_stack_len++;
+}
+
+void blake3_hasher_update(blake3_hasher_t * hasher, const uint8_t * input, size_t size) {
+
+    if (!size)
+        return;
+
+    // Complete the current chunk first, it is only finished once more input follows
+    if (blake3_chunk_len(&hasher->chunk)) {
+        const size_t missing = BLAKE3_CHUNK_LEN - blake3_chunk_len(&hasher->chunk);
+        const size_t copied = size < missing ? size : missing;
+        blake3_chunk_update(&hasher->chunk, input, copied);
+        input += copied;
+        size -= copied;
+        if (!size)
+            return;
+        uint8_t cv[BLAKE3_OUT_LEN];
+        const blake3_output_t output = blake3_chunk_output(&hasher->chunk);
+        blake3_output_cv(&output, cv);
+        blake3_push_cv(hasher, cv, hasher->chunk.chunk_counter);
+        blake3_chunk_init(&hasher->chunk, hasher->key, hasher->chunk.chunk_counter + 1, hasher->chunk.flags);
+    }
+
+    // Then the largest complete subtrees that fit, keeping at least one byte for the chunk state
+    while (size > BLAKE3_CHUNK_LEN) {
+
+        // A subtree must start at a multiple of its own size
+        size_t subtree_len = (size_t)1 << (63 - __builtin_clzll(size));
+        const uint64_t count_so_far = hasher->chunk.chunk_counter * BLAKE3_CHUNK_LEN;
+        while (((uint64_t)(subtree_len - 1) & count_so_far) != 0)
+            subtree_len /= 2;
+        const uint64_t subtree_chunks = subtree_len / BLAKE3_CHUNK_LEN;
+
+        if (subtree_len <= BLAKE3_CHUNK_LEN) {
+            blake3_chunk_state_t chunk;
+            blake3_chunk_init(&chunk, hasher->key, hasher->chunk.chunk_counter, hasher->chunk.flags);
+            blake3_chunk_update(&chunk, input, subtree_len);
+            uint8_t cv[BLAKE3_OUT_LEN];
+            const blake3_output_t output = blake3_chunk_output(&chunk);
+            blake3_output_cv(&output, cv);
+            blake3_push_cv(hasher, cv, chunk.chunk_counter);
+        } else {
+            uint8_t cv_pair[2 * BLAKE3_OUT_LEN];
+            blake3_compress_subtree_to_parent(input, subtree_len, hasher->key, hasher->chunk.chunk_counter, hasher->chunk.flags, cv_pair);
+            blake3_push_cv(hasher, cv_pair, hasher->chunk.chunk_counter);
+            blake3_push_cv(hasher, cv_pair + BLAKE3_OUT_LEN, hasher->chunk.chunk_counter + subtree_chunks / 2);
+        }
+        hasher->chunk.chunk_counter += subtree_chunks;
+        input += subtree_len;
+        size -= subtree_len;
+    }
+
+    if (size) {
+        blake3_chunk_update(&hasher->chunk, input, size);
+        blake3_merge_cv_stack(hasher, hasher->chunk.chunk_counter);
+    }
+}
+
+void blake3_hasher_finalize(const blake3_hasher_t * hasher, uint8_t out[BLAKE3_OUT_LEN]) {
+
+    // A single chunk is the root
+    if (hasher->cv_stack_len == 0) {
+        const blake3_output_t output = blake3_chunk_output(&hasher->chunk);
+        blake3_output_root(&output, out);
+        return;
+    }
+
+    // Otherwise fold the stack from the right, the current chunk (if any) being the rightmost leaf
+    size_t remaining;
+    blake3_output_t output;
+    if (blake3_chunk_len(&hasher->chunk)) {
+        remaining = hasher->cv_stack_len;
+        output = blake3_chunk_output(&hasher->chunk);
+    } else {
+        remaining = hasher->cv_stack_len - 2u;
+        output = blake3_parent_output(hasher->cv_stack + remaining * BLAKE3_OUT_LEN, hasher->key, hasher->chunk.flags);
+    }
+    while (remaining) {
+        remaining--;
+        uint8_t parent_block[BLAKE3_BLOCK_LEN];
+        memcpy(parent_block, hasher->cv_stack + remaining * BLAKE3_OUT_LEN, BLAKE3_OUT_LEN);
+        blake3_output_cv(&output, parent_block + BLAKE3_OUT_LEN);
+        output = blake3_parent_output(parent_block, hasher->key, hasher->chunk.flags);
+    }
+    blake3_output_root(&output, out);
+}
+
+static void blake3_digest_init(void * state) {
+    blake3_hasher_init(state);
+}
+
+static void blake3_digest_update(void * state, const uint8_t * data, size_t size) {
+    blake3_hasher_update(state, data, size);
+}
+
+/// @brief The digest bytes, as the big-endian hash words the printers expect
+static void blake3_digest_final(void * state, uint32_t * hash) {
+    uint8_t out[BLAKE3_OUT_LEN];
+    blake3_hasher_finalize(state, out);
+    for (size_t i = 0; i < 8; i++)
+        hash[i] = (uint32_t)out[4 * i] << 24 | (uint32_t)out[4 * i + 1] << 16 | (uint32_t)out[4 * i + 2] << 8 | out[4 * i + 3];
+}
+
+const ft_ssl_hasher_t blake3_digest = {blake3_digest_init, blake3_digest_update, blake3_digest_final};
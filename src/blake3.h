@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdbool.h> // for bool
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint32_t, uint64_t, uint8_t
+
+#include "ft_ssl.h" // for ft_ssl_hasher_t, ft_ssl_kernel_t
+
+/// @brief The size of a BLAKE3 block in bytes, and of a chaining value or a digest
+#define BLAKE3_BLOCK_LEN 64
+#define BLAKE3_OUT_LEN 32
+
+/// @brief The size of a chunk, the leaves of the BLAKE3 tree (16 blocks)
+#define BLAKE3_CHUNK_LEN 1024
+
+/// @brief The deepest tree: 2^54 chunks of 1 KiB cover any 64-bit length
+#define BLAKE3_MAX_DEPTH 54
+
+/// @brief The maximum number of chunks (or parents) hashed side by side by the SIMD kernels
+#define BLAKE3_MAX_SIMD_DEGREE 8
+
+/// @brief Subtrees at least this large are split between two threads
+#define BLAKE3_THREAD_MIN (512 * 1024)
+
+/// @brief Domain separation flags of the compression function
+#define BLAKE3_CHUNK_START (1 << 0)
+#define BLAKE3_CHUNK_END (1 << 1)
+#define BLAKE3_PARENT (1 << 2)
+#define BLAKE3_ROOT (1 << 3)
+
+/// @brief The chunk being fed, one block at a time
+typedef struct {
+    uint32_t cv[8];                  ///< Chaining value of the blocks compressed so far
+    uint64_t chunk_counter;          ///< Index of the chunk in the message
+    uint8_t buf[BLAKE3_BLOCK_LEN];   ///< Bytes of the last block (compressed once more bytes arrive)
+    uint8_t buf_len;                 ///< Number of bytes in `buf`
+    uint8_t blocks_compressed;       ///< Number of blocks compressed into `cv`
+    uint8_t flags;                   ///< Flags of every block of the chunk
+} blake3_chunk_state_t;
+
+/// @brief Incremental BLAKE3 hash: the current chunk and the chaining values of the complete subtrees
+typedef struct {
+    uint32_t key[8];                 ///< IV (the key of the keyed mode)
+    blake3_chunk_state_t chunk;      ///< Current chunk
+    uint8_t cv_stack_len;            ///< Number of chaining values on the stack
+    uint8_t cv_stack[(BLAKE3_MAX_DEPTH + 1) * BLAKE3_OUT_LEN]; ///< One chaining value per level, merged lazily
+} blake3_hasher_t;
+
+/// @brief Hash `input_count` inputs of `blocks` blocks each, writing one chaining value per input to `out`
+/// @details The counter is the same for every input, or incremented per input (chunks); `flags_start`
+///          and `flags_end` are added to the first and to the last block of each input
+typedef void (*blake3_hash_many_t)(const uint8_t * const * inputs, size_t input_count, size_t blocks, const uint32_t key[8],
+                                   uint64_t counter, bool increment_counter, uint8_t flags, uint8_t flags_start,
+                                   uint8_t flags_end, uint8_t * out);
+
+void blake3_hash_many_portable(const uint8_t * const * inputs, size_t input_count, size_t blocks, const uint32_t key[8],
+                               uint64_t counter, bool increment_counter, uint8_t flags, uint8_t flags_start, uint8_t flags_end,
+                               uint8_t * out);
+
+#if defined(__x86_64__)
+/// @brief 4-way and 8-way kernels, with the inputs in SIMD lanes (only call if the CPU has the instructions)
+void blake3_hash_many_sse41(const uint8_t * const * inputs, size_t input_count, size_t blocks, const uint32_t key[8],
+                            uint64_t counter, bool increment_counter, uint8_t flags, uint8_t flags_start, uint8_t flags_end,
+                            uint8_t * out);
+void blake3_hash_many_avx2(const uint8_t * const * inputs, size_t input_count, size_t blocks, const uint32_t key[8],
+                           uint64_t counter, bool increment_counter, uint8_t flags, uint8_t flags_start, uint8_t flags_end,
+                           uint8_t * out);
+#endif
+
+/// @brief Compress a block into a chaining value (the portable compression function)
+void blake3_compress_in_place(uint32_t cv[8], const uint8_t block[BLAKE3_BLOCK_LEN], uint8_t block_len, uint64_t counter, uint8_t flags);
+
+void blake3_hasher_init(blake3_hasher_t * hasher);
+
+/// @brief Feed the next `size` bytes of the message (large inputs are hashed as whole subtrees, on several threads)
+void blake3_hasher_update(blake3_hasher_t * hasher, const uint8_t * input, size_t size);
+
+/// @brief Write the 32-byte digest to `out`, without changing the hasher
+void blake3_hasher_finalize(const blake3_hasher_t * hasher, uint8_t out[BLAKE3_OUT_LEN]);
+
+/// @brief Set how many threads a single large update may use (1 by default, when the inputs already are in parallel)
+void blake3_set_threads(size_t threads);
+
+/// @brief Implementations of the chunk and parent hashing: reference (one input at a time), sse41 and avx2
+extern const ft_ssl_kernel_t blake3_kernels[];
+
+/// @brief BLAKE3 behind the ft_ssl_hasher_t interface, with the digest bytes as big-endian hash words
+extern const ft_ssl_hasher_t blake3_digest;
@@ -0,0 +1,290 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cache.h"
+
+#define CACHE_ENTRIES(header) ((cache_entry_t *)((header) + 1))
+
+static int64_t cache_time_ns(const struct timespec * time) {
+    return (int64_t)time->tv_sec * 1000000000 + time->tv_nsec;
+}
+
+/// @brief Stable id of an algorithm (FNV-1a of its name), so that the file outlives the order of the table
+static uint32_t cache_algorithm_id(const ft_ssl_algorithm_t * algorithm) {
+    uint32_t id = 2166136261u;
+    for (const char * c = algorithm->lower_name; *c; c++)
+        id = (id ^ (uint8_t)*c) * 16777619u;
+    return id ? id : 1;
+}
+
+/// @brief First slot of the probe sequence of a key
+static uint64_t cache_slot(uint64_t dev, uint64_t ino, uint32_t algorithm) {
+    uint64_t x = (dev * 0x9e3779b97f4a7c15ull) ^ ino ^ ((uint64_t)algorithm << 32);
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+static bool cache_same_version(const cache_entry_t * entry, const struct stat * st) {
+    return entry->size == (uint64_t)st->st_size
+        && entry->mtime_ns == cache_time_ns(&st->st_mtim)
+        && entry->ctime_ns == cache_time_ns(&st->st_ctim);
+}
+
+static void cache_unmap(cache_t * cache) {
+    if (cache->header)
+        munmap(cache->header, cache->map_size);
+    if (cache->fd >= 0)
+        close(cache->fd);
+    cache->header = NULL;
+    cache->fd = -1;
+}
+
+/// @brief Write an empty cache of `capacity` entries to a new file
+static bool cache_create(int fd, uint64_t capacity) {
+    cache_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.entry_size = sizeof(cache_entry_t);
+    header.capacity = capacity;
+
+    // The entries are a hole until they are used
+    return ftruncate(fd, (off_t)(sizeof(cache_header_t) + capacity * sizeof(cache_entry_t))) == 0
+        && pwrite(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header);
+}
+
+/// @brief The cache file was replaced (grown) by another process since we opened it
+static bool cache_stale(const cache_t * cache) {
+    struct stat path_st;
+    struct stat fd_st;
+    return stat(cache->path, &path_st) == -1 || fstat(cache->fd, &fd_st) == -1
+        || path_st.st_dev != fd_st.st_dev || path_st.st_ino != fd_st.st_ino;
+}
+
+/// @brief Open and map the current cache file, creating it if needed
+static bool cache_map(cache_t * cache) {
+
+    for (;;) {
+        cache->fd = open(cache->path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (cache->fd == -1)
+            return false;
+        if (flock(cache->fd, LOCK_EX) == -1) {
+            cache_unmap(cache);
+            return false;
+        }
+        // Lost a race with a process that grew the cache
+        if (cache_stale(cache)) {
+            cache_unmap(cache);
+            continue;
+        }
+        break;
+    }
+
+    struct stat st;
+    cache_header_t header;
+    bool valid = fstat(cache->fd, &st) == 0
+        && (st.st_size > 0 || cache_create(cache->fd, CACHE_INITIAL_CAPACITY))
+        && pread(cache->fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header)
+        && memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) == 0
+        && header.entry_size == sizeof(cache_entry_t)
+        && header.capacity && (header.capacity & (header.capacity - 1)) == 0
+        && fstat(cache->fd, &st) == 0
+        && (uint64_t)st.st_size == sizeof(cache_header_t) + header.capacity * sizeof(cache_entry_t);
+
+    if (valid) {
+        cache->map_size = (size_t)st.st_size;
+        void * map = mmap(NULL, cache->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, cache->fd, 0);
+        valid = map != MAP_FAILED;
+        if (valid)
+            cache->header = map;
+    } else {
+        errno = EINVAL;
+    }
+
+    flock(cache->fd, LOCK_UN);
+    if (!valid)
+        cache_unmap(cache);
+    return valid;
+}
+
+cache_t * cache_open(const char * path) {
+
+    cache_t * cache = malloc(sizeof(cache_t));
+    if (!cache)
+        return NULL;
+    cache->path = path;
+    cache->fd = -1;
+    cache->header = NULL;
+
+    if (!cache_map(cache)) {
+        free(cache);
+        return NULL;
+    }
+    pthread_rwlock_init(&cache->lock, NULL);
+    return cache;
+}
+
+bool cache_lookup(cache_t * cache, const struct stat * st, const ft_ssl_algorithm_t * algorithm, uint32_t hash[FT_SSL_MAX_STATE_WORDS]) {
+
+    const uint32_t id = cache_algorithm_id(algorithm);
+    bool found = false;
+
+    pthread_rwlock_rdlock(&cache->lock);
+    if (!cache->header) {
+        pthread_rwlock_unlock(&cache->lock);
+        return false;
+    }
+
+    const uint64_t mask = cache->header->capacity - 1;
+    const uint64_t start = cache_slot((uint64_t)st->st_dev, (uint64_t)st->st_ino, id);
+    for (uint64_t probe = 0; probe <= mask; probe++) {
+
+        // Copy the entry, and give up if another process was writing it meanwhile
+        cache_entry_t * shared = &CACHE_ENTRIES(cache->header)[(start + probe) & mask];
+        const uint32_t sequence = __atomic_load_n(&shared->sequence, __ATOMIC_ACQUIRE);
+        cache_entry_t entry;
+        memcpy(&entry, shared, sizeof(entry));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if ((sequence & 1) || __atomic_load_n(&shared->sequence, __ATOMIC_RELAXED) != sequence)
+            break;
+
+        if (entry.algorithm == 0)
+            break;
+        if (entry.algorithm == id && entry.dev == (uint64_t)st->st_dev && entry.ino == (uint64_t)st->st_ino) {
+            found = cache_same_version(&entry, st);
+            if (found)
+                memcpy(hash, entry.hash, algorithm->word_count * sizeof(uint32_t));
+            break;
+        }
+    }
+
+    pthread_rwlock_unlock(&cache->lock);
+    return found;
+}
+
+/// @brief Entry of a key, or the free entry where it goes
+/// @return NULL if the key is new and the cache must grow first
+static cache_entry_t * cache_find(cache_header_t * header, uint64_t dev, uint64_t ino, uint32_t id) {
+
+    const uint64_t mask = header->capacity - 1;
+    const uint64_t start = cache_slot(dev, ino, id);
+    for (uint64_t probe = 0; probe <= mask; probe++) {
+        cache_entry_t * entry = &CACHE_ENTRIES(header)[(start + probe) & mask];
+        if (entry->algorithm == id && entry->dev == dev && entry->ino == ino)
+            return entry;
+        if (entry->algorithm == 0)
+            return (header->count + 1) * 2 > header->capacity ? NULL : entry;
+    }
+    return NULL;
+}
+
+/// @brief Replace the cache file with a copy twice as large (the caller holds the file lock)
+static bool cache_grow(cache_t * cache) {
+
+    const size_t path_size = strlen(cache->path);
+    char * tmp_path = malloc(path_size + 32);
+    if (!tmp_path)
+        return false;
+    snprintf(tmp_path, path_size + 32, "%s.%ld.tmp", cache->path, (long)getpid());
+
+    const int fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    const uint64_t capacity = cache->header->capacity * 2;
+    bool grown = fd != -1 && cache_create(fd, capacity);
+
+    void * map = MAP_FAILED;
+    const size_t map_size = sizeof(cache_header_t) + capacity * sizeof(cache_entry_t);
+    if (grown)
+        map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    grown = map != MAP_FAILED;
+
+    if (grown) {
+        cache_header_t * header = map;
+        for (uint64_t i = 0; i < cache->header->capacity; i++) {
+            const cache_entry_t * entry = &CACHE_ENTRIES(cache->header)[i];
+            if (entry->algorithm == 0)
+                continue;
+            cache_entry_t * slot = cache_find(header, entry->dev, entry->ino, entry->algorithm);
+            memcpy(slot, entry, sizeof(cache_entry_t));
+            slot->sequence = 0;
+            header->count++;
+        }
+        munmap(map, map_size);
+        grown = rename(tmp_path, cache->path) == 0;
+    }
+
+    if (fd != -1)
+        close(fd);
+    if (!grown)
+        unlink(tmp_path);
+    free(tmp_path);
+    return grown;
+}
+
+void cache_store(cache_t * cache, int fd, const struct stat * st, const ft_ssl_algorithm_t * algorithm, const uint32_t hash[FT_SSL_MAX_STATE_WORDS]) {
+
+    // A file modified while it was hashed has a digest of neither version
+    struct stat after;
+    if (fstat(fd, &after) == -1 || after.st_size != st->st_size || cache_time_ns(&after.st_mtim) != cache_time_ns(&st->st_mtim)
+        || cache_time_ns(&after.st_ctim) != cache_time_ns(&st->st_ctim))
+        return;
+
+    const uint32_t id = cache_algorithm_id(algorithm);
+
+    pthread_rwlock_wrlock(&cache->lock);
+
+    while (cache->header) {
+
+        // Other processes write under the same lock, and may have replaced the file
+        flock(cache->fd, LOCK_EX);
+        if (cache_stale(cache)) {
+            cache_unmap(cache);
+            cache_map(cache);
+            continue;
+        }
+
+        cache_entry_t * entry = cache_find(cache->header, (uint64_t)st->st_dev, (uint64_t)st->st_ino, id);
+        if (!entry) {
+            const bool grown = cache_grow(cache);
+            cache_unmap(cache);
+            if (grown)
+                cache_map(cache);
+            continue;
+        }
+
+        // Readers retry (or miss) while the sequence is odd
+        const bool is_new = entry->algorithm == 0;
+        __atomic_store_n(&entry->sequence, entry->sequence + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        entry->algorithm = id;
+        entry->dev = (uint64_t)st->st_dev;
+        entry->ino = (uint64_t)st->st_ino;
+        entry->size = (uint64_t)st->st_size;
+        entry->mtime_ns = cache_time_ns(&st->st_mtim);
+        entry->ctime_ns = cache_time_ns(&st->st_ctim);
+        memcpy(entry->hash, hash, sizeof(entry->hash));
+        __atomic_store_n(&entry->sequence, entry->sequence + 1, __ATOMIC_RELEASE);
+        if (is_new)
+            cache->header->count++;
+
+        flock(cache->fd, LOCK_UN);
+        break;
+    }
+
+    pthread_rwlock_unlock(&cache->lock);
+}
+
+void cache_close(cache_t * cache) {
+    cache_unmap(cache);
+    pthread_rwlock_destroy(&cache->lock);
+    free(cache);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <pthread.h>   // for pthread_rwlock_t
+#include <stdbool.h>   // for bool
+#include <stddef.h>    // for size_t
+#include <stdint.h>    // for uint32_t, uint64_t
+#include <sys/stat.h>  // for struct stat
+
+#include "ft_ssl.h" // for ft_ssl_algorithm_t
+
+/// @brief Number of entries of a new cache file (grown by doubling when half full)
+#define CACHE_INITIAL_CAPACITY 4096
+
+/// @brief First bytes of a cache file
+#define CACHE_MAGIC "FTSSLDC1"
+
+/// @brief Header at the start of a cache file, followed by `capacity` entries
+typedef struct {
+    char magic[8];        ///< CACHE_MAGIC
+    uint32_t entry_size;  ///< sizeof(cache_entry_t), to reject files from another layout
+    uint32_t reserved;    ///< Always 0
+    uint64_t capacity;    ///< Number of entries (a power of 2)
+    uint64_t count;       ///< Number of used entries
+    uint8_t padding[32];  ///< Rounds the header up to one cache line (64 bytes), where the entries start
+} cache_header_t;
+
+/// @brief Digest of one file for one algorithm, valid as long as the file metadata is unchanged
+typedef struct {
+    uint32_t sequence;  ///< Odd while a writer updates the entry (seqlock)
+    uint32_t algorithm; ///< Algorithm id (0 for a free entry)
+    uint64_t dev;       ///< Device of the file
+    uint64_t ino;       ///< Inode of the file
+    uint64_t size;      ///< Size of the file
+    int64_t mtime_ns;   ///< Modification time
+    int64_t ctime_ns;   ///< Status change time
+    uint32_t hash[FT_SSL_MAX_STATE_WORDS]; ///< Hash words
+    uint8_t padding[16]; ///< Rounds the entry up to two whole cache lines (128 bytes), so that none straddles three
+} cache_entry_t;
+
+/// @brief Open cache file, shared by the threads of the process
+typedef struct cache_s {
+    const char * path;       ///< Path of the cache file
+    int fd;                  ///< Cache file (-1 once the cache is disabled)
+    cache_header_t * header; ///< Shared mapping of the whole file
+    size_t map_size;         ///< Size of the mapping
+    pthread_rwlock_t lock;   ///< Readers look up, the writer may replace the mapping
+} cache_t;
+
+/// @brief Open (or create) a cache file
+/// @return NULL if the file could not be created or is not a cache
+cache_t * cache_open(const char * path);
+
+/// @brief Look a file up from its metadata
+/// @return true and the hash words if the cache has a digest for this exact version of the file
+bool cache_lookup(cache_t * cache, const struct stat * st, const ft_ssl_algorithm_t * algorithm, uint32_t hash[FT_SSL_MAX_STATE_WORDS]);
+
+/// @brief Record the digest of the file open as `fd`, unless it changed since `st` was taken
+void cache_store(cache_t * cache, int fd, const struct stat * st, const ft_ssl_algorithm_t * algorithm, const uint32_t hash[FT_SSL_MAX_STATE_WORDS]);
+
+/// @brief Unmap the cache and free it
+void cache_close(cache_t * cache);
@@ -0,0 +1,204 @@
+#include <ctype.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "check.h"
+#include "output.h"
+#include "pool.h"
+#include "utils.h"
+
+/// @brief A manifest line being verified
+typedef struct {
+    ft_ssl_job_t job;     ///< File to hash (the filename is owned by the entry)
+    uint32_t expected[FT_SSL_MAX_STATE_WORDS]; ///< Hash words listed in the manifest
+} check_entry_t;
+
+/// @brief Counters for the summary
+typedef struct {
+    size_t ok;         ///< Files that matched
+    size_t failed;     ///< Files that did not match
+    size_t unreadable; ///< Files that could not be opened
+    size_t malformed;  ///< Lines in neither output format
+    size_t other_mode; ///< Lines of the algorithm hashed in another mode (tree hash or not, or another leaf size)
+} check_summary_t;
+
+/// @brief Split a manifest line into the filename and the expected hash
+/// @param name Name that starts the lines of the default format (see ft_ssl_format_name)
+/// @return false if the line is in neither output format
+static bool check_parse_line(const ft_ssl_algorithm_t * algorithm, const char * name, char * line, const char ** filename,
+                             uint32_t expected[FT_SSL_MAX_STATE_WORDS]) {
+
+    const size_t hex_size = algorithm->word_count * 8;
+    size_t size = strlen(line);
+    while (size && (line[size - 1] == '\n' || line[size - 1] == '\r'))
+        line[--size] = '\0';
+
+    // Default format: "MD5(file)= hash" (the filename may contain ")= " itself), "HMAC-MD5(file)= hash" with a key,
+    // "MD5-TREE-4M(file)= hash" for a tree hash
+    const size_t name_size = strlen(name);
+    if (size > name_size + 4 + hex_size && strncmp(line, name, name_size) == 0 && line[name_size] == '('
+        && strncmp(line + size - hex_size - 3, ")= ", 3) == 0) {
+        if (!ft_ssl_parse_hash(line + size - hex_size, algorithm->word_count, expected))
+            return false;
+        line[size - hex_size - 3] = '\0';
+        *filename = line + name_size + 1;
+        return **filename != '\0';
+    }
+
+    // Reverse format: "hash *file" (or "hash  file" in text mode)
+    if (size > hex_size + 2 && line[hex_size] == ' ' && (line[hex_size + 1] == '*' || line[hex_size + 1] == ' ')) {
+        if (!ft_ssl_parse_hash(line, algorithm->word_count, expected))
+            return false;
+        *filename = line + hex_size + 2;
+        return true;
+    }
+
+    return false;
+}
+
+/// @brief Print a verdict line through the standard output buffer, like the digests
+/// @brief Whether a line that did not parse is a digest line of the algorithm in another mode: "MD5(" or "MD5-TREE-"
+static bool check_other_mode(const ft_ssl_algorithm_t * algorithm, const char * line) {
+    const size_t name_size = strlen(algorithm->upper_name);
+    return strncmp(line, algorithm->upper_name, name_size) == 0
+           && (line[name_size] == '(' || strncmp(line + name_size, "-TREE-", 6) == 0);
+}
+
+static void check_print(const char * filename, const char * verdict) {
+    output_string(filename);
+    output_string(verdict);
+    output_end_record();
+}
+
+static void check_report(const ft_ssl_algorithm_t * algorithm, check_entry_t * entry, check_summary_t * summary, bool quiet) {
+
+    if (entry->job.error) {
+        check_print(entry->job.filename, ": FAILED open or read\n");
+        fprintf(stderr, "ft_ssl: %s: %s: %s\n", algorithm->lower_name, entry->job.filename, strerror(entry->job.error));
+        summary->unreadable++;
+    } else if (memcmp(entry->job.hash, entry->expected, algorithm->word_count * sizeof(uint32_t)) != 0) {
+        check_print(entry->job.filename, ": FAILED\n");
+        summary->failed++;
+    } else {
+        if (!quiet)
+            check_print(entry->job.filename, ": OK\n");
+        summary->ok++;
+    }
+
+    free(entry->job.filename);
+    entry->job.filename = NULL;
+}
+
+/// @brief Main loop of the pool workers
+static void check_worker(pool_worker_t * worker) {
+
+    ft_ssl_job_t * job;
+    while ((job = pool_next(worker, true))) {
+        ft_ssl_hash_job(&worker->context, job);
+        pool_complete(worker->pool, job);
+    }
+}
+
+bool check_manifest(ft_ssl_context_t * context, const char * path) {
+
+    const ft_ssl_algorithm_t * algorithm = context->entry.data;
+    const bool quiet = IS_OPTION_Q(context->options);
+
+    char name[FT_SSL_NAME_SIZE];
+    ft_ssl_format_name(context, algorithm, name);
+
+    FILE * manifest = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!manifest) {
+        fprintf(stderr, "ft_ssl: %s: %s: %s\n", algorithm->lower_name, path, strerror(errno));
+        return false;
+    }
+
+    // A ring of the lines in flight, the oldest one is printed first
+    const size_t window = context->worker_count * CHECK_JOBS_PER_WORKER;
+    check_entry_t * entries = calloc(window, sizeof(check_entry_t));
+    if (!entries) {
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+
+    pool_t pool;
+    const bool parallel = context->worker_count > 1;
+    if (parallel)
+        pool_start(&pool, context->worker_count, context, check_worker);
+
+    check_summary_t summary = {0, 0, 0, 0, 0};
+    char * line = NULL;
+    size_t line_capacity = 0;
+    size_t head = 0;
+    size_t in_flight = 0;
+    bool eof = false;
+
+    for (;;) {
+
+        // Keep the window full
+        while (!eof && in_flight < window) {
+            if (getline(&line, &line_capacity, manifest) == -1) {
+                eof = true;
+                break;
+            }
+
+            const char * filename;
+            check_entry_t * entry = &entries[(head + in_flight) % window];
+            if (!check_parse_line(algorithm, name, line, &filename, entry->expected)) {
+                if (check_other_mode(algorithm, line))
+                    summary.other_mode++;
+                else
+                    summary.malformed++;
+                continue;
+            }
+
+            memset(&entry->job, 0, sizeof(entry->job));
+            entry->job.filename = strdup(filename);
+            if (!entry->job.filename) {
+                perror("strdup");
+                exit(EXIT_FAILURE);
+            }
+            in_flight++;
+
+            if (parallel)
+                pool_submit(&pool, &entry->job);
+            else
+                ft_ssl_hash_job(context, &entry->job);
+        }
+
+        if (in_flight == 0)
+            break;
+
+        check_entry_t * entry = &entries[head];
+        if (parallel)
+            pool_wait(&pool, &entry->job);
+        check_report(algorithm, entry, &summary, quiet);
+        head = (head + 1) % window;
+        in_flight--;
+    }
+
+    if (parallel)
+        pool_stop(&pool);
+    free(line);
+    free(entries);
+    if (manifest != stdin)
+        fclose(manifest);
+
+    // A root only verifies with the leaf size it was hashed with
+    if (summary.other_mode)
+        fprintf(stderr, "ft_ssl: %s: %s: %zu lines labelled for another mode than %s (tree hash lines need --tree and the --leaf-size of their label)\n",
+                algorithm->lower_name, path, summary.other_mode, name);
+
+    const size_t checked = summary.ok + summary.failed + summary.unreadable;
+    if (checked == 0)
+        fprintf(stderr, "ft_ssl: %s: %s: no properly formatted checksum lines found\n", algorithm->lower_name, path);
+    else
+        fprintf(stderr, "ft_ssl: %s: %s: %zu OK, %zu FAILED, %zu unreadable, %zu improperly formatted\n", algorithm->lower_name, path,
+                summary.ok, summary.failed, summary.unreadable, summary.malformed);
+
+    return checked > 0 && summary.ok == checked && !summary.other_mode;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdbool.h> // for bool
+
+#include "ft_ssl.h" // for ft_ssl_context_t
+
+/// @brief Jobs in flight per worker while checking a manifest (bounds the memory use)
+#define CHECK_JOBS_PER_WORKER 64
+
+/// @brief Verify the digests listed in a manifest, in either output format ("MD5(file)= hash" or "hash *file")
+/// @details The files are hashed on context->worker_count threads, and the results are printed in manifest
+///          order as "file: OK" or "file: FAILED", followed by a summary on stderr.
+/// @return true if every listed file was read and matched
+bool check_manifest(ft_ssl_context_t * context, const char * path);
@@ -0,0 +1,60 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "checkpoint.h"
+
+bool checkpoint_save(const char * path, const ft_ssl_algorithm_t * algorithm, const uint32_t hash[FT_SSL_MAX_STATE_WORDS], size_t offset) {
+
+    const size_t path_size = strlen(path);
+    char * tmp_path = malloc(path_size + sizeof(".tmp"));
+    if (!tmp_path)
+        return false;
+    memcpy(tmp_path, path, path_size);
+    memcpy(tmp_path + path_size, ".tmp", sizeof(".tmp"));
+
+    FILE * file = fopen(tmp_path, "w");
+    if (!file) {
+        free(tmp_path);
+        return false;
+    }
+
+    fprintf(file, "%s %zu ", algorithm->lower_name, offset);
+    for (size_t i = 0; i < algorithm->state_word_count; i++)
+        fprintf(file, "%08" PRIx32, hash[i]);
+    fprintf(file, "\n");
+
+    bool saved = fclose(file) == 0 && rename(tmp_path, path) == 0;
+    if (!saved)
+        remove(tmp_path);
+    free(tmp_path);
+    return saved;
+}
+
+bool checkpoint_load(const char * path, const ft_ssl_algorithm_t * algorithm, uint32_t hash[FT_SSL_MAX_STATE_WORDS], size_t * offset) {
+
+    FILE * file = fopen(path, "r");
+    if (!file)
+        return false;
+
+    char name[16];
+    char state[FT_SSL_MAX_STATE_WORDS * 8 + 1];
+    const int fields = fscanf(file, "%15s %zu %128[0-9a-f]", name, offset, state);
+    fclose(file);
+
+    // Only full blocks are part of a midstate
+    if (fields != 3 || strcmp(name, algorithm->lower_name) != 0 || *offset % algorithm->block_size != 0
+        || strlen(state) != algorithm->state_word_count * 8)
+        return false;
+
+    for (size_t i = 0; i < algorithm->state_word_count; i++) {
+        char word[9];
+        memcpy(word, state + 8 * i, 8);
+        word[8] = '\0';
+        hash[i] = (uint32_t)strtoul(word, NULL, 16);
+    }
+    return true;
+}
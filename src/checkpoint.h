@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdbool.h> // for bool
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint32_t
+
+#include "ft_ssl.h" // for ft_ssl_algorithm_t
+
+/// @brief Save the midstate of a message after its last full block
+/// @details The file holds a single line: "<algorithm> <offset> <state words in hex>". It is written
+///          to a temporary file renamed over `path`, so that an interrupted run keeps the previous one.
+/// @return false (with errno set) if the file could not be written
+bool checkpoint_save(const char * path, const ft_ssl_algorithm_t * algorithm, const uint32_t hash[FT_SSL_MAX_STATE_WORDS], size_t offset);
+
+/// @brief Load a midstate saved by checkpoint_save for the same algorithm
+/// @return false if the file could not be read or is not a checkpoint of `algorithm`
+bool checkpoint_load(const char * path, const ft_ssl_algorithm_t * algorithm, uint32_t hash[FT_SSL_MAX_STATE_WORDS], size_t * offset);
@@ -0,0 +1,255 @@
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "client.h"
+#include "digest.h"
+#include "output.h"
+#include "serve.h"
+#include "utils.h"
+
+/// @brief An input sent to the server, printed once its answer arrives
+typedef struct {
+    char * name;        ///< File name, or string, as printed
+    bool is_string;     ///< The -s string rather than a file
+    int error;          ///< errno value if the input could not be sent
+    bool is_stdin;      ///< Printed as stdin, neither a file nor a string
+} client_input_t;
+
+/// @brief Options and connection of the client subcommand
+typedef struct {
+    const char * socket_path;   ///< Socket of the server
+    char * string;              ///< -s argument (optional)
+    ft_ssl_context_t * context; ///< Algorithm and -q, -r, -s options, for ft_ssl_print
+    int fd;                     ///< Connected socket
+    FILE * answers;             ///< Buffered reader of the socket
+} client_t;
+
+enum {
+    LONG_OPTION_SOCKET = 256,
+};
+
+static const struct option client_long_options[] = {
+    {"socket", required_argument, NULL, LONG_OPTION_SOCKET},
+    {NULL, 0, NULL, 0}
+};
+
+static void client_usage(void) {
+    fprintf(stderr, "Usage: ft_ssl client --socket path algorithm [-q] [-r] [-s string] [file...]\n");
+    fprintf(stderr, "  --socket path  socket of a running `ft_ssl serve`\n");
+    fprintf(stderr, "  -q             print the digests only\n");
+    fprintf(stderr, "  -r             print the digest before the input name\n");
+    fprintf(stderr, "  -s string      hash the string, before the files\n");
+}
+
+static bool client_connect(client_t * client) {
+
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    if (strlen(client->socket_path) >= sizeof(address.sun_path)) {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    strcpy(address.sun_path, client->socket_path);
+
+    client->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (client->fd == -1 || connect(client->fd, (struct sockaddr *)&address, sizeof(address)) == -1)
+        return false;
+    const int fd = dup(client->fd);
+    if (fd == -1 || !(client->answers = fdopen(fd, "r")))
+        return false;
+    return true;
+}
+
+/// @brief Send a data request
+static void client_send_data(client_t * client, const char * algorithm, const uint8_t * data, size_t size) {
+    char line[64];
+    const int length = snprintf(line, sizeof(line), "%.16s data %zu\n", algorithm, size);
+    write_all(client->fd, (const uint8_t *)line, (size_t)length);
+    write_all(client->fd, data, size);
+}
+
+/// @brief Send a file request, with an absolute path: the server does not share our working directory
+/// @return 0, or the errno value of the path resolution
+static int client_send_file(client_t * client, const char * algorithm, const char * filename) {
+    char path[PATH_MAX];
+    if (!realpath(filename, path))
+        return errno;
+    if (strchr(path, '\n'))
+        return EINVAL;
+    char line[SERVE_MAX_LINE + 1];
+    const int length = snprintf(line, sizeof(line), "%.16s file %s\n", algorithm, path);
+    if (length < 0 || (size_t)length > SERVE_MAX_LINE)
+        return ENAMETOOLONG;
+    write_all(client->fd, (const uint8_t *)line, (size_t)length);
+    return 0;
+}
+
+/// @brief Read the answer of the oldest input in flight and print it as ft_ssl would
+/// @return false if the input could not be hashed
+static bool client_print(client_t * client, const char * algorithm, const client_input_t * input) {
+
+    ft_ssl_context_t * context = client->context;
+    const size_t word_count = ((const ft_ssl_algorithm_t *)context->entry.data)->word_count;
+
+    if (input->error) {
+        fprintf(stderr, "ft_ssl: %s: %s: %s\n", algorithm, input->name, strerror(input->error));
+        return false;
+    }
+
+    char answer[2 * FT_SSL_MAX_DIGEST_SIZE + 256];
+    if (!fgets(answer, sizeof(answer), client->answers)) {
+        fprintf(stderr, "ft_ssl: client: %s: connection closed by the server\n", input->name);
+        exit(EXIT_FAILURE);
+    }
+    answer[strcspn(answer, "\n")] = '\0';
+
+    if (strncmp(answer, "error: ", 7) == 0) {
+        fprintf(stderr, "ft_ssl: %s: %s: %s\n", algorithm, input->name, answer + 7);
+        return false;
+    }
+    if (strlen(answer) != word_count * 8 || !ft_ssl_parse_hash(answer, word_count, context->hash)) {
+        fprintf(stderr, "ft_ssl: client: %s: malformed answer from the server\n", input->name);
+        exit(EXIT_FAILURE);
+    }
+
+    context->filename = input->is_string || input->is_stdin ? NULL : input->name;
+    context->p_message = input->is_string ? input->name : NULL;
+    ft_ssl_print(context, input->is_stdin ? stdin : NULL);
+    return true;
+}
+
+/// @brief Read all of stdin
+static uint8_t * client_read_stdin(size_t * size) {
+
+    size_t capacity = 64 * 1024;
+    uint8_t * data = malloc(capacity);
+    *size = 0;
+    for (;;) {
+        if (!data) {
+            perror("malloc");
+            exit(EXIT_FAILURE);
+        }
+        const ssize_t read_size = read(STDIN_FILENO, data + *size, capacity - *size);
+        if (read_size == -1 && errno == EINTR)
+            continue;
+        if (read_size <= 0)
+            return data;
+        *size += (size_t)read_size;
+        if (*size == capacity)
+            data = realloc(data, capacity *= 2);
+    }
+}
+
+/// @brief Parse the options up to the next operand
+/// @return false on an unknown option
+static bool client_parse_options(client_t * client, int ac, char ** av) {
+
+    int opt;
+    while ((opt = getopt_long(ac, av, "+qrs:", client_long_options, NULL)) != -1) {
+        switch (opt) {
+            case LONG_OPTION_SOCKET:
+                client->socket_path = optarg;
+                break;
+            case 'q':
+                SET_OPTION_Q(client->context->options);
+                break;
+            case 'r':
+                SET_OPTION_R(client->context->options);
+                break;
+            case 's':
+                SET_OPTION_S(client->context->options);
+                client->string = optarg;
+                break;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+int client_main(int ac, char ** av) {
+
+    ft_ssl_context_t context;
+    memset(&context, 0, sizeof(context));
+    context.algorithm_count = 1;
+    client_t client = {NULL, NULL, &context, -1, NULL};
+
+    // Options go before or after the algorithm
+    if (!client_parse_options(&client, ac, av) || optind >= ac || !ft_ssl_algorithm(av[optind])) {
+        client_usage();
+        return EXIT_FAILURE;
+    }
+    const char * algorithm = av[optind++];
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wcast-qual"
+    context.entry.data = (ft_ssl_algorithm_t *)ft_ssl_algorithm(algorithm);
+    #pragma GCC diagnostic pop
+
+    // The lines wait in the output buffer, as they do for the other commands
+    atexit(output_flush);
+    if (!client_parse_options(&client, ac, av) || !client.socket_path) {
+        client_usage();
+        return EXIT_FAILURE;
+    }
+
+    if (!client_connect(&client)) {
+        fprintf(stderr, "ft_ssl: client: %s: %s\n", client.socket_path, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    // The string, then the files, or stdin alone
+    const size_t count = (size_t)(ac - optind) + (client.string ? 1 : 0);
+    const bool from_stdin = count == 0;
+    client_input_t * inputs = calloc(from_stdin ? 1 : count, sizeof(client_input_t));
+    if (!inputs) {
+        perror("calloc");
+        return EXIT_FAILURE;
+    }
+
+    bool ok = true;
+    if (from_stdin) {
+        size_t size;
+        uint8_t * data = client_read_stdin(&size);
+        static char stdin_name[] = "stdin";
+        inputs[0] = (client_input_t){stdin_name, false, size > SERVE_MAX_PAYLOAD ? EFBIG : 0, true};
+        if (!inputs[0].error)
+            client_send_data(&client, algorithm, data, size);
+        free(data);
+        ok = client_print(&client, algorithm, &inputs[0]);
+    } else {
+
+        // Keep a window of requests in flight, the oldest answer is printed first
+        size_t sent = 0;
+        size_t printed = 0;
+        while (printed < count) {
+            for (; sent < count && sent - printed < CLIENT_WINDOW; sent++) {
+                client_input_t * input = &inputs[sent];
+                if (client.string && sent == 0) {
+                    *input = (client_input_t){client.string, true, 0, false};
+                    const size_t size = strlen(client.string);
+                    if (size > SERVE_MAX_PAYLOAD)
+                        input->error = EFBIG;
+                    else
+                        client_send_data(&client, algorithm, (const uint8_t *)client.string, size);
+                } else {
+                    *input = (client_input_t){av[optind + (int)sent - (client.string ? 1 : 0)], false, 0, false};
+                    input->error = client_send_file(&client, algorithm, input->name);
+                }
+            }
+            ok = client_print(&client, algorithm, &inputs[printed++]) && ok;
+        }
+    }
+
+    free(inputs);
+    fclose(client.answers);
+    close(client.fd);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
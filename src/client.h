@@ -0,0 +1,12 @@
+#pragma once
+
+/// @brief Requests sent ahead of their answers
+#define CLIENT_WINDOW 32
+
+/// @brief `ft_ssl client --socket path algorithm [-q] [-r] [-s string] [file...]`: hash through a running `ft_ssl serve`
+/// @details Prints a line per input, in argument order, in the formats of ft_ssl_print: `SHA256(file)= <digest>`,
+/// `<digest> *file` with -r, the bare digest with -q. Stdin is sent when there is neither a string nor a file.
+/// @param ac Argument count, starting at "client"
+/// @param av Arguments, starting at "client"
+/// @return The exit status
+int client_main(int ac, char ** av);
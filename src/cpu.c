@@ -0,0 +1,58 @@
+#include <stdint.h>
+
+#include "cpu.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+
+/// @brief Read the XCR0 register to check which register states the OS saves
+static uint64_t cpu_xgetbv(void) {
+    uint32_t eax;
+    uint32_t edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t)edx << 32) | eax;
+}
+
+static uint32_t cpu_detect(void) {
+
+    uint32_t eax, ebx, ecx, edx;
+    uint32_t features = 0;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return 0;
+
+    if (ecx & bit_SSE4_1)
+        features |= CPU_FEATURE_SSE41;
+
+    // AVX2 needs the OS to save the YMM registers (XCR0 bits 1 and 2)
+    const int has_osxsave = (ecx & bit_OSXSAVE) != 0;
+    const int has_ymm = has_osxsave && (cpu_xgetbv() & 0x6) == 0x6;
+
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+        return features;
+
+    if (has_ymm && (ebx & bit_AVX2))
+        features |= CPU_FEATURE_AVX2;
+
+    // The SHA-NI kernel also relies on SSE4.1 (blend) and SSSE3 (shuffle)
+    if ((ebx & bit_SHA) && (features & CPU_FEATURE_SSE41))
+        features |= CPU_FEATURE_SHA;
+
+    return features;
+}
+#else
+static uint32_t cpu_detect(void) {
+    return 0;
+}
+#endif
+
+uint32_t cpu_features(void) {
+    static uint32_t features;
+    static int detected;
+
+    if (!detected) {
+        features = cpu_detect();
+        detected = 1;
+    }
+    return features;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdint.h> // for uint32_t
+
+/// @brief CPU features relevant to the hashing kernels
+#define CPU_FEATURE_SSE41 (1 << 0) // SSE4.1
+#define CPU_FEATURE_AVX2 (1 << 1)  // AVX2 (with OS support for YMM state)
+#define CPU_FEATURE_SHA (1 << 2)   // SHA extensions (SHA-NI)
+
+#define HAS_CPU_FEATURE(features, feature) (((features) & (feature)) == (feature))
+
+/// @brief Detect the features of the running CPU (cached after the first call)
+uint32_t cpu_features(void);
@@ -0,0 +1,149 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "blake3.h"
+#include "digest.h"
+#include "md5.h"
+#include "md5_mb.h"
+#include "sha256.h"
+#include "sha256_mb.h"
+#include "sha512.h"
+
+const ft_ssl_algorithm_t ft_ssl_algorithms[] = {
+    {"md5", "MD5", 4, BLOCK_SIZE, 4, NULL, md5_short, md5_init, md5_pad, md5_update, md5_final, NULL, md5_kernels},
+    {"sha256", "SHA256", 8, BLOCK_SIZE, 8, sha256_many, sha256_short, sha256_init, sha256_pad, sha256_update, NULL, NULL, sha256_kernels},
+    {"sha384", "SHA384", 12, SHA512_BLOCK_SIZE, 16, NULL, NULL, sha384_init, sha512_pad, sha512_update, NULL, NULL, sha512_kernels},
+    {"sha512", "SHA512", 16, SHA512_BLOCK_SIZE, 16, NULL, NULL, sha512_init, sha512_pad, sha512_update, NULL, NULL, sha512_kernels},
+    {"sha512-256", "SHA512-256", 8, SHA512_BLOCK_SIZE, 16, NULL, NULL, sha512_256_init, sha512_pad, sha512_update, NULL, NULL, sha512_kernels},
+    {"blake3", "BLAKE3", 8, BLAKE3_BLOCK_LEN, 0, NULL, NULL, NULL, NULL, NULL, NULL, &blake3_digest, blake3_kernels},
+    {NULL, NULL, 0, 0, 0, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL}
+};
+
+const ft_ssl_algorithm_t * ft_ssl_algorithm(const char * name) {
+    for (const ft_ssl_algorithm_t * algorithm = ft_ssl_algorithms; algorithm->lower_name; algorithm++)
+        if (strcmp(algorithm->lower_name, name) == 0)
+            return algorithm;
+    return NULL;
+}
+
+void ft_ssl_digest_init(ft_ssl_digest_t * digest, const ft_ssl_algorithm_t * algorithm) {
+    digest->algorithm = algorithm;
+    if (algorithm->hasher)
+        algorithm->hasher->init(&digest->hasher);
+    else
+        algorithm->init(digest->hash);
+    digest->block_size = 0;
+    digest->message_size = 0;
+}
+
+void ft_ssl_digest_resume(ft_ssl_digest_t * digest, const ft_ssl_algorithm_t * algorithm, const uint32_t hash[FT_SSL_MAX_STATE_WORDS], size_t offset) {
+    digest->algorithm = algorithm;
+    memcpy(digest->hash, hash, sizeof(digest->hash));
+    digest->block_size = 0;
+    digest->message_size = offset;
+}
+
+void ft_ssl_digest_update(ft_ssl_digest_t * digest, const void * data, size_t size) {
+
+    const uint8_t * bytes = data;
+    digest->message_size += size;
+
+    if (digest->algorithm->hasher) {
+        digest->algorithm->hasher->update(&digest->hasher, bytes, size);
+        return;
+    }
+
+    // Complete the pending partial block first
+    if (digest->block_size) {
+        const size_t missing = digest->algorithm->block_size - digest->block_size;
+        const size_t copied = size < missing ? size : missing;
+        memcpy(digest->block + digest->block_size, bytes, copied);
+        digest->block_size += copied;
+        bytes += copied;
+        size -= copied;
+        if (digest->block_size < digest->algorithm->block_size)
+            return;
+        digest->algorithm->update(digest->block, digest->block_size, digest->hash);
+        digest->block_size = 0;
+    }
+
+    const size_t full_size = size - size % digest->algorithm->block_size;
+    if (full_size)
+        digest->algorithm->update(bytes, full_size, digest->hash);
+
+    digest->block_size = size - full_size;
+    memcpy(digest->block, bytes + full_size, digest->block_size);
+}
+
+size_t ft_ssl_digest_final(ft_ssl_digest_t * digest, uint8_t * out) {
+
+    const ft_ssl_algorithm_t * algorithm = digest->algorithm;
+
+    if (algorithm->hasher) {
+        algorithm->hasher->final(&digest->hasher, digest->hash);
+    } else {
+        uint8_t chunk[CHUNK_SIZE_TOTAL];
+        size_t chunk_size = digest->block_size;
+        memcpy(chunk, digest->block, chunk_size);
+        algorithm->pad(chunk, &chunk_size, digest->message_size);
+        algorithm->update(chunk, chunk_size, digest->hash);
+        if (algorithm->final)
+            algorithm->final(digest->hash);
+    }
+
+    if (out)
+        ft_ssl_digest_bytes(digest->hash, algorithm->word_count, out);
+    return algorithm->word_count * 4;
+}
+
+ft_ssl_digest_t * ft_ssl_digest_new(const char * name) {
+
+    const ft_ssl_algorithm_t * algorithm = ft_ssl_algorithm(name);
+    if (!algorithm)
+        return NULL;
+
+    ft_ssl_digest_t * digest = malloc(sizeof(ft_ssl_digest_t));
+    if (digest)
+        ft_ssl_digest_init(digest, algorithm);
+    return digest;
+}
+
+void ft_ssl_digest_free(ft_ssl_digest_t * digest) {
+    free(digest);
+}
+
+void ft_ssl_hash_buffer(const ft_ssl_algorithm_t * algorithm, const uint8_t * data, size_t size, uint32_t hash[FT_SSL_MAX_STATE_WORDS]) {
+
+    if (algorithm->hasher) {
+        ft_ssl_digest_t digest;
+        ft_ssl_digest_init(&digest, algorithm);
+        ft_ssl_digest_update(&digest, data, size);
+        ft_ssl_digest_final(&digest, NULL);
+        memcpy(hash, digest.hash, algorithm->word_count * sizeof(uint32_t));
+        return;
+    }
+
+    uint8_t chunk[CHUNK_SIZE_TOTAL];
+    const size_t full_size = size - size % algorithm->block_size;
+
+    algorithm->init(hash);
+    algorithm->update(data, full_size, hash);
+
+    size_t chunk_size = size - full_size;
+    memcpy(chunk, data + full_size, chunk_size);
+    algorithm->pad(chunk, &chunk_size, size);
+    algorithm->update(chunk, chunk_size, hash);
+
+    if (algorithm->final)
+        algorithm->final(hash);
+}
+
+void ft_ssl_digest_bytes(const uint32_t * hash, size_t word_count, uint8_t * digest) {
+    for (size_t i = 0; i < word_count; i++) {
+        digest[4 * i] = (uint8_t)(hash[i] >> 24);
+        digest[4 * i + 1] = (uint8_t)(hash[i] >> 16);
+        digest[4 * i + 2] = (uint8_t)(hash[i] >> 8);
+        digest[4 * i + 3] = (uint8_t)hash[i];
+    }
+}
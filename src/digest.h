@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stddef.h> // for size_t
+#include <stdint.h> // for uint32_t, uint8_t
+
+#include "blake3.h" // for blake3_hasher_t
+#include "ft_ssl.h" // for ft_ssl_algorithm_t, FT_SSL_MAX_BLOCK_SIZE, FT_SSL_MAX_STATE_WORDS
+
+/// @brief Largest digest size in bytes (SHA-512)
+#define FT_SSL_MAX_DIGEST_SIZE 64
+
+/// @brief Incremental hash of a message fed in pieces of any size
+typedef struct {
+    const ft_ssl_algorithm_t * algorithm; ///< Algorithm of the digest
+    uint32_t hash[FT_SSL_MAX_STATE_WORDS];  ///< Running state (the hash words once finalized)
+    uint8_t block[FT_SSL_MAX_BLOCK_SIZE];   ///< Bytes of the current partial block
+    size_t block_size;                    ///< Number of bytes in `block`
+    size_t message_size;                  ///< Number of bytes fed so far
+    union {
+        blake3_hasher_t blake3;
+    } hasher;                             ///< State of the algorithms with their own hasher
+} ft_ssl_digest_t;
+
+/// @brief Supported algorithms, terminated by an entry with a NULL name
+extern const ft_ssl_algorithm_t ft_ssl_algorithms[];
+
+/// @brief Find an algorithm by its lowercase name
+/// @return NULL if there is no such algorithm
+const ft_ssl_algorithm_t * ft_ssl_algorithm(const char * name);
+
+/// @brief Start a new message
+void ft_ssl_digest_init(ft_ssl_digest_t * digest, const ft_ssl_algorithm_t * algorithm);
+
+/// @brief Continue a message from a midstate saved after `offset` bytes (a multiple of the block size)
+/// @note Only for the algorithms with a midstate (state_word_count > 0)
+void ft_ssl_digest_resume(ft_ssl_digest_t * digest, const ft_ssl_algorithm_t * algorithm, const uint32_t hash[FT_SSL_MAX_STATE_WORDS], size_t offset);
+
+/// @brief Feed the next `size` bytes of the message (full blocks are hashed in place, without a copy)
+void ft_ssl_digest_update(ft_ssl_digest_t * digest, const void * data, size_t size);
+
+/// @brief Pad the message and write its digest to `out` (if not NULL), leaving the hash words in digest->hash
+/// @return The digest size in bytes
+size_t ft_ssl_digest_final(ft_ssl_digest_t * digest, uint8_t * out);
+
+/// @brief Allocate and start a digest, for callers that do not know its size (FFI)
+/// @return NULL if the algorithm does not exist or the allocation failed
+ft_ssl_digest_t * ft_ssl_digest_new(const char * name);
+
+/// @brief Free a digest returned by ft_ssl_digest_new
+void ft_ssl_digest_free(ft_ssl_digest_t * digest);
+
+/// @brief Hash a whole message held in memory
+void ft_ssl_hash_buffer(const ft_ssl_algorithm_t * algorithm, const uint8_t * data, size_t size, uint32_t hash[FT_SSL_MAX_STATE_WORDS]);
+
+/// @brief Serialize hash words into the digest bytes, in output order
+void ft_ssl_digest_bytes(const uint32_t * hash, size_t word_count, uint8_t * digest);
@@ -0,0 +1,337 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "digest.h"
+#include "dupes.h"
+#include "output.h"
+#include "pool.h"
+#include "utils.h"
+#include "walk.h"
+
+/// @brief A file of the walk, until it has a size or a digest of its own
+typedef struct {
+    ft_ssl_job_t job; ///< File to hash (the filename is owned by the entry), and its prefix or full digest
+    size_t size;      ///< File size
+    dev_t dev;        ///< Device, to recognize hard links
+    ino_t ino;        ///< Inode
+    size_t order;     ///< Position in the walk, to print the files of a group in walk order
+    bool prefix;      ///< The job hashes the prefix only
+    size_t read;      ///< Bytes read so far, each once (the full digest resumes after the prefix)
+    uint32_t midstate[FT_SSL_MAX_STATE_WORDS]; ///< Hash words after the prefix, to resume from (larger files)
+} dupes_entry_t;
+
+/// @brief Counters for the summary
+typedef struct {
+    size_t files;     ///< Distinct files found
+    size_t groups;    ///< Groups of duplicates
+    size_t redundant; ///< Files beyond the first one of each group
+    size_t wasted;    ///< Bytes of the redundant files
+    size_t total;     ///< Bytes of every file
+    size_t read;      ///< Bytes read, each once: the full digests resume after the prefix
+    size_t skipped;   ///< Bytes never read (the rest of the total)
+} dupes_summary_t;
+
+/// @brief Order by size, then inode, so that the links to the same inode are next to each other
+static int dupes_compare_inode(const void * a, const void * b) {
+    const dupes_entry_t * x = a;
+    const dupes_entry_t * y = b;
+    if (x->size != y->size)
+        return x->size < y->size ? -1 : 1;
+    if (x->dev != y->dev)
+        return x->dev < y->dev ? -1 : 1;
+    if (x->ino != y->ino)
+        return x->ino < y->ino ? -1 : 1;
+    return x->order < y->order ? -1 : x->order > y->order;
+}
+
+/// @brief Order by decreasing size, then digest, then walk order
+static int dupes_compare_hash(const void * a, const void * b) {
+    const dupes_entry_t * x = a;
+    const dupes_entry_t * y = b;
+    if (x->size != y->size)
+        return x->size > y->size ? -1 : 1;
+    const int hash = memcmp(x->job.hash, y->job.hash, sizeof(x->job.hash));
+    if (hash)
+        return hash;
+    return x->order < y->order ? -1 : x->order > y->order;
+}
+
+static bool dupes_same_hash(const dupes_entry_t * x, const dupes_entry_t * y) {
+    return x->size == y->size && memcmp(x->job.hash, y->job.hash, sizeof(x->job.hash)) == 0;
+}
+
+/// @brief Hash the first bytes of a file (the whole file if it is not larger)
+static void dupes_hash_prefix(ft_ssl_context_t * context, dupes_entry_t * entry) {
+
+    const ft_ssl_algorithm_t * algorithm = context->entry.data;
+    uint8_t prefix[DUPES_PREFIX_SIZE];
+    const size_t size = entry->size < sizeof(prefix) ? entry->size : sizeof(prefix);
+
+    const int fd = open(entry->job.filename, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        entry->job.error = errno;
+        return;
+    }
+    while (entry->read < size) {
+        const ssize_t read_size = pread(fd, prefix + entry->read, size - entry->read, (off_t)entry->read);
+        if (read_size == -1 && errno == EINTR)
+            continue;
+        if (read_size == -1)
+            entry->job.error = errno;
+        if (read_size <= 0)
+            break;
+        entry->read += (size_t)read_size;
+    }
+    close(fd);
+
+    // Keep the midstate of a whole prefix, the full digest goes on from there
+    ft_ssl_digest_t digest;
+    ft_ssl_digest_init(&digest, algorithm);
+    ft_ssl_digest_update(&digest, prefix, entry->read);
+    if (entry->read == DUPES_PREFIX_SIZE)
+        memcpy(entry->midstate, digest.hash, sizeof(entry->midstate));
+    ft_ssl_digest_final(&digest, NULL);
+    memcpy(entry->job.hash, digest.hash, sizeof(entry->job.hash));
+}
+
+/// @brief Hash the rest of a file, resuming from the midstate of its prefix
+static void dupes_hash_rest(ft_ssl_context_t * context, dupes_entry_t * entry) {
+
+    const int fd = open(entry->job.filename, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        entry->job.error = errno;
+        return;
+    }
+
+    ft_ssl_digest_t digest;
+    ft_ssl_digest_resume(&digest, context->entry.data, entry->midstate, DUPES_PREFIX_SIZE);
+    for (;;) {
+        const ssize_t read_size = pread(fd, context->chunk, CHUNK_SIZE_READ, (off_t)entry->read);
+        if (read_size == -1 && errno == EINTR)
+            continue;
+        if (read_size == -1)
+            entry->job.error = errno;
+        if (read_size <= 0)
+            break;
+        ft_ssl_digest_update(&digest, context->chunk, (size_t)read_size);
+        entry->read += (size_t)read_size;
+    }
+    close(fd);
+
+    ft_ssl_digest_final(&digest, NULL);
+    memcpy(entry->job.hash, digest.hash, sizeof(entry->job.hash));
+}
+
+static void dupes_hash(ft_ssl_context_t * context, dupes_entry_t * entry) {
+
+    const ft_ssl_algorithm_t * algorithm = context->entry.data;
+    if (entry->prefix) {
+        dupes_hash_prefix(context, entry);
+    } else if (algorithm->state_word_count && entry->read == DUPES_PREFIX_SIZE) {
+        dupes_hash_rest(context, entry);
+    } else {
+        // Without a midstate (BLAKE3, or a file that shrank) the prefix is hashed again, but counted once
+        ft_ssl_hash_job(context, &entry->job);
+        if (!entry->job.error)
+            entry->read = entry->size;
+    }
+
+    // The digests are compared whole
+    memset(entry->job.hash + algorithm->word_count, 0, (FT_SSL_MAX_STATE_WORDS - algorithm->word_count) * sizeof(uint32_t));
+}
+
+/// @brief Main loop of the pool workers (every job is the first member of its entry)
+static void dupes_worker(pool_worker_t * worker) {
+
+    ft_ssl_job_t * job;
+    while ((job = pool_next(worker, true))) {
+        dupes_hash(&worker->context, (dupes_entry_t *)job);
+        pool_complete(worker->pool, job);
+    }
+}
+
+/// @brief Hash the entries (their prefix or their whole file), then drop the ones that could not be read
+/// @return The number of entries left
+static size_t dupes_hash_all(ft_ssl_context_t * context, pool_t * pool, dupes_entry_t * entries, size_t count, bool prefix,
+                             dupes_summary_t * summary, bool * ok) {
+
+    // Count only what this stage reads on top of the previous ones
+    for (size_t i = 0; i < count; i++) {
+        entries[i].prefix = prefix;
+        summary->read -= entries[i].read;
+        entries[i].job.done = false;
+        if (pool)
+            pool_submit(pool, &entries[i].job);
+        else
+            dupes_hash(context, &entries[i]);
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (pool)
+            pool_wait(pool, &entries[i].job);
+        summary->read += entries[i].read;
+        if (entries[i].job.error) {
+            fprintf(stderr, "ft_ssl: %s: %s: %s\n", ((const ft_ssl_algorithm_t *)context->entry.data)->lower_name,
+                    entries[i].job.filename, strerror(entries[i].job.error));
+            free(entries[i].job.filename);
+            *ok = false;
+        } else {
+            entries[kept++] = entries[i];
+        }
+    }
+    return kept;
+}
+
+/// @brief Keep the entries tied with another one, sorted so that ties are next to each other
+/// @return The number of entries left
+static size_t dupes_keep_ties(dupes_entry_t * entries, size_t count, int (*compare)(const void *, const void *),
+                              bool (*tied)(const dupes_entry_t *, const dupes_entry_t *), size_t * skipped) {
+
+    qsort(entries, count, sizeof(dupes_entry_t), compare);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        const bool alone = (i == 0 || !tied(&entries[i - 1], &entries[i])) && (i + 1 == count || !tied(&entries[i], &entries[i + 1]));
+        if (!alone) {
+            entries[kept++] = entries[i];
+            continue;
+        }
+
+        // Its bytes past what was read so far are never read
+        if (entries[i].read < entries[i].size)
+            *skipped += entries[i].size - entries[i].read;
+        free(entries[i].job.filename);
+    }
+    return kept;
+}
+
+static bool dupes_same_size(const dupes_entry_t * x, const dupes_entry_t * y) {
+    return x->size == y->size;
+}
+
+/// @brief Collect the regular files of the walk, each inode once
+/// @return The entries, with their number in `count`
+static dupes_entry_t * dupes_collect(ft_ssl_context_t * context, char ** roots, size_t root_count, size_t * count, bool * ok) {
+
+    const ft_ssl_algorithm_t * algorithm = context->entry.data;
+    walk_t walk;
+    walk_start(&walk, context, roots, root_count);
+
+    size_t capacity = 1024;
+    dupes_entry_t * entries = malloc(capacity * sizeof(dupes_entry_t));
+    *count = 0;
+    char * path;
+    int error;
+    while (entries && walk_next(&walk, &path, &error)) {
+        struct stat st;
+        if (!error && stat(path, &st) == -1)
+            error = errno;
+        if (error || !S_ISREG(st.st_mode)) {
+            fprintf(stderr, "ft_ssl: %s: %s: %s\n", algorithm->lower_name, path, error ? strerror(error) : "not a regular file");
+            free(path);
+            *ok = false;
+            continue;
+        }
+
+        if (*count == capacity) {
+            dupes_entry_t * grown = realloc(entries, (capacity *= 2) * sizeof(dupes_entry_t));
+            if (!grown)
+                free(entries);
+            entries = grown;
+            if (!entries)
+                break;
+        }
+        dupes_entry_t * entry = &entries[(*count)++];
+        memset(entry, 0, sizeof(dupes_entry_t));
+        entry->job.filename = path;
+        entry->size = (size_t)st.st_size;
+        entry->dev = st.st_dev;
+        entry->ino = st.st_ino;
+        entry->order = *count;
+    }
+    walk_stop(&walk);
+    if (!entries) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    // Hard links (and files reached twice) have the same contents for sure: keep the first one walked
+    qsort(entries, *count, sizeof(dupes_entry_t), dupes_compare_inode);
+    size_t kept = 0;
+    for (size_t i = 0; i < *count; i++) {
+        if (kept && entries[kept - 1].dev == entries[i].dev && entries[kept - 1].ino == entries[i].ino)
+            free(entries[i].job.filename);
+        else
+            entries[kept++] = entries[i];
+    }
+    *count = kept;
+    return entries;
+}
+
+bool dupes_find(ft_ssl_context_t * context, char ** roots, size_t root_count) {
+
+    const ft_ssl_algorithm_t * algorithm = context->entry.data;
+    dupes_summary_t summary = {0, 0, 0, 0, 0, 0, 0};
+    bool ok = true;
+
+    size_t count;
+    dupes_entry_t * entries = dupes_collect(context, roots, root_count, &count, &ok);
+    summary.files = count;
+    for (size_t i = 0; i < count; i++)
+        summary.total += entries[i].size;
+
+    pool_t pool;
+    const bool parallel = context->worker_count > 1;
+    if (parallel)
+        pool_start(&pool, context->worker_count, context, dupes_worker);
+
+    // A size of its own, then a prefix of its own: the file has no duplicate
+    count = dupes_keep_ties(entries, count, dupes_compare_inode, dupes_same_size, &summary.skipped);
+    count = dupes_hash_all(context, parallel ? &pool : NULL, entries, count, true, &summary, &ok);
+    count = dupes_keep_ties(entries, count, dupes_compare_hash, dupes_same_hash, &summary.skipped);
+
+    // The prefix of the small files is all of them already, and the large ones come first
+    size_t large = 0;
+    while (large < count && entries[large].size > DUPES_PREFIX_SIZE)
+        large++;
+    const size_t hashed = dupes_hash_all(context, parallel ? &pool : NULL, entries, large, false, &summary, &ok);
+    memmove(entries + hashed, entries + large, (count - large) * sizeof(dupes_entry_t));
+    count -= large - hashed;
+    count = dupes_keep_ties(entries, count, dupes_compare_hash, dupes_same_hash, &summary.skipped);
+
+    if (parallel)
+        pool_stop(&pool);
+
+    // Every group, separated by an empty line
+    for (size_t i = 0; i < count; i++) {
+        const bool first = i == 0 || !dupes_same_hash(&entries[i - 1], &entries[i]);
+        if (first) {
+            if (i)
+                output_write("\n", 1);
+            summary.groups++;
+        } else {
+            summary.redundant++;
+            summary.wasted += entries[i].size;
+        }
+        context->filename = entries[i].job.filename;
+        context->p_message = NULL;
+        memcpy(context->hash, entries[i].job.hash, sizeof(context->hash));
+        ft_ssl_print(context, NULL);
+        free(entries[i].job.filename);
+    }
+    context->filename = NULL;
+    free(entries);
+
+    fprintf(stderr, "ft_ssl: %s: %zu files, %zu groups of duplicates (%zu redundant files, %zu bytes), read %zu of %zu bytes (%zu skipped)\n",
+            algorithm->lower_name, summary.files, summary.groups, summary.redundant, summary.wasted, summary.read, summary.total,
+            summary.skipped);
+    return ok;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdbool.h> // for bool
+#include <stddef.h>  // for size_t
+
+#include "ft_ssl.h" // for ft_ssl_context_t
+
+/// @brief Bytes hashed at the start of the files sharing their size, before reading any of them in full
+#define DUPES_PREFIX_SIZE 4096
+
+/// @brief Print the groups of regular files with identical contents under the file arguments
+/// @details The files are compared in stages, each one only for the files still tied after the previous one:
+///          their size (no read), the digest of their first DUPES_PREFIX_SIZE bytes, then their full digest
+///          (resumed from the midstate of the prefix, so that no byte is read twice, except with BLAKE3).
+///          The prefixes and the full digests are hashed on context->worker_count threads. Hard links to the
+///          same inode count as one file. Groups are printed largest files first, each file as a digest line,
+///          with an empty line between groups; a summary with the bytes read and skipped goes to stderr.
+/// @return false if a file could not be walked or read
+bool dupes_find(ft_ssl_context_t * context, char ** roots, size_t root_count);
@@ -1,5 +1,6 @@
 #include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <getopt.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -8,36 +9,206 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "blake3.h"
+#include "cache.h"
+#include "check.h"
+#include "client.h"
+#include "checkpoint.h"
+#include "digest.h"
+#include "dupes.h"
 #include "ft_ssl.h"
-#include "md5.h"
-#include "sha256.h"
+#include "hmac.h"
+#include "kernel.h"
+#include "lines.h"
+#include "output.h"
+#include "pipeline.h"
+#include "pool.h"
+#include "serve.h"
+#include "speed.h"
+#include "stats.h"
+#include "uring.h"
+#include "utils.h"
+#include "walk.h"
 
-static const ft_ssl_algorithm_t ft_ssl_algorithms[] = {
-    {"md5", "MD5", 4, md5},
-    {"sha256", "SHA256", 8, sha256},
-    {NULL, NULL, 0, NULL}
+/// @brief Values returned by getopt_long for the options that only have a long form
+enum {
+    LONG_OPTION_PIPELINE = 256,
+    LONG_OPTION_BUFFER_SIZE,
+    LONG_OPTION_TREE,
+    LONG_OPTION_LEAF_SIZE,
+    LONG_OPTION_MANIFEST,
+    LONG_OPTION_CHECKPOINT,
+    LONG_OPTION_RESUME,
+    LONG_OPTION_CACHE,
+    LONG_OPTION_FOLLOW_SYMLINKS,
+    LONG_OPTION_ONE_FILE_SYSTEM,
+    LONG_OPTION_INCLUDE,
+    LONG_OPTION_EXCLUDE,
+    LONG_OPTION_STATS,
+    LONG_OPTION_LINES,
+    LONG_OPTION_RAW,
+    LONG_OPTION_ENGINE,
+    LONG_OPTION_FIND_DUPES,
+    LONG_OPTION_IO_URING,
+    LONG_OPTION_QUEUE_DEPTH,
+    LONG_OPTION_HMAC,
+    LONG_OPTION_HMAC_KEYFILE,
+};
+
+static const struct option long_options[] = {
+    {"pipeline", no_argument, NULL, LONG_OPTION_PIPELINE},
+    {"buffer-size", required_argument, NULL, LONG_OPTION_BUFFER_SIZE},
+    {"tree", no_argument, NULL, LONG_OPTION_TREE},
+    {"leaf-size", required_argument, NULL, LONG_OPTION_LEAF_SIZE},
+    {"manifest", required_argument, NULL, LONG_OPTION_MANIFEST},
+    {"checkpoint", required_argument, NULL, LONG_OPTION_CHECKPOINT},
+    {"resume", required_argument, NULL, LONG_OPTION_RESUME},
+    {"cache", required_argument, NULL, LONG_OPTION_CACHE},
+    {"follow-symlinks", no_argument, NULL, LONG_OPTION_FOLLOW_SYMLINKS},
+    {"one-file-system", no_argument, NULL, LONG_OPTION_ONE_FILE_SYSTEM},
+    {"include", required_argument, NULL, LONG_OPTION_INCLUDE},
+    {"exclude", required_argument, NULL, LONG_OPTION_EXCLUDE},
+    {"stats", no_argument, NULL, LONG_OPTION_STATS},
+    {"lines", no_argument, NULL, LONG_OPTION_LINES},
+    {"raw", no_argument, NULL, LONG_OPTION_RAW},
+    {"engine", required_argument, NULL, LONG_OPTION_ENGINE},
+    {"find-dupes", no_argument, NULL, LONG_OPTION_FIND_DUPES},
+    {"io-uring", no_argument, NULL, LONG_OPTION_IO_URING},
+    {"queue-depth", required_argument, NULL, LONG_OPTION_QUEUE_DEPTH},
+    {"hmac", required_argument, NULL, LONG_OPTION_HMAC},
+    {"hmac-keyfile", required_argument, NULL, LONG_OPTION_HMAC_KEYFILE},
+    {NULL, 0, NULL, 0}
 };
 
 static void print_usage(const char * prog_name) {
-    fprintf(stderr, "Usage: %s [md5|sha256] [-p] [-q] [-r] [-s string] [file...]\n", prog_name);
+    fprintf(stderr, "Usage: %s algorithm [-p] [-q] [-r] [-s string] [-j jobs] [options] [file...]\n", prog_name);
+    fprintf(stderr, "       %s algorithm -c [-q] [-j jobs] [manifest...]\n", prog_name);
+    fprintf(stderr, "       %s algorithm --lines|-0 [file...]\n", prog_name);
+    fprintf(stderr, "       %s algorithm --find-dupes [-j jobs] file...\n", prog_name);
+    fprintf(stderr, "       %s speed [--duration seconds] [--warmup seconds] [--cpu n] [--engine name] [--json] [algorithm...]\n", prog_name);
+    fprintf(stderr, "       %s serve --socket path [-j jobs]\n", prog_name);
+    fprintf(stderr, "       %s client --socket path algorithm [-q] [-r] [-s string] [file...]\n", prog_name);
+    fprintf(stderr, "  algorithm           md5, sha256, sha384, sha512, sha512-256 or blake3, or a comma-separated list\n");
+    fprintf(stderr, "                      of distinct ones hashed in one pass (one line per algorithm for every input)\n");
+    fprintf(stderr, "  -c                  verify the digests listed in each manifest (either output format, - for stdin)\n");
+    fprintf(stderr, "  --lines             hash every line of stdin (or of the file arguments) on its own, one digest per line\n");
+    fprintf(stderr, "  -0                  like --lines, with NUL-delimited records\n");
+    fprintf(stderr, "  --find-dupes        print the groups of identical files under the arguments, reading a file in full only\n");
+    fprintf(stderr, "                      if another one has the same size and the same first %d bytes\n", DUPES_PREFIX_SIZE);
+    fprintf(stderr, "  --raw               print the bare digest bytes of every input, without names or newlines\n");
+    fprintf(stderr, "  -R                  hash the files under directory arguments, sorted by name within each directory\n");
+    fprintf(stderr, "  -j jobs             number of files hashed in parallel (default: number of online CPUs)\n");
+    fprintf(stderr, "  --pipeline          read inputs on a separate thread, overlapping I/O and hashing\n");
+    fprintf(stderr, "  --buffer-size size  size of each pipeline buffer, with an optional K/M/G suffix (default 4M)\n");
+    fprintf(stderr, "  --tree              tree hash: hash of the digests of the leaves, hashed in parallel, labelled\n");
+    fprintf(stderr, "                      with the leaf size (SHA256-TREE-4M(file)= ...)\n");
+    fprintf(stderr, "  --leaf-size size    size of the leaves in tree mode, with an optional K/M/G suffix (default 4M)\n");
+    fprintf(stderr, "  --manifest file     write the digest, offset and size of every leaf to file in tree mode\n");
+    fprintf(stderr, "  --checkpoint file   save the midstate of the file argument after its last full block\n");
+    fprintf(stderr, "  --resume file       hash the file argument from a checkpoint, reading only the bytes after it\n");
+    fprintf(stderr, "  --cache file        reuse the digests of unchanged file arguments, keyed on their inode metadata\n");
+    fprintf(stderr, "  --follow-symlinks   follow symlinks under directory arguments (skipped by default) with -R\n");
+    fprintf(stderr, "  --one-file-system   do not walk into other filesystems with -R\n");
+    fprintf(stderr, "  --include glob      only hash the files whose name (or path, if glob has a /) matches with -R\n");
+    fprintf(stderr, "  --exclude glob      skip the files and directories whose name (or path) matches with -R\n");
+    fprintf(stderr, "  --stats             report bytes, reads, I/O and hashing time per input and in total to stderr\n");
+    fprintf(stderr, "  --engine name       implementation of the algorithms: reference, unrolled, or a SIMD one such as\n");
+    fprintf(stderr, "                      shani or avx2 (default: the fastest this CPU runs that passes its self-test)\n");
+    fprintf(stderr, "  --hmac key          print the HMAC of every input with key instead of its digest\n");
+    fprintf(stderr, "  --hmac-keyfile file like --hmac, with the bytes of file as the key\n");
+    fprintf(stderr, "  --io-uring          open, stat and read many files at a time through io_uring, if the kernel has it\n");
+    fprintf(stderr, "  --queue-depth n     number of files in flight per job with --io-uring (default %d)\n", URING_QUEUE_DEPTH);
 }
 
 static void print_missing_argument(const char * prog_name) {
     fprintf(stderr, "%s: option -s requires an argument\n", prog_name);
 }
 
+static void print_checkpoint_usage(const char * prog_name) {
+    fprintf(stderr, "%s: --checkpoint and --resume need a single file argument, without --tree or -R, and an algorithm with a midstate\n", prog_name);
+}
+
+static void print_cache_usage(const char * prog_name) {
+    fprintf(stderr, "%s: --cache cannot be combined with --tree, --checkpoint or --resume\n", prog_name);
+}
+
+static void print_stats_usage(const char * prog_name) {
+    fprintf(stderr, "%s: --stats cannot be combined with --tree\n", prog_name);
+}
+
+static void print_lines_usage(const char * prog_name) {
+    fprintf(stderr, "%s: --lines and -0 cannot be combined with -p, -s, -c, -R, --tree, --checkpoint or --resume\n", prog_name);
+}
+
+static void print_raw_usage(const char * prog_name) {
+    fprintf(stderr, "%s: --raw cannot be combined with -c\n", prog_name);
+}
+
+static void print_check_usage(const char * prog_name) {
+    fprintf(stderr, "%s: -c cannot be combined with -p or -s\n", prog_name);
+}
+
+static void print_algorithms_usage(const char * prog_name) {
+    fprintf(stderr, "%s: a list of algorithms cannot be combined with -p, -c, --lines, -0, --tree, --checkpoint, --resume or --cache\n", prog_name);
+}
+
+static void print_find_dupes_usage(const char * prog_name) {
+    fprintf(stderr, "%s: --find-dupes needs file arguments and a single algorithm, and cannot be combined with -p, -s, -c, --lines, -0, --raw, --tree, --checkpoint, --resume, --cache or --stats\n", prog_name);
+}
+
+static void print_io_uring_usage(const char * prog_name) {
+    fprintf(stderr, "%s: --io-uring cannot be combined with -c, --lines, -0, --find-dupes, --tree, --checkpoint, --resume, --cache or --stats\n", prog_name);
+}
+
+static void print_hmac_usage(const char * prog_name) {
+    fprintf(stderr, "%s: --hmac and --hmac-keyfile need a single algorithm with a midstate (not blake3), and cannot be combined with --find-dupes, --tree, --checkpoint, --resume or --cache\n", prog_name);
+}
+
+static void print_invalid_argument(const char * arg) {
+    fprintf(stderr, "ft_ssl: invalid argument: '%s'\n", arg);
+}
+
 static void exit_error(void (*f)(const char *), const char * prog_name) {
     f(prog_name);
     exit(EXIT_FAILURE);
 }
 
+/// @brief Parse a byte count with an optional K, M or G (binary) suffix
+/// @return false if the string is not a positive size
+static bool parse_size(const char * str, size_t * size) {
+
+    if (!isdigit((unsigned char)*str))
+        return false;
+
+    char * end;
+    errno = 0;
+    unsigned long long value = strtoull(str, &end, 10);
+    if (errno || value == 0)
+        return false;
+
+    unsigned int shift = 0;
+    switch (toupper((unsigned char)*end)) {
+        case 'K': shift = 10; end++; break;
+        case 'M': shift = 20; end++; break;
+        case 'G': shift = 30; end++; break;
+        default: break;
+    }
+    if (*end || value > (SIZE_MAX >> shift))
+        return false;
+
+    *size = (size_t)(value << shift);
+    return true;
+}
+
 static void ft_ssl_init(ft_ssl_context_t * context, int ac, char ** av) {
 
     if (ac < 2)
         exit_error(print_usage, av[0]);
 
     // Initialize the hash table
-    size_t table_size = 2; // Number of algorithms
+    size_t table_size = 0; // Number of algorithms
+    while (ft_ssl_algorithms[table_size].lower_name)
+        table_size++;
     if (hcreate(table_size) == 0)
         exit_error(perror, "hcreate");
 
@@ -52,22 +223,47 @@ static void ft_ssl_init(ft_ssl_context_t * context, int ac, char ** av) {
         hsearch(item, ENTER);
     }
 
-    // Check if the hash type is valid
-    item.key = av[optind];
-    ENTRY * item_found = hsearch(item, FIND);
-    if (!item_found)
-        exit_error(print_usage, av[0]);
+    // Initialize the context
+    memset(context, 0, sizeof(ft_ssl_context_t));
+
+    // Check if the hash type is valid: a name, or a comma-separated list of names hashed in one pass
+    const char * name = av[optind];
+    for (;;) {
+        char key[32];
+        const size_t length = strcspn(name, ",");
+        if (length >= sizeof(key) || context->algorithm_count == FT_SSL_MAX_ALGORITHMS)
+            exit_error(print_usage, av[0]);
+        memcpy(key, name, length);
+        key[length] = '\0';
+        item.key = key;
+        ENTRY * item_found = hsearch(item, FIND);
+        if (!item_found)
+            exit_error(print_usage, av[0]);
+
+        // The same algorithm twice would print every input twice
+        for (size_t i = 0; i < context->algorithm_count; i++)
+            if (context->algorithms[i] == item_found->data)
+                exit_error(print_usage, av[0]);
+        if (context->algorithm_count == 0)
+            context->entry = *item_found;
+        context->algorithms[context->algorithm_count++] = item_found->data;
+        if (!name[length])
+            break;
+        name += length + 1;
+    }
 
     // Skip the hash name argument
     optind++;
 
-    // Initialize the context
-    memset(context, 0, sizeof(ft_ssl_context_t));
-    context->entry = *item_found;
+    context->buffer_size = PIPELINE_BUFFER_SIZE;
+    context->leaf_size = TREE_LEAF_SIZE;
+    const long online_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    context->worker_count = online_cpus > 0 ? (size_t)online_cpus : 1;
+    context->queue_depth = URING_QUEUE_DEPTH;
 
     // Parse the options
     int opt;
-    while ((opt = getopt(ac, av, "+pqrs:")) != -1) {
+    while ((opt = getopt_long(ac, av, "+pqrs:j:cR0", long_options, NULL)) != -1) {
         switch (opt) {
             case 'p':
                 SET_OPTION_P(context->options);
@@ -84,64 +280,377 @@ static void ft_ssl_init(ft_ssl_context_t * context, int ac, char ** av) {
                     exit_error(print_missing_argument, av[0]);
                 context->p_message = optarg;
                 break;
+            case 'c':
+                SET_OPTION_CHECK(context->options);
+                break;
+            case 'R':
+                SET_OPTION_RECURSIVE(context->options);
+                break;
+            case '0':
+                SET_OPTION_LINES(context->options);
+                SET_OPTION_NUL(context->options);
+                break;
+            case 'j': {
+                char * end;
+                errno = 0;
+                const unsigned long workers = strtoul(optarg, &end, 10);
+                if (!isdigit((unsigned char)*optarg) || *end || errno || workers == 0 || workers > FT_SSL_MAX_WORKERS)
+                    exit_error(print_invalid_argument, optarg);
+                context->worker_count = workers;
+                break;
+            }
+            case LONG_OPTION_PIPELINE:
+                SET_OPTION_PIPELINE(context->options);
+                break;
+            case LONG_OPTION_BUFFER_SIZE:
+                if (!parse_size(optarg, &context->buffer_size))
+                    exit_error(print_invalid_argument, optarg);
+                // Only the last buffer of an input may end with a partial block
+                context->buffer_size = (context->buffer_size + FT_SSL_MAX_BLOCK_SIZE - 1) / FT_SSL_MAX_BLOCK_SIZE * FT_SSL_MAX_BLOCK_SIZE;
+                break;
+            case LONG_OPTION_TREE:
+                SET_OPTION_TREE(context->options);
+                break;
+            case LONG_OPTION_LEAF_SIZE:
+                if (!parse_size(optarg, &context->leaf_size))
+                    exit_error(print_invalid_argument, optarg);
+                break;
+            case LONG_OPTION_MANIFEST:
+                if (context->manifest)
+                    fclose(context->manifest);
+                context->manifest = fopen(optarg, "w");
+                if (!context->manifest)
+                    exit_error(perror, optarg);
+                break;
+            case LONG_OPTION_CHECKPOINT:
+                context->checkpoint = optarg;
+                break;
+            case LONG_OPTION_RESUME:
+                if (!checkpoint_load(optarg, context->entry.data, context->resume_hash, &context->resume_offset))
+                    exit_error(print_invalid_argument, optarg);
+                SET_OPTION_RESUME(context->options);
+                break;
+            case LONG_OPTION_FOLLOW_SYMLINKS:
+                SET_OPTION_FOLLOW(context->options);
+                break;
+            case LONG_OPTION_ONE_FILE_SYSTEM:
+                SET_OPTION_ONE_FILESYSTEM(context->options);
+                break;
+            case LONG_OPTION_INCLUDE:
+                if (!context->include_globs && !(context->include_globs = calloc((size_t)ac, sizeof(char *))))
+                    exit_error(perror, "calloc");
+                context->include_globs[context->include_count++] = optarg;
+                break;
+            case LONG_OPTION_EXCLUDE:
+                if (!context->exclude_globs && !(context->exclude_globs = calloc((size_t)ac, sizeof(char *))))
+                    exit_error(perror, "calloc");
+                context->exclude_globs[context->exclude_count++] = optarg;
+                break;
+            case LONG_OPTION_LINES:
+                SET_OPTION_LINES(context->options);
+                break;
+            case LONG_OPTION_RAW:
+                SET_OPTION_RAW(context->options);
+                break;
+            case LONG_OPTION_FIND_DUPES:
+                SET_OPTION_FIND_DUPES(context->options);
+                break;
+            case LONG_OPTION_HMAC:
+            case LONG_OPTION_HMAC_KEYFILE: {
+                // The keyed midstates are computed once, for every input
+                const ft_ssl_algorithm_t * algorithm = context->entry.data;
+                if (!algorithm->state_word_count)
+                    exit_error(print_hmac_usage, av[0]);
+                size_t key_size = strlen(optarg);
+                uint8_t * key = opt == LONG_OPTION_HMAC ? (uint8_t *)optarg : hmac_read_key(optarg, &key_size);
+                if (!key)
+                    exit_error(perror, optarg);
+                if (!context->hmac && !(context->hmac = malloc(sizeof(hmac_t))))
+                    exit_error(perror, "malloc");
+                hmac_init(context->hmac, algorithm, key, key_size);
+                if (opt == LONG_OPTION_HMAC_KEYFILE)
+                    free(key);
+                break;
+            }
+            case LONG_OPTION_IO_URING:
+                SET_OPTION_URING(context->options);
+                break;
+            case LONG_OPTION_QUEUE_DEPTH: {
+                char * end;
+                errno = 0;
+                const unsigned long depth = strtoul(optarg, &end, 10);
+                if (!isdigit((unsigned char)*optarg) || *end || errno || depth == 0 || depth > URING_MAX_QUEUE_DEPTH)
+                    exit_error(print_invalid_argument, optarg);
+                context->queue_depth = depth;
+                break;
+            }
+            case LONG_OPTION_ENGINE:
+                for (size_t i = 0; i < context->algorithm_count; i++)
+                    if (!kernel_select(context->algorithms[i], optarg))
+                        exit(EXIT_FAILURE);
+                break;
+            case LONG_OPTION_STATS:
+                if (!context->stats && !(context->stats = stats_new(((ft_ssl_algorithm_t *)context->entry.data)->block_size)))
+                    exit_error(perror, "calloc");
+                break;
+            case LONG_OPTION_CACHE:
+                if (context->cache)
+                    cache_close(context->cache);
+                context->cache = cache_open(optarg);
+                if (!context->cache)
+                    exit_error(perror, optarg);
+                break;
             default:
                 exit_error(print_usage, av[0]);
         }
     }
 }
 
+/// @brief Job source walking an array in order, printing each result as soon as it and all the previous ones are done
+typedef struct {
+    ft_ssl_context_t * context; ///< Context used for printing
+    ft_ssl_job_t * jobs;        ///< Jobs, in argument order
+    size_t count;               ///< Number of jobs
+    size_t next_job;            ///< Next job to hand out
+    size_t next_print;          ///< Next job to print
+} ordered_jobs_t;
+
+static ft_ssl_job_t * ordered_jobs_next(void * arg, bool wait) {
+    ordered_jobs_t * ordered = arg;
+    (void)wait;
+    return ordered->next_job < ordered->count ? &ordered->jobs[ordered->next_job++] : NULL;
+}
+
+static void ordered_jobs_done(void * arg, ft_ssl_job_t * job) {
+    ordered_jobs_t * ordered = arg;
+    job->done = true;
+    for (; ordered->next_print < ordered->count && ordered->jobs[ordered->next_print].done; ordered->next_print++)
+        ft_ssl_print_job(ordered->context, &ordered->jobs[ordered->next_print]);
+}
+
+/// @brief Main loop of the pool workers, each with its own context
+static void hash_worker(pool_worker_t * worker) {
+    ft_ssl_job_source_t source = pool_source(worker);
+    ft_ssl_hash_jobs(&worker->context, &source, IS_OPTION_MANY(worker->context.options));
+}
+
+/// @brief Hash the file arguments, on a pool of workers if there are several, and print them in order
+static void hash_files(ft_ssl_context_t * context, char ** filenames, size_t count) {
+
+    ft_ssl_job_t * jobs = calloc(count, sizeof(ft_ssl_job_t));
+    if (!jobs)
+        exit_error(perror, "calloc");
+    for (size_t i = 0; i < count; i++)
+        jobs[i].filename = filenames[i];
+
+    // The digests of the other algorithms of a list, in rows after each other
+    uint32_t (*other_hashes)[FT_SSL_MAX_STATE_WORDS] = NULL;
+    const size_t other_count = context->algorithm_count - 1;
+    if (other_count) {
+        if (!(other_hashes = calloc(count * other_count, sizeof(*other_hashes))))
+            exit_error(perror, "calloc");
+        for (size_t i = 0; i < count; i++)
+            jobs[i].other_hashes = other_hashes + i * other_count;
+    }
+
+    size_t worker_count = context->worker_count < count ? context->worker_count : count;
+
+    // In tree mode the workers split each file instead, and the leaf digests go to the manifest in order
+    if (IS_OPTION_TREE(context->options))
+        worker_count = 1;
+    // Lanes of the multi-buffer engine are only worth filling with several files per worker
+    // (and they would bypass the cache, the stats, the other algorithms of a list and the HMAC key)
+    else if (count >= 2 * worker_count && !context->cache && !context->stats && !other_count && !context->hmac)
+        SET_OPTION_MANY(context->options);
+
+    if (worker_count == 1) {
+        ordered_jobs_t ordered = {context, jobs, count, 0, 0};
+        ft_ssl_job_source_t source = {ordered_jobs_next, ordered_jobs_done, &ordered};
+        ft_ssl_hash_jobs(context, &source, IS_OPTION_MANY(context->options));
+    } else {
+        pool_t pool;
+        pool_start(&pool, worker_count, context, hash_worker);
+        for (size_t i = 0; i < count; i++)
+            pool_submit(&pool, &jobs[i]);
+
+        // Print in argument order as the workers complete the jobs
+        for (size_t i = 0; i < count; i++) {
+            pool_wait(&pool, &jobs[i]);
+            ft_ssl_print_job(context, &jobs[i]);
+        }
+        pool_stop(&pool);
+    }
+
+    free(other_hashes);
+    free(jobs);
+}
+
+/// @brief Hash each record of stdin, or of every file argument in order
+/// @return false if an input could not be read
+static bool hash_lines(ft_ssl_context_t * context, char ** filenames, size_t count) {
+
+    if (count == 0) {
+        const int error = lines_hash(context, STDIN_FILENO);
+        if (error)
+            ft_ssl_print_error(context, "stdin", error);
+        return !error;
+    }
+
+    bool ok = true;
+    for (size_t i = 0; i < count; i++) {
+        const int fd = open(filenames[i], O_RDONLY);
+        const int error = fd == -1 ? errno : lines_hash(context, fd);
+        if (fd != -1)
+            close(fd);
+        if (error) {
+            ft_ssl_print_error(context, filenames[i], error);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
 int main(int ac, char ** av) {
 
+    // Subcommands come before the algorithm
+    if (ac > 1 && strcmp(av[1], "speed") == 0)
+        return speed_main(ac - 1, av + 1);
+    if (ac > 1 && strcmp(av[1], "serve") == 0)
+        return serve_main(ac - 1, av + 1);
+    if (ac > 1 && strcmp(av[1], "client") == 0)
+        return client_main(ac - 1, av + 1);
+
+    // Digests wait in the output buffer until it fills up, or until the end
+    atexit(output_flush);
+
     ft_ssl_context_t context;
     ft_ssl_init(&context, ac, av);
 
-    // Read from stdin
-    if (!isatty(fileno(stdin)) && (optind >= ac || IS_OPTION_P(context.options)))
-        ((ft_ssl_algorithm_t *)context.entry.data)->f(&context, stdin);
+    // A midstate describes one linear message (BLAKE3 has a stack of subtrees instead)
+    const ft_ssl_algorithm_t * algorithm = context.entry.data;
+    if ((context.checkpoint || IS_OPTION_RESUME(context.options))
+        && (ac - optind != 1 || IS_OPTION_TREE(context.options) || IS_OPTION_RECURSIVE(context.options) || !algorithm->state_word_count))
+        exit_error(print_checkpoint_usage, av[0]);
 
-    // Read from string
-    if (IS_OPTION_S(context.options)) {
+    // The cache holds plain digests of whole files
+    if (context.cache && (context.checkpoint || IS_OPTION_RESUME(context.options) || IS_OPTION_TREE(context.options)))
+        exit_error(print_cache_usage, av[0]);
 
-        // Setup the context
-        context.message_size = 0;
-        context.filename = NULL;
+    // Tree leaves are hashed on the pool, outside of the measured loops
+    if (context.stats && IS_OPTION_TREE(context.options))
+        exit_error(print_stats_usage, av[0]);
+
+    // The manifest checker prints verdicts, not digests
+    if (IS_OPTION_RAW(context.options) && IS_OPTION_CHECK(context.options))
+        exit_error(print_raw_usage, av[0]);
+
+    // The files to verify are named by the manifests, not given as strings or on stdin
+    const uint32_t not_with_check = OPTION_P | OPTION_S;
+    if (IS_OPTION_CHECK(context.options) && (context.options & not_with_check))
+        exit_error(print_check_usage, av[0]);
+
+    // The keyed midstates replace the IV of a single linear message per input
+    const uint32_t not_with_hmac = OPTION_FIND_DUPES | OPTION_TREE | OPTION_RESUME;
+    if (context.hmac && ((context.options & not_with_hmac) || context.algorithm_count > 1 || context.checkpoint || context.cache))
+        exit_error(print_hmac_usage, av[0]);
+
+    // The io_uring engine hashes whole files from their first byte, with neither the cache nor the measured loops
+    const uint32_t not_with_uring = OPTION_CHECK | OPTION_LINES | OPTION_FIND_DUPES | OPTION_TREE | OPTION_RESUME;
+    if (IS_OPTION_URING(context.options) && ((context.options & not_with_uring) || context.checkpoint || context.cache || context.stats))
+        exit_error(print_io_uring_usage, av[0]);
 
-        // Open from memory
-        FILE * file = fmemopen((void *)context.p_message, strlen(context.p_message), "rb");
-        if (!file)
-            exit_error(perror, "fmemopen");
+    // Each digest of a list is printed on its own line, from a single pass over the input
+    const uint32_t not_with_algorithms = OPTION_P | OPTION_CHECK | OPTION_LINES | OPTION_TREE | OPTION_RESUME;
+    if (context.algorithm_count > 1 && ((context.options & not_with_algorithms) || context.checkpoint || context.cache))
+        exit_error(print_algorithms_usage, av[0]);
 
-        // Hash the message
-        ((ft_ssl_algorithm_t *)context.entry.data)->f(&context, file);
+    // A single input spreads over the cores: BLAKE3 splits its tree, and the algorithms of a list get a thread each.
+    // Several inputs are spread over the workers instead
+    const uint32_t parallel_inputs = OPTION_CHECK | OPTION_RECURSIVE | OPTION_TREE;
+    const bool single_input = !(context.options & parallel_inputs) && ac - optind <= 1;
+    blake3_set_threads(single_input ? context.worker_count : 1);
+    if (single_input && context.worker_count > 1 && context.algorithm_count > 1)
+        SET_OPTION_ALGORITHM_THREADS(context.options);
 
-        // Close the file stream
-        fclose(file);
+    // Records are hashed from memory, one digest per line
+    const uint32_t not_with_lines = OPTION_P | OPTION_S | OPTION_CHECK | OPTION_RECURSIVE | OPTION_TREE | OPTION_RESUME;
+    if (IS_OPTION_LINES(context.options) && ((context.options & not_with_lines) || context.checkpoint))
+        exit_error(print_lines_usage, av[0]);
+
+    if (IS_OPTION_LINES(context.options)) {
+        const bool ok = hash_lines(&context, av + optind, (size_t)(ac - optind));
+        if (context.stats)
+            stats_free(context.stats);
+        free(context.hmac);
+        if (context.cache)
+            cache_close(context.cache);
+        hdestroy();
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
     }
 
-    // Read from file
-    if (optind < ac) {
-        for (int i = optind; i < ac; i++) {
+    // Groups of identical files instead of a digest per file
+    const uint32_t not_with_dupes = OPTION_P | OPTION_S | OPTION_CHECK | OPTION_LINES | OPTION_RAW | OPTION_TREE | OPTION_RESUME;
+    if (IS_OPTION_FIND_DUPES(context.options)
+        && ((context.options & not_with_dupes) || optind >= ac || context.algorithm_count > 1 || context.checkpoint || context.cache || context.stats))
+        exit_error(print_find_dupes_usage, av[0]);
 
-            // Setup the context
-            context.message_size = 0;
-            context.filename = av[i];
-            context.p_message = NULL;
+    if (IS_OPTION_FIND_DUPES(context.options)) {
+        const bool ok = dupes_find(&context, av + optind, (size_t)(ac - optind));
+        free(context.include_globs);
+        free(context.exclude_globs);
+        hdestroy();
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
 
-            // Open from file
-            FILE * file = fopen(av[i], "rb");
-            if (!file) {
-                printf("ft_ssl: %s: %s: %s\n", ((ft_ssl_algorithm_t *)context.entry.data)->lower_name, av[i], strerror(errno));
-                continue;
-            }
+    // Verify manifests instead of printing digests
+    if (IS_OPTION_CHECK(context.options)) {
+        bool ok = true;
+        if (optind >= ac)
+            ok = check_manifest(&context, "-");
+        for (int i = optind; i < ac; i++)
+            ok = check_manifest(&context, av[i]) && ok;
+        if (context.stats)
+            stats_free(context.stats);
+        free(context.hmac);
+        if (context.cache)
+            cache_close(context.cache);
+        hdestroy();
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
 
-            // Hash the message
-            ((ft_ssl_algorithm_t *)context.entry.data)->f(&context, file);
+    // Read from stdin
+    if (!isatty(fileno(stdin)) && (optind >= ac || IS_OPTION_P(context.options))) {
+        ft_ssl_hash(&context, stdin);
+        ft_ssl_print(&context, stdin);
+    }
 
-            // Close the file stream
-            fclose(file);
-        }
+    // Read from string
+    if (IS_OPTION_S(context.options)) {
+
+        // Setup the context
+        context.message_size = 0;
+        context.filename = NULL;
+
+        // Hash the message straight from memory
+        ft_ssl_hash_string(&context, context.p_message);
+        ft_ssl_print(&context, NULL);
     }
 
+    // Read from files
+    if (optind < ac && IS_OPTION_RECURSIVE(context.options))
+        walk_hash(&context, av + optind, (size_t)(ac - optind));
+    else if (optind < ac)
+        hash_files(&context, av + optind, (size_t)(ac - optind));
+
+    if (context.manifest)
+        fclose(context.manifest);
+    if (context.cache)
+        cache_close(context.cache);
+    if (context.stats)
+        stats_free(context.stats);
+    free(context.hmac);
+    free(context.include_globs);
+    free(context.exclude_globs);
     hdestroy();
     return EXIT_SUCCESS;
 }
@@ -1,58 +1,206 @@
 #pragma once
 
-#include <search.h> // for ENTRY
-#include <stdio.h>  // for FILE
-#include <stdint.h> // for uint32_t, uint8_t
+#include <search.h>  // for ENTRY
+#include <stdbool.h> // for bool
+#include <stdio.h>   // for FILE
+#include <stdint.h>  // for uint32_t, uint8_t
 
 /// @brief Option flags for the ft_ssl command
 #define OPTION_P (1 << 0) // Print input (echo mode)
 #define OPTION_Q (1 << 1) // Quiet mode
 #define OPTION_R (1 << 2) // Reverse format
 #define OPTION_S (1 << 3) // String input mode
+#define OPTION_PIPELINE (1 << 4) // Read inputs on a separate thread
+#define OPTION_MANY (1 << 5)     // Enough files per worker for the multi-buffer engine
+#define OPTION_TREE (1 << 6)     // Tree hash: hash fixed-size leaves in parallel, then their digests
+#define OPTION_RESUME (1 << 7)   // Start hashing the file argument from a saved midstate
+#define OPTION_CHECK (1 << 8)    // Verify the digests listed in the file arguments
+#define OPTION_RECURSIVE (1 << 9)      // Hash the files under directory arguments
+#define OPTION_FOLLOW (1 << 10)        // Follow symlinks while walking directories
+#define OPTION_ONE_FILESYSTEM (1 << 11) // Do not walk into other filesystems
+#define OPTION_LINES (1 << 12)         // Hash every record of the input on its own
+#define OPTION_NUL (1 << 13)           // Records are NUL-delimited instead of newline-delimited
+#define OPTION_RAW (1 << 14)           // Print the bare digest bytes
+#define OPTION_ALGORITHM_THREADS (1 << 15) // Feed each algorithm of a list on its own thread
+#define OPTION_FIND_DUPES (1 << 16)        // Report the groups of identical files instead of every digest
+#define OPTION_URING (1 << 17)             // Open, stat and read the file arguments through io_uring
 
 #define IS_OPTION_P(options) ((options) & OPTION_P)
 #define IS_OPTION_Q(options) ((options) & OPTION_Q)
 #define IS_OPTION_R(options) ((options) & OPTION_R)
 #define IS_OPTION_S(options) ((options) & OPTION_S)
+#define IS_OPTION_PIPELINE(options) ((options) & OPTION_PIPELINE)
+#define IS_OPTION_MANY(options) ((options) & OPTION_MANY)
+#define IS_OPTION_TREE(options) ((options) & OPTION_TREE)
+#define IS_OPTION_RESUME(options) ((options) & OPTION_RESUME)
+#define IS_OPTION_CHECK(options) ((options) & OPTION_CHECK)
+#define IS_OPTION_RECURSIVE(options) ((options) & OPTION_RECURSIVE)
+#define IS_OPTION_FOLLOW(options) ((options) & OPTION_FOLLOW)
+#define IS_OPTION_ONE_FILESYSTEM(options) ((options) & OPTION_ONE_FILESYSTEM)
+#define IS_OPTION_LINES(options) ((options) & OPTION_LINES)
+#define IS_OPTION_NUL(options) ((options) & OPTION_NUL)
+#define IS_OPTION_RAW(options) ((options) & OPTION_RAW)
+#define IS_OPTION_ALGORITHM_THREADS(options) ((options) & OPTION_ALGORITHM_THREADS)
+#define IS_OPTION_FIND_DUPES(options) ((options) & OPTION_FIND_DUPES)
+#define IS_OPTION_URING(options) ((options) & OPTION_URING)
 
 #define SET_OPTION_P(options) ((options) |= OPTION_P)
 #define SET_OPTION_Q(options) ((options) |= OPTION_Q)
 #define SET_OPTION_R(options) ((options) |= OPTION_R)
 #define SET_OPTION_S(options) ((options) |= OPTION_S)
+#define SET_OPTION_PIPELINE(options) ((options) |= OPTION_PIPELINE)
+#define SET_OPTION_MANY(options) ((options) |= OPTION_MANY)
+#define SET_OPTION_TREE(options) ((options) |= OPTION_TREE)
+#define SET_OPTION_RESUME(options) ((options) |= OPTION_RESUME)
+#define SET_OPTION_CHECK(options) ((options) |= OPTION_CHECK)
+#define SET_OPTION_RECURSIVE(options) ((options) |= OPTION_RECURSIVE)
+#define SET_OPTION_FOLLOW(options) ((options) |= OPTION_FOLLOW)
+#define SET_OPTION_ONE_FILESYSTEM(options) ((options) |= OPTION_ONE_FILESYSTEM)
+#define SET_OPTION_LINES(options) ((options) |= OPTION_LINES)
+#define SET_OPTION_NUL(options) ((options) |= OPTION_NUL)
+#define SET_OPTION_RAW(options) ((options) |= OPTION_RAW)
+#define SET_OPTION_ALGORITHM_THREADS(options) ((options) |= OPTION_ALGORITHM_THREADS)
+#define SET_OPTION_FIND_DUPES(options) ((options) |= OPTION_FIND_DUPES)
+#define SET_OPTION_URING(options) ((options) |= OPTION_URING)
 
 #define UNSET_OPTION_P(options) ((options) &= ~OPTION_P)
 #define UNSET_OPTION_Q(options) ((options) &= ~OPTION_Q)
 #define UNSET_OPTION_R(options) ((options) &= ~OPTION_R)
 #define UNSET_OPTION_S(options) ((options) &= ~OPTION_S)
+#define UNSET_OPTION_PIPELINE(options) ((options) &= ~OPTION_PIPELINE)
+#define UNSET_OPTION_MANY(options) ((options) &= ~OPTION_MANY)
+#define UNSET_OPTION_TREE(options) ((options) &= ~OPTION_TREE)
+#define UNSET_OPTION_RESUME(options) ((options) &= ~OPTION_RESUME)
+#define UNSET_OPTION_CHECK(options) ((options) &= ~OPTION_CHECK)
+#define UNSET_OPTION_RECURSIVE(options) ((options) &= ~OPTION_RECURSIVE)
+#define UNSET_OPTION_FOLLOW(options) ((options) &= ~OPTION_FOLLOW)
+#define UNSET_OPTION_ONE_FILESYSTEM(options) ((options) &= ~OPTION_ONE_FILESYSTEM)
+#define UNSET_OPTION_LINES(options) ((options) &= ~OPTION_LINES)
+#define UNSET_OPTION_NUL(options) ((options) &= ~OPTION_NUL)
+#define UNSET_OPTION_RAW(options) ((options) &= ~OPTION_RAW)
+#define UNSET_OPTION_ALGORITHM_THREADS(options) ((options) &= ~OPTION_ALGORITHM_THREADS)
+#define UNSET_OPTION_FIND_DUPES(options) ((options) &= ~OPTION_FIND_DUPES)
+#define UNSET_OPTION_URING(options) ((options) &= ~OPTION_URING)
 
-/// @brief The size of a block in bytes (64 bytes = 512 bits)
+/// @brief The size of a block in bytes (64 bytes = 512 bits) for MD5 and SHA-256
 #define BLOCK_SIZE 64
 
+/// @brief The largest block size in bytes (128 bytes = 1024 bits, for the SHA-512 family)
+#define FT_SSL_MAX_BLOCK_SIZE 128
+
+/// @brief The largest state in 32-bit words (SHA-512: eight 64-bit words, high half first)
+#define FT_SSL_MAX_STATE_WORDS 16
+
 /// @brief The number of 512 bits blocks in a chunk
 #define CHUNK_NUMBERS 10
 
 /// @brief The number of 512 bits blocks read at a time
 #define CHUNK_SIZE_READ (BLOCK_SIZE * CHUNK_NUMBERS)
 
-/// @brief The total number of 512 bits blocks in a chunk (one extra for padding)
-#define CHUNK_SIZE_TOTAL (CHUNK_SIZE_READ + 2 * BLOCK_SIZE)
+/// @brief The total size of a chunk (room for two more blocks of padding, of the largest size)
+#define CHUNK_SIZE_TOTAL (CHUNK_SIZE_READ + 2 * FT_SSL_MAX_BLOCK_SIZE)
+
+/// @brief Upper bound for the number of algorithms of a comma-separated list
+#define FT_SSL_MAX_ALGORITHMS 8
+
+/// @brief Buffers at least this large are fed to the algorithms of a list on parallel threads
+#define ALGORITHM_THREADS_MIN (256 * 1024)
+
+/// @brief Upper bound for the -j option
+#define FT_SSL_MAX_WORKERS 1024
+
+/// @brief Default size of the leaves in tree mode (4 MiB)
+#define TREE_LEAF_SIZE (4 * 1024 * 1024)
+
+/// @brief Longest message that pads to a single block (room for the 0x80 byte and the 64-bit length)
+#define SHORT_MESSAGE_MAX (BLOCK_SIZE - 9)
+
+/// @brief Regular files at least this large are hashed from a memory mapping instead of being read
+#define MMAP_THRESHOLD (64 * 1024)
+
+/// @brief Pipe size asked for when -p echoes a pipe into a pipe (the kernel caps it at /proc/sys/fs/pipe-max-size)
+#define ECHO_PIPE_SIZE (1024 * 1024)
+
+struct cache_s;
+struct stats_s;
+struct hmac_s;
+struct ft_ssl_algorithm_s;
 
 /// @brief Context for ft_ssl operations
 typedef struct {
     ENTRY entry;                     ///< Hash table entry for the algorithm
-    uint32_t hash[8];                ///< Hash result buffer (max 8 words needed for SHA-256)
+    uint32_t hash[FT_SSL_MAX_STATE_WORDS]; ///< Hash result buffer (16 words for SHA-512)
     uint8_t chunk[CHUNK_SIZE_TOTAL]; ///< Buffer for input data
     char * filename;                 ///< Input filename
     char * p_message;                ///< Input message (when using -s option)
     size_t message_size;             ///< Total message size
     size_t chunk_size;               ///< Current chunk size
-    uint8_t options;                 ///< Command line options
+    size_t buffer_size;              ///< Size of each buffer in pipeline mode
+    size_t worker_count;             ///< Number of threads hashing file arguments (or tree leaves)
+    size_t queue_depth;              ///< Number of files in flight per worker with --io-uring
+    size_t leaf_size;                ///< Size of the leaves in tree mode
+    FILE * manifest;                 ///< Where to write the leaf digests in tree mode (optional)
+    char * checkpoint;               ///< Where to save the midstate of the file argument (optional)
+    uint32_t resume_hash[FT_SSL_MAX_STATE_WORDS]; ///< Midstate to resume from
+    size_t resume_offset;            ///< Number of bytes hashed into resume_hash
+    struct cache_s * cache;          ///< Digests of the file arguments from previous runs (optional)
+    char ** include_globs;           ///< Only hash the files matching one of these in recursive mode
+    size_t include_count;            ///< Number of include globs
+    char ** exclude_globs;           ///< Skip the files and directories matching one of these in recursive mode
+    size_t exclude_count;            ///< Number of exclude globs
+    struct stats_s * stats;          ///< Totals of --stats (NULL when disabled)
+    struct hmac_s * hmac;            ///< Keyed midstates of --hmac (NULL without a key)
+    const struct ft_ssl_algorithm_s * algorithms[FT_SSL_MAX_ALGORITHMS]; ///< Algorithms of the list, the first one being entry.data
+    size_t algorithm_count;          ///< Number of algorithms hashed in the same pass (1 without a list)
+    uint32_t other_hashes[FT_SSL_MAX_ALGORITHMS - 1][FT_SSL_MAX_STATE_WORDS]; ///< Hash results of algorithms[1...]
+    uint32_t options;                ///< Command line options
 } ft_ssl_context_t;
 
-/// @brief Algorithm function pointers structure
+/// @brief A file (or a buffer) to hash when several inputs are processed at once
+typedef struct {
+    char * filename;      ///< Input filename
+    const uint8_t * data; ///< Input buffer, when there is no filename
+    size_t size;          ///< Size of the input buffer
+    uint32_t hash[FT_SSL_MAX_STATE_WORDS]; ///< Hash result
+    uint32_t (*other_hashes)[FT_SSL_MAX_STATE_WORDS]; ///< Hash results of the other algorithms of a list (NULL without one)
+    int error;        ///< errno value if the file could not be opened, 0 otherwise
+    bool done;        ///< The hash (or the error) is ready to be printed
+} ft_ssl_job_t;
+
+/// @brief Where a hashing loop takes its jobs from, and where it reports them done
+typedef struct {
+    ft_ssl_job_t * (*next)(void * arg, bool wait); ///< Next job (NULL when there are none left, or none ready and !wait)
+    void (*done)(void * arg, ft_ssl_job_t * job);  ///< Called once the hash (or the error) of a job is set
+    void * arg;                                    ///< Argument of both callbacks
+} ft_ssl_job_source_t;
+
+/// @brief An algorithm that is not a Merkle-Damgard construction, fed through its own state
 typedef struct {
+    void (*init)(void *);                           ///< Start a message
+    void (*update)(void *, const uint8_t *, size_t); ///< Feed the next bytes of the message
+    void (*final)(void *, uint32_t *);              ///< Write the hash words
+} ft_ssl_hasher_t;
+
+/// @brief An implementation of the compression function of an algorithm, for --engine
+typedef struct {
+    const char * name;     ///< Name on the command line
+    uint32_t cpu_features; ///< CPU_FEATURE_* bits it needs
+    void (*use)(void);     ///< Make it the implementation of its algorithm
+} ft_ssl_kernel_t;
+
+/// @brief Algorithm function pointers structure
+typedef struct ft_ssl_algorithm_s {
     const char * lower_name;                    ///< Lowercase name (for command line)
     const char * upper_name;                    ///< Uppercase name (for output formatting)
     size_t word_count;                          ///< Number of words in hash output
-    void (*f)(ft_ssl_context_t *, FILE * file); ///< Hash function
+    size_t block_size;                          ///< Size of a block in bytes
+    size_t state_word_count;                    ///< Number of words of the midstate (more than word_count for truncated digests)
+    bool (*f_many)(ft_ssl_context_t *, ft_ssl_job_source_t *); ///< Multi-buffer hash function (optional)
+    void (*f_short)(const uint8_t * const *, const size_t *, size_t, uint32_t (*)[8]); ///< Hash single-block messages side by side (optional)
+    void (*init)(uint32_t *);                                  ///< Set the initial hash value
+    void (*pad)(uint8_t *, size_t *, size_t);                  ///< Pad the last chunk of a message
+    void (*update)(const uint8_t *, size_t, uint32_t *);             ///< Compress whole blocks
+    void (*final)(uint32_t *);                                 ///< Turn the state into the hash words (optional)
+    const ft_ssl_hasher_t * hasher;                            ///< Replaces init, pad, update and final (optional)
+    const ft_ssl_kernel_t * kernels;                           ///< Implementations, slowest first, terminated by a NULL name
 } ft_ssl_algorithm_t;
@@ -0,0 +1,92 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "digest.h"
+#include "hmac.h"
+
+#define HMAC_IPAD 0x36
+#define HMAC_OPAD 0x5c
+
+void hmac_init(hmac_t * hmac, const ft_ssl_algorithm_t * algorithm, const uint8_t * key, size_t key_size) {
+
+    hmac->algorithm = algorithm;
+
+    // The key, zero-padded to a block (or its digest, if it does not fit)
+    uint8_t block[FT_SSL_MAX_BLOCK_SIZE];
+    memset(block, 0, sizeof(block));
+    if (key_size > algorithm->block_size) {
+        ft_ssl_digest_t digest;
+        ft_ssl_digest_init(&digest, algorithm);
+        ft_ssl_digest_update(&digest, key, key_size);
+        ft_ssl_digest_final(&digest, block);
+    } else if (key_size) {
+        memcpy(block, key, key_size);
+    }
+
+    // One compression each, by the update kernel of the algorithm
+    uint8_t padded[FT_SSL_MAX_BLOCK_SIZE];
+    for (size_t i = 0; i < algorithm->block_size; i++)
+        padded[i] = block[i] ^ HMAC_IPAD;
+    algorithm->init(hmac->inner);
+    algorithm->update(padded, algorithm->block_size, hmac->inner);
+    for (size_t i = 0; i < algorithm->block_size; i++)
+        padded[i] = block[i] ^ HMAC_OPAD;
+    algorithm->init(hmac->outer);
+    algorithm->update(padded, algorithm->block_size, hmac->outer);
+}
+
+void hmac_start(const hmac_t * hmac, ft_ssl_digest_t * digest) {
+    ft_ssl_digest_resume(digest, hmac->algorithm, hmac->inner, hmac->algorithm->block_size);
+}
+
+void hmac_final(const hmac_t * hmac, ft_ssl_digest_t * digest) {
+
+    uint8_t inner[FT_SSL_MAX_DIGEST_SIZE];
+    const size_t size = ft_ssl_digest_final(digest, inner);
+
+    // The inner digest fits in the last block, with the padding
+    ft_ssl_digest_resume(digest, hmac->algorithm, hmac->outer, hmac->algorithm->block_size);
+    ft_ssl_digest_update(digest, inner, size);
+    ft_ssl_digest_final(digest, NULL);
+}
+
+void hmac_buffer(const hmac_t * hmac, const uint8_t * data, size_t size, uint32_t hash[FT_SSL_MAX_STATE_WORDS]) {
+    ft_ssl_digest_t digest;
+    hmac_start(hmac, &digest);
+    ft_ssl_digest_update(&digest, data, size);
+    hmac_final(hmac, &digest);
+    memcpy(hash, digest.hash, hmac->algorithm->word_count * sizeof(uint32_t));
+}
+
+uint8_t * hmac_read_key(const char * path, size_t * size) {
+
+    FILE * file = fopen(path, "rb");
+    if (!file)
+        return NULL;
+
+    size_t capacity = 256;
+    uint8_t * key = malloc(capacity);
+    *size = 0;
+    while (key) {
+        *size += fread(key + *size, 1, capacity - *size, file);
+        if (*size < capacity)
+            break;
+        uint8_t * grown = realloc(key, capacity *= 2);
+        if (!grown)
+            free(key);
+        key = grown;
+    }
+
+    const bool failed = !key || ferror(file);
+    fclose(file);
+    if (failed) {
+        errno = key ? EIO : ENOMEM;
+        free(key);
+        return NULL;
+    }
+    return key;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdbool.h> // for bool
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint32_t, uint8_t
+
+#include "digest.h" // for ft_ssl_digest_t
+#include "ft_ssl.h" // for ft_ssl_algorithm_t, FT_SSL_MAX_STATE_WORDS
+
+/// @brief Keyed midstates of HMAC (RFC 2104): the state after the padded key block of the inner and of the outer hash
+/// @details Computed once per key, so that each message only costs its own blocks, then one outer block
+typedef struct hmac_s {
+    const ft_ssl_algorithm_t * algorithm;     ///< Underlying hash
+    uint32_t inner[FT_SSL_MAX_STATE_WORDS]; ///< State after the key XOR ipad block
+    uint32_t outer[FT_SSL_MAX_STATE_WORDS]; ///< State after the key XOR opad block
+} hmac_t;
+
+/// @brief Compress the padded key blocks (keys longer than a block are hashed first)
+/// @note Only for the algorithms with a midstate (state_word_count > 0)
+void hmac_init(hmac_t * hmac, const ft_ssl_algorithm_t * algorithm, const uint8_t * key, size_t key_size);
+
+/// @brief Start the inner hash of a message, from the inner midstate
+void hmac_start(const hmac_t * hmac, ft_ssl_digest_t * digest);
+
+/// @brief Finish the inner hash, then hash its digest from the outer midstate, leaving the HMAC words in digest->hash
+void hmac_final(const hmac_t * hmac, ft_ssl_digest_t * digest);
+
+/// @brief HMAC of a whole message held in memory
+void hmac_buffer(const hmac_t * hmac, const uint8_t * data, size_t size, uint32_t hash[FT_SSL_MAX_STATE_WORDS]);
+
+/// @brief Read a whole key file
+/// @return The key (to free), with its size in `size`, or NULL with errno set
+uint8_t * hmac_read_key(const char * path, size_t * size);
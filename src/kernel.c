@@ -0,0 +1,135 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cpu.h"
+#include "digest.h"
+#include "kernel.h"
+
+/// @brief Size of the long self-test message: several BLAKE3 chunks, and enough blocks for every lane
+#define KERNEL_TEST_SIZE 9000
+
+/// @brief Digests of the empty message, of "abc", and of KERNEL_TEST_SIZE bytes counting modulo 251
+typedef struct {
+    const char * name;       ///< Algorithm
+    const char * digests[3]; ///< Expected hexadecimal digests
+} kernel_vectors_t;
+
+static const kernel_vectors_t kernel_vectors[] = {
+    {"md5", {"d41d8cd98f00b204e9800998ecf8427e", "900150983cd24fb0d6963f7d28e17f72", "043e033895345780d698357255f7559a"}},
+    {"sha256",
+     {"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+      "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+      "4b81efbd205e7fb4e42bc0d72d9d7413642298735289d35a74c1755883bcc45c"}},
+    {"sha384",
+     {"38b060a751ac96384cd9327eb1b1e36a21fdb71114be07434c0cc7bf63f6e1da274edebfe76f65fbd51ad2f14898b95b",
+      "cb00753f45a35e8bb5a03d699ac65007272c32ab0eded1631a8b605a43ff5bed8086072ba1e7cc2358baeca134c825a7",
+      "030f8d36e564c3fc511962ffd17b9b9a0a27fc5476df693b10205412765fa3a131f107f0cf0fb7f5e4c8abab1304a71d"}},
+    {"sha512",
+     {"cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce47d0d13c5d85f2b0ff8318d2877eec2f63b931bd47417a81a538327af927da3e",
+      "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f",
+      "2f8dabefb462196f0e021e2a1a1a89b9f6843d8e39326e6c1be044fc78a9a3f92b5b1f2f40f41e7491187ceaff11c522fb34c594b4a07c4781c12fb07c2c4cfd"}},
+    {"sha512-256",
+     {"c672b8d1ef56ed28ab87c3622c5114069bdd3ad7b8f9737498d0c01ecef0967a",
+      "53048e2681941ef99b2e29b76b4c7dabe4c2d0c634fc6d46e0e2f13107e7af23",
+      "88d773681bfb1f3a0c44494700e3de4a1860ed4efcb39dacf798a5def7022150"}},
+    {"blake3",
+     {"af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262",
+      "6437b3ac38465133ffb63b75273a8db548c558465d79db03fd359c6cd5bd9d85",
+      "e9daa1ff8a19d7618f9721c83a17cffd6976a323aa116d030aac239c98b6a046"}},
+    {NULL, {NULL, NULL, NULL}}
+};
+
+/// @brief Compare hash words to a hexadecimal digest
+static bool kernel_check(const ft_ssl_algorithm_t * algorithm, const uint32_t * hash, const char * expected) {
+    uint8_t digest[FT_SSL_MAX_DIGEST_SIZE];
+    char hex[2 * FT_SSL_MAX_DIGEST_SIZE + 1];
+    ft_ssl_digest_bytes(hash, algorithm->word_count, digest);
+    for (size_t j = 0; j < algorithm->word_count * 4; j++)
+        snprintf(hex + 2 * j, 3, "%02x", digest[j]);
+    return strcmp(hex, expected) == 0;
+}
+
+bool kernel_self_test(const ft_ssl_algorithm_t * algorithm) {
+
+    const kernel_vectors_t * vectors = kernel_vectors;
+    while (vectors->name && strcmp(vectors->name, algorithm->lower_name) != 0)
+        vectors++;
+    if (!vectors->name)
+        return true;
+
+    uint8_t message[KERNEL_TEST_SIZE];
+    for (size_t i = 0; i < sizeof(message); i++)
+        message[i] = (uint8_t)(i % 251);
+    const uint8_t * const data[3] = {message, (const uint8_t *)"abc", message};
+    const size_t sizes[3] = {0, 3, sizeof(message)};
+
+    for (size_t i = 0; i < 3; i++) {
+        uint32_t hash[FT_SSL_MAX_STATE_WORDS];
+        ft_ssl_hash_buffer(algorithm, data[i], sizes[i], hash);
+        if (!kernel_check(algorithm, hash, vectors->digests[i]))
+            return false;
+    }
+
+    // The short messages go through the SIMD lanes of the kernel, if it has some
+    if (algorithm->f_short) {
+        uint32_t hashes[2][8];
+        algorithm->f_short(data, sizes, 2, hashes);
+        for (size_t i = 0; i < 2; i++)
+            if (!kernel_check(algorithm, hashes[i], vectors->digests[i]))
+                return false;
+    }
+    return true;
+}
+
+/// @brief Use the fastest kernel the CPU supports that passes its self-test (the reference one if none does)
+static void kernel_select_fastest(const ft_ssl_algorithm_t * algorithm) {
+
+    size_t count = 0;
+    while (algorithm->kernels[count].name)
+        count++;
+
+    for (size_t i = count; i-- > 0;) {
+        const ft_ssl_kernel_t * kernel = &algorithm->kernels[i];
+        if (!HAS_CPU_FEATURE(cpu_features(), kernel->cpu_features))
+            continue;
+        kernel->use();
+        if (kernel_self_test(algorithm))
+            return;
+        fprintf(stderr, "ft_ssl: %s: engine '%s' failed its self-test, falling back to a slower one\n", algorithm->lower_name, kernel->name);
+    }
+}
+
+void kernel_select_default(const char * name) {
+    const ft_ssl_algorithm_t * algorithm = ft_ssl_algorithm(name);
+    if (algorithm && algorithm->kernels)
+        kernel_select_fastest(algorithm);
+}
+
+bool kernel_select(const ft_ssl_algorithm_t * algorithm, const char * name) {
+
+    const ft_ssl_kernel_t * kernel = algorithm->kernels;
+    while (kernel && kernel->name && strcmp(kernel->name, name) != 0)
+        kernel++;
+
+    if (!kernel || !kernel->name) {
+        fprintf(stderr, "ft_ssl: %s: unknown engine '%s' (engines:", algorithm->lower_name, name);
+        for (kernel = algorithm->kernels; kernel && kernel->name; kernel++)
+            fprintf(stderr, " %s%s", kernel->name, HAS_CPU_FEATURE(cpu_features(), kernel->cpu_features) ? "" : " (unsupported)");
+        fprintf(stderr, ")\n");
+        return false;
+    }
+    if (!HAS_CPU_FEATURE(cpu_features(), kernel->cpu_features)) {
+        fprintf(stderr, "ft_ssl: %s: engine '%s' needs instructions this CPU does not have\n", algorithm->lower_name, name);
+        return false;
+    }
+
+    kernel->use();
+    if (!kernel_self_test(algorithm)) {
+        fprintf(stderr, "ft_ssl: %s: engine '%s' failed its self-test\n", algorithm->lower_name, name);
+        kernel_select_fastest(algorithm);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdbool.h> // for bool
+
+#include "ft_ssl.h" // for ft_ssl_algorithm_t
+
+/// @note Every algorithm with kernels starts with the fastest one the CPU supports that passes its
+/// self-test, picked before main by a constructor of its own object file (so that programs linking
+/// only part of libft_ssl.a get it too); --engine then switches to a given one.
+
+/// @brief Hash known messages with the current implementation of an algorithm and check their digests
+/// @return false if one of them differs (true for an algorithm without known digests)
+bool kernel_self_test(const ft_ssl_algorithm_t * algorithm);
+
+/// @brief Switch the algorithm called `name` (and those sharing its kernels) to its fastest kernel
+void kernel_select_default(const char * name);
+
+/// @brief Switch an algorithm to the kernel called `name`
+/// @return false, with a message on stderr, if the algorithm has no such kernel, the CPU cannot run it,
+///         or it fails its self-test (the default kernel, the fastest one that passes, is restored then)
+bool kernel_select(const ft_ssl_algorithm_t * algorithm, const char * name);
@@ -0,0 +1,132 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "digest.h"
+#include "hmac.h"
+#include "lines.h"
+#include "output.h"
+#include "utils.h"
+
+/// @brief A batch of records, pointing into the input buffer, and the digests being printed
+typedef struct {
+    const ft_ssl_algorithm_t * algorithm;
+    const hmac_t * hmac;                        ///< Keyed midstates of --hmac (NULL without a key)
+    const uint8_t * records[LINES_BATCH];       ///< Records of the batch, in input order
+    size_t sizes[LINES_BATCH];                  ///< Sizes of the records
+    size_t count;                               ///< Number of records in the batch
+    uint32_t hashes[LINES_BATCH][FT_SSL_MAX_STATE_WORDS]; ///< Hashes of the records
+    const uint8_t * short_records[LINES_BATCH]; ///< Records hashed by the single-block path
+    size_t short_sizes[LINES_BATCH];            ///< Sizes of the short records
+    size_t short_indexes[LINES_BATCH];          ///< Index of each short record in the batch
+    uint32_t short_hashes[LINES_BATCH][8];      ///< Hashes of the short records
+    bool raw;                                   ///< Digest bytes only, without newlines
+} lines_t;
+
+static void lines_hash_batch(lines_t * lines) {
+
+    const ft_ssl_algorithm_t * algorithm = lines->algorithm;
+
+    // Short records are gathered for the multi-lane kernel, the others hashed in place
+    // (keyed records start from the inner midstate instead of the IV the kernel assumes)
+    size_t short_count = 0;
+    for (size_t i = 0; i < lines->count; i++) {
+        if (lines->hmac) {
+            hmac_buffer(lines->hmac, lines->records[i], lines->sizes[i], lines->hashes[i]);
+        } else if (algorithm->f_short && lines->sizes[i] <= SHORT_MESSAGE_MAX) {
+            lines->short_records[short_count] = lines->records[i];
+            lines->short_sizes[short_count] = lines->sizes[i];
+            lines->short_indexes[short_count++] = i;
+        } else {
+            ft_ssl_hash_buffer(algorithm, lines->records[i], lines->sizes[i], lines->hashes[i]);
+        }
+    }
+    if (short_count) {
+        algorithm->f_short(lines->short_records, lines->short_sizes, short_count, lines->short_hashes);
+        for (size_t i = 0; i < short_count; i++)
+            memcpy(lines->hashes[lines->short_indexes[i]], lines->short_hashes[i], algorithm->word_count * sizeof(uint32_t));
+    }
+
+    for (size_t i = 0; i < lines->count; i++) {
+        if (lines->raw) {
+            output_raw(lines->hashes[i], algorithm->word_count);
+        } else {
+            output_hex(lines->hashes[i], algorithm->word_count);
+            output_write("\n", 1);
+        }
+    }
+
+    lines->count = 0;
+}
+
+static void lines_add(lines_t * lines, const uint8_t * record, size_t size) {
+    lines->records[lines->count] = record;
+    lines->sizes[lines->count++] = size;
+    if (lines->count == LINES_BATCH)
+        lines_hash_batch(lines);
+}
+
+int lines_hash(ft_ssl_context_t * context, int fd) {
+
+    const int delimiter = IS_OPTION_NUL(context->options) ? '\0' : '\n';
+    lines_t * lines = malloc(sizeof(lines_t));
+    size_t capacity = LINES_BUFFER_SIZE;
+    uint8_t * buffer = malloc(capacity);
+    if (!lines || !buffer) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    lines->algorithm = context->entry.data;
+    lines->hmac = context->hmac;
+    lines->count = 0;
+    lines->raw = IS_OPTION_RAW(context->options);
+
+    size_t size = 0;
+    int error = 0;
+    for (;;) {
+        const ssize_t read_size = read(fd, buffer + size, capacity - size);
+        if (read_size == -1 && errno == EINTR)
+            continue;
+        if (read_size == -1) {
+            error = errno;
+            break;
+        }
+        size += (size_t)read_size;
+
+        // Every complete record of the buffer
+        size_t start = 0;
+        const uint8_t * end;
+        while ((end = memchr(buffer + start, delimiter, size - start))) {
+            lines_add(lines, buffer + start, (size_t)(end - buffer) - start);
+            start = (size_t)(end - buffer) + 1;
+        }
+
+        if (read_size == 0) {
+            if (start < size)
+                lines_add(lines, buffer + start, size - start);
+            break;
+        }
+
+        // The records point into the buffer: hash them before moving the partial record to the front
+        lines_hash_batch(lines);
+        memmove(buffer, buffer + start, size - start);
+        size -= start;
+        if (size == capacity) {
+            capacity *= 2;
+            if (!(buffer = realloc(buffer, capacity))) {
+                perror("realloc");
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    lines_hash_batch(lines);
+    output_end_record();
+    free(buffer);
+    free(lines);
+    return error;
+}
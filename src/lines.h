@@ -0,0 +1,15 @@
+#pragma once
+
+#include "ft_ssl.h" // for ft_ssl_context_t
+
+/// @brief Records hashed per batch in lines mode
+#define LINES_BATCH 1024
+
+/// @brief Initial size of the input buffer in lines mode
+#define LINES_BUFFER_SIZE (1024 * 1024)
+
+/// @brief Hash every newline (or NUL with OPTION_NUL) delimited record of a file descriptor, printing one hex digest per line (or the bare digest bytes with OPTION_RAW)
+/// @details Records of at most SHORT_MESSAGE_MAX bytes go through the algorithm's single-block multi-lane path.
+/// A final record without a delimiter is hashed too, but an input ending with a delimiter has no empty last record.
+/// @return 0, or the errno value of a failed read
+int lines_hash(ft_ssl_context_t * context, int fd);
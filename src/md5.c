@@ -2,18 +2,20 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "cpu.h"
 #include "ft_ssl.h"
+#include "kernel.h"
 #include "md5.h"
-#include "utils.h"
+#include "md5_mb.h"
 
-static void md5_init(uint32_t hash[4]) {
+void md5_init(uint32_t hash[4]) {
     hash[0] = 0x67452301;
     hash[1] = 0xEFCDAB89;
     hash[2] = 0x98BADCFE;
     hash[3] = 0x10325476;
 }
 
-static void md5_pad(uint8_t chunk[CHUNK_SIZE_TOTAL], size_t * chunk_size, size_t message_size) {
+void md5_pad(uint8_t chunk[CHUNK_SIZE_TOTAL], size_t * chunk_size, size_t message_size) {
 
     // Add the '1' bit
     chunk[*chunk_size] = 0x80;
@@ -39,7 +41,7 @@ static void md5_pad(uint8_t chunk[CHUNK_SIZE_TOTAL], size_t * chunk_size, size_t
 }
 
 /// @brief Reverse the byte order of each 32-bit word in the hash.
-static void md5_final(uint32_t hash[4]) {
+void md5_final(uint32_t hash[4]) {
     hash[0] = ((hash[0] & 0xff) << 24) | ((hash[0] & 0xff00) << 8) |
               ((hash[0] & 0xff0000) >> 8) | ((hash[0] & 0xff000000) >> 24);
     hash[1] = ((hash[1] & 0xff) << 24) | ((hash[1] & 0xff00) << 8) |
@@ -50,7 +52,74 @@ static void md5_final(uint32_t hash[4]) {
               ((hash[3] & 0xff0000) >> 8) | ((hash[3] & 0xff000000) >> 24);
 }
 
-static void md5_update(uint8_t chunk[CHUNK_SIZE_TOTAL], size_t chunk_size, uint32_t hash[4]) {
+/// @brief Constants of the 64 steps (the integer part of 2^32 * |sin(i + 1)|)
+static const uint32_t md5_k[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+/// @brief Rotation of the 64 steps
+static const uint8_t md5_s[64] = {
+    S11, S12, S13, S14, S11, S12, S13, S14, S11, S12, S13, S14, S11, S12, S13, S14,
+    S21, S22, S23, S24, S21, S22, S23, S24, S21, S22, S23, S24, S21, S22, S23, S24,
+    S31, S32, S33, S34, S31, S32, S33, S34, S31, S32, S33, S34, S31, S32, S33, S34,
+    S41, S42, S43, S44, S41, S42, S43, S44, S41, S42, S43, S44, S41, S42, S43, S44
+};
+
+/// @brief The compression function as a loop over the steps, the word order computed from the step
+static void md5_update_reference(const uint8_t chunk[CHUNK_SIZE_TOTAL], size_t chunk_size, uint32_t hash[4]) {
+
+    for (size_t i = 0; i < chunk_size; i += 64) {
+
+        // Break chunk into sixteen 32-bit words (little-endian)
+        uint32_t w[16];
+        for (size_t j = 0; j < 16; j++)
+            w[j] = (uint32_t)chunk[i + 4 * j] | (uint32_t)chunk[i + 4 * j + 1] << 8 |
+                   (uint32_t)chunk[i + 4 * j + 2] << 16 | (uint32_t)chunk[i + 4 * j + 3] << 24;
+
+        uint32_t a = hash[0];
+        uint32_t b = hash[1];
+        uint32_t c = hash[2];
+        uint32_t d = hash[3];
+
+        for (size_t j = 0; j < 64; j++) {
+            uint32_t f;
+            size_t g;
+            if (j < 16) {
+                f = F(b, c, d);
+                g = j;
+            } else if (j < 32) {
+                f = G(b, c, d);
+                g = (5 * j + 1) % 16;
+            } else if (j < 48) {
+                f = H(b, c, d);
+                g = (3 * j + 5) % 16;
+            } else {
+                f = I(b, c, d);
+                g = (7 * j) % 16;
+            }
+            f += a + md5_k[j] + w[g];
+            a = d;
+            d = c;
+            c = b;
+            b += ROTATE_LEFT(f, md5_s[j]);
+        }
+
+        hash[0] += a;
+        hash[1] += b;
+        hash[2] += c;
+        hash[3] += d;
+    }
+}
+
+/// @brief Fully unrolled compression function
+static void md5_update_unrolled(const uint8_t chunk[CHUNK_SIZE_TOTAL], size_t chunk_size, uint32_t hash[4]) {
 
     // Initialize the hash values
     uint32_t a0 = hash[0];
@@ -61,11 +130,9 @@ static void md5_update(uint8_t chunk[CHUNK_SIZE_TOTAL], size_t chunk_size, uint3
     // Process the message in successive 512-bit chunks
     for (size_t i = 0; i < chunk_size; i += 64) {
 
-        // Break chunk into sixteen 32-bit words
-        #pragma GCC diagnostic push
-        #pragma GCC diagnostic ignored "-Wcast-align"
-        uint32_t * w = (uint32_t *)(chunk + i);
-        #pragma GCC diagnostic pop
+        // Break chunk into sixteen 32-bit words (the block may not be aligned, the copy compiles to plain loads)
+        uint32_t w[16];
+        memcpy(w, chunk + i, sizeof(w));
 
         uint32_t a = a0;
         uint32_t b = b0;
@@ -168,9 +235,47 @@ static void md5_update(uint8_t chunk[CHUNK_SIZE_TOTAL], size_t chunk_size, uint3
     hash[3] = d0;
 }
 
-void md5(ft_ssl_context_t * context, FILE * file) {
-    md5_init(context->hash);
-    process_input(context, file, md5_pad, md5_update);
-    md5_final(context->hash);
-    ft_ssl_print(context, file);
-}
\ No newline at end of file
+/// @brief Compression function, chosen at startup by the kernel registry (or with --engine)
+static void (*md5_update_kernel)(const uint8_t *, size_t, uint32_t *) = md5_update_unrolled;
+
+static void md5_use_reference(void) {
+    md5_update_kernel = md5_update_reference;
+    md5_mb_use(NULL, 0);
+}
+
+static void md5_use_unrolled(void) {
+    md5_update_kernel = md5_update_unrolled;
+    md5_mb_use(NULL, 0);
+}
+
+#if defined(__x86_64__)
+/// @brief Single streams stay on the unrolled kernel, short messages go side by side in SIMD lanes
+static void md5_use_sse2(void) {
+    md5_update_kernel = md5_update_unrolled;
+    md5_mb_use(md5_mb_update_sse2, 4);
+}
+
+static void md5_use_avx2(void) {
+    md5_update_kernel = md5_update_unrolled;
+    md5_mb_use(md5_mb_update_avx2, 8);
+}
+#endif
+
+const ft_ssl_kernel_t md5_kernels[] = {
+    {"reference", 0, md5_use_reference},
+    {"unrolled", 0, md5_use_unrolled},
+#if defined(__x86_64__)
+    {"sse2", 0, md5_use_sse2},
+    {"avx2", CPU_FEATURE_AVX2, md5_use_avx2},
+#endif
+    {NULL, 0, NULL}
+};
+
+__attribute__((constructor))
+static void md5_select_kernel(void) {
+    kernel_select_default("md5");
+}
+
+void md5_update(const uint8_t chunk[CHUNK_SIZE_TOTAL], size_t chunk_size, uint32_t hash[4]) {
+    md5_update_kernel(chunk, chunk_size, hash);
+}
@@ -46,4 +46,10 @@
 #define S43 15
 #define S44 21
 
-void md5(ft_ssl_context_t * context, FILE * file);
\ No newline at end of file
+void md5_init(uint32_t hash[4]);
+void md5_pad(uint8_t chunk[CHUNK_SIZE_TOTAL], size_t * chunk_size, size_t message_size);
+void md5_update(const uint8_t chunk[CHUNK_SIZE_TOTAL], size_t chunk_size, uint32_t hash[4]);
+void md5_final(uint32_t hash[4]);
+
+/// @brief Implementations of md5_update: reference and unrolled
+extern const ft_ssl_kernel_t md5_kernels[];
@@ -0,0 +1,239 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "ft_ssl.h"
+#include "md5.h"
+#include "md5_mb.h"
+
+/// @brief The 64 steps of MD5, for a STEP(f, a, b, c, d, word, shift, constant) macro and the four round functions
+#define MD5_STEPS(STEP, F, G, H, I, a, b, c, d, w) \
+    STEP(F, a, b, c, d, w[0],  S11, 0xd76aa478) STEP(F, d, a, b, c, w[1],  S12, 0xe8c7b756) \
+    STEP(F, c, d, a, b, w[2],  S13, 0x242070db) STEP(F, b, c, d, a, w[3],  S14, 0xc1bdceee) \
+    STEP(F, a, b, c, d, w[4],  S11, 0xf57c0faf) STEP(F, d, a, b, c, w[5],  S12, 0x4787c62a) \
+    STEP(F, c, d, a, b, w[6],  S13, 0xa8304613) STEP(F, b, c, d, a, w[7],  S14, 0xfd469501) \
+    STEP(F, a, b, c, d, w[8],  S11, 0x698098d8) STEP(F, d, a, b, c, w[9],  S12, 0x8b44f7af) \
+    STEP(F, c, d, a, b, w[10], S13, 0xffff5bb1) STEP(F, b, c, d, a, w[11], S14, 0x895cd7be) \
+    STEP(F, a, b, c, d, w[12], S11, 0x6b901122) STEP(F, d, a, b, c, w[13], S12, 0xfd987193) \
+    STEP(F, c, d, a, b, w[14], S13, 0xa679438e) STEP(F, b, c, d, a, w[15], S14, 0x49b40821) \
+    STEP(G, a, b, c, d, w[1],  S21, 0xf61e2562) STEP(G, d, a, b, c, w[6],  S22, 0xc040b340) \
+    STEP(G, c, d, a, b, w[11], S23, 0x265e5a51) STEP(G, b, c, d, a, w[0],  S24, 0xe9b6c7aa) \
+    STEP(G, a, b, c, d, w[5],  S21, 0xd62f105d) STEP(G, d, a, b, c, w[10], S22, 0x02441453) \
+    STEP(G, c, d, a, b, w[15], S23, 0xd8a1e681) STEP(G, b, c, d, a, w[4],  S24, 0xe7d3fbc8) \
+    STEP(G, a, b, c, d, w[9],  S21, 0x21e1cde6) STEP(G, d, a, b, c, w[14], S22, 0xc33707d6) \
+    STEP(G, c, d, a, b, w[3],  S23, 0xf4d50d87) STEP(G, b, c, d, a, w[8],  S24, 0x455a14ed) \
+    STEP(G, a, b, c, d, w[13], S21, 0xa9e3e905) STEP(G, d, a, b, c, w[2],  S22, 0xfcefa3f8) \
+    STEP(G, c, d, a, b, w[7],  S23, 0x676f02d9) STEP(G, b, c, d, a, w[12], S24, 0x8d2a4c8a) \
+    STEP(H, a, b, c, d, w[5],  S31, 0xfffa3942) STEP(H, d, a, b, c, w[8],  S32, 0x8771f681) \
+    STEP(H, c, d, a, b, w[11], S33, 0x6d9d6122) STEP(H, b, c, d, a, w[14], S34, 0xfde5380c) \
+    STEP(H, a, b, c, d, w[1],  S31, 0xa4beea44) STEP(H, d, a, b, c, w[4],  S32, 0x4bdecfa9) \
+    STEP(H, c, d, a, b, w[7],  S33, 0xf6bb4b60) STEP(H, b, c, d, a, w[10], S34, 0xbebfbc70) \
+    STEP(H, a, b, c, d, w[13], S31, 0x289b7ec6) STEP(H, d, a, b, c, w[0],  S32, 0xeaa127fa) \
+    STEP(H, c, d, a, b, w[3],  S33, 0xd4ef3085) STEP(H, b, c, d, a, w[6],  S34, 0x04881d05) \
+    STEP(H, a, b, c, d, w[9],  S31, 0xd9d4d039) STEP(H, d, a, b, c, w[12], S32, 0xe6db99e5) \
+    STEP(H, c, d, a, b, w[15], S33, 0x1fa27cf8) STEP(H, b, c, d, a, w[2],  S34, 0xc4ac5665) \
+    STEP(I, a, b, c, d, w[0],  S41, 0xf4292244) STEP(I, d, a, b, c, w[7],  S42, 0x432aff97) \
+    STEP(I, c, d, a, b, w[14], S43, 0xab9423a7) STEP(I, b, c, d, a, w[5],  S44, 0xfc93a039) \
+    STEP(I, a, b, c, d, w[12], S41, 0x655b59c3) STEP(I, d, a, b, c, w[3],  S42, 0x8f0ccc92) \
+    STEP(I, c, d, a, b, w[10], S43, 0xffeff47d) STEP(I, b, c, d, a, w[1],  S44, 0x85845dd1) \
+    STEP(I, a, b, c, d, w[8],  S41, 0x6fa87e4f) STEP(I, d, a, b, c, w[15], S42, 0xfe2ce6e0) \
+    STEP(I, c, d, a, b, w[6],  S43, 0xa3014314) STEP(I, b, c, d, a, w[13], S44, 0x4e0811a1) \
+    STEP(I, a, b, c, d, w[4],  S41, 0xf7537e82) STEP(I, d, a, b, c, w[11], S42, 0xbd3af235) \
+    STEP(I, c, d, a, b, w[2],  S43, 0x2ad7d2bb) STEP(I, b, c, d, a, w[9],  S44, 0xeb86d391)
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+
+#define AVX2_ADD(a, b) _mm256_add_epi32((a), (b))
+#define AVX2_ROTL(x, n) _mm256_or_si256(_mm256_slli_epi32((x), (n)), _mm256_srli_epi32((x), 32 - (n)))
+#define AVX2_F(b, c, d) _mm256_or_si256(_mm256_and_si256((b), (c)), _mm256_andnot_si256((b), (d)))
+#define AVX2_G(b, c, d) _mm256_or_si256(_mm256_and_si256((b), (d)), _mm256_andnot_si256((d), (c)))
+#define AVX2_H(b, c, d) _mm256_xor_si256(_mm256_xor_si256((b), (c)), (d))
+#define AVX2_I(b, c, d) _mm256_xor_si256((c), _mm256_or_si256((b), _mm256_xor_si256((d), _mm256_set1_epi32(-1))))
+#define AVX2_STEP(f, a, b, c, d, x, s, t) \
+    (a) = AVX2_ADD((a), AVX2_ADD(f((b), (c), (d)), AVX2_ADD((x), _mm256_set1_epi32((int)(t))))); \
+    (a) = AVX2_ADD(AVX2_ROTL((a), (s)), (b));
+
+__attribute__((target("avx2")))
+void md5_mb_update_avx2(uint32_t state[4][MD5_MB_MAX_LANES], const uint8_t * blocks[MD5_MB_MAX_LANES], size_t block_count) {
+
+    // Load the state, one vector per word with one lane per element
+    __m256i s[4];
+    for (size_t j = 0; j < 4; j++)
+        s[j] = _mm256_loadu_si256((const __m256i *)state[j]);
+
+    // Process each 512-bit chunk
+    for (size_t i = 0; i < block_count * 64; i += 64) {
+        __m256i w[16];
+
+        // Transpose the blocks so that w[j] holds word j of every lane (little-endian, as loaded)
+        for (size_t half = 0; half < 2; half++) {
+            __m256i r[8];
+            for (size_t lane = 0; lane < 8; lane++)
+                r[lane] = _mm256_loadu_si256((const __m256i *)(blocks[lane] + i + half * 32));
+
+            const __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+            const __m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+            const __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+            const __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+            const __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+            const __m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+            const __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+            const __m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+
+            const __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+            const __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+            const __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+            const __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+            const __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+            const __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+            const __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+            const __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+            __m256i * words = w + half * 8;
+            words[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+            words[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+            words[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+            words[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+            words[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+            words[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+            words[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+            words[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+        }
+
+        __m256i a = s[0];
+        __m256i b = s[1];
+        __m256i c = s[2];
+        __m256i d = s[3];
+
+        MD5_STEPS(AVX2_STEP, AVX2_F, AVX2_G, AVX2_H, AVX2_I, a, b, c, d, w)
+
+        s[0] = AVX2_ADD(s[0], a);
+        s[1] = AVX2_ADD(s[1], b);
+        s[2] = AVX2_ADD(s[2], c);
+        s[3] = AVX2_ADD(s[3], d);
+    }
+
+    // Update the state
+    for (size_t j = 0; j < 4; j++)
+        _mm256_storeu_si256((__m256i *)state[j], s[j]);
+}
+
+#define SSE2_ADD(a, b) _mm_add_epi32((a), (b))
+#define SSE2_ROTL(x, n) _mm_or_si128(_mm_slli_epi32((x), (n)), _mm_srli_epi32((x), 32 - (n)))
+#define SSE2_F(b, c, d) _mm_or_si128(_mm_and_si128((b), (c)), _mm_andnot_si128((b), (d)))
+#define SSE2_G(b, c, d) _mm_or_si128(_mm_and_si128((b), (d)), _mm_andnot_si128((d), (c)))
+#define SSE2_H(b, c, d) _mm_xor_si128(_mm_xor_si128((b), (c)), (d))
+#define SSE2_I(b, c, d) _mm_xor_si128((c), _mm_or_si128((b), _mm_xor_si128((d), _mm_set1_epi32(-1))))
+#define SSE2_STEP(f, a, b, c, d, x, s, t) \
+    (a) = SSE2_ADD((a), SSE2_ADD(f((b), (c), (d)), SSE2_ADD((x), _mm_set1_epi32((int)(t))))); \
+    (a) = SSE2_ADD(SSE2_ROTL((a), (s)), (b));
+
+void md5_mb_update_sse2(uint32_t state[4][MD5_MB_MAX_LANES], const uint8_t * blocks[MD5_MB_MAX_LANES], size_t block_count) {
+
+    // Load the state of the first four lanes
+    __m128i s[4];
+    for (size_t j = 0; j < 4; j++)
+        s[j] = _mm_loadu_si128((const __m128i *)state[j]);
+
+    // Process each 512-bit chunk
+    for (size_t i = 0; i < block_count * 64; i += 64) {
+        __m128i w[16];
+
+        // Transpose the blocks so that w[j] holds word j of every lane
+        for (size_t quarter = 0; quarter < 4; quarter++) {
+            const __m128i r0 = _mm_loadu_si128((const __m128i *)(blocks[0] + i + quarter * 16));
+            const __m128i r1 = _mm_loadu_si128((const __m128i *)(blocks[1] + i + quarter * 16));
+            const __m128i r2 = _mm_loadu_si128((const __m128i *)(blocks[2] + i + quarter * 16));
+            const __m128i r3 = _mm_loadu_si128((const __m128i *)(blocks[3] + i + quarter * 16));
+
+            const __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+            const __m128i t1 = _mm_unpackhi_epi32(r0, r1);
+            const __m128i t2 = _mm_unpacklo_epi32(r2, r3);
+            const __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+            __m128i * words = w + quarter * 4;
+            words[0] = _mm_unpacklo_epi64(t0, t2);
+            words[1] = _mm_unpackhi_epi64(t0, t2);
+            words[2] = _mm_unpacklo_epi64(t1, t3);
+            words[3] = _mm_unpackhi_epi64(t1, t3);
+        }
+
+        __m128i a = s[0];
+        __m128i b = s[1];
+        __m128i c = s[2];
+        __m128i d = s[3];
+
+        MD5_STEPS(SSE2_STEP, SSE2_F, SSE2_G, SSE2_H, SSE2_I, a, b, c, d, w)
+
+        s[0] = SSE2_ADD(s[0], a);
+        s[1] = SSE2_ADD(s[1], b);
+        s[2] = SSE2_ADD(s[2], c);
+        s[3] = SSE2_ADD(s[3], d);
+    }
+
+    // Update the state
+    for (size_t j = 0; j < 4; j++)
+        _mm_storeu_si128((__m128i *)state[j], s[j]);
+}
+#endif
+
+/// @brief Multi-buffer kernel and its number of lanes, chosen by the kernel registry (0 lanes when off)
+static md5_mb_update_t md5_mb_update;
+static size_t md5_mb_lanes;
+
+void md5_mb_use(md5_mb_update_t update, size_t lanes) {
+    md5_mb_update = update;
+    md5_mb_lanes = update ? lanes : 0;
+}
+
+/// @brief Pad a message of at most SHORT_MESSAGE_MAX bytes into a single block
+static void md5_short_block(uint8_t block[BLOCK_SIZE], const uint8_t * message, size_t size) {
+    memset(block, 0, BLOCK_SIZE);
+    memcpy(block, message, size);
+    block[size] = 0x80;
+    const uint64_t bit_size = (uint64_t)size * 8;
+    memcpy(block + BLOCK_SIZE - 8, &bit_size, 8);
+}
+
+void md5_short(const uint8_t * const * messages, const size_t * sizes, size_t count, uint32_t (*hashes)[8]) {
+
+    uint8_t blocks[MD5_MB_MAX_LANES][BLOCK_SIZE];
+
+    // One block at a time without SIMD lanes
+    if (!md5_mb_lanes) {
+        uint8_t chunk[CHUNK_SIZE_TOTAL]; // sized as the md5_update prototype expects
+        for (size_t i = 0; i < count; i++) {
+            md5_short_block(chunk, messages[i], sizes[i]);
+            md5_init(hashes[i]);
+            md5_update(chunk, BLOCK_SIZE, hashes[i]);
+            md5_final(hashes[i]);
+        }
+        return;
+    }
+
+    uint32_t initial[4];
+    md5_init(initial);
+
+    for (size_t i = 0; i < count; i += md5_mb_lanes) {
+
+        // Idle lanes (past the last message) hash the first block again
+        const size_t used = count - i < md5_mb_lanes ? count - i : md5_mb_lanes;
+        const uint8_t * lanes[MD5_MB_MAX_LANES];
+        uint32_t state[4][MD5_MB_MAX_LANES];
+        for (size_t l = 0; l < MD5_MB_MAX_LANES; l++) {
+            if (l < used)
+                md5_short_block(blocks[l], messages[i + l], sizes[i + l]);
+            lanes[l] = l < used ? blocks[l] : blocks[0];
+            for (size_t j = 0; j < 4; j++)
+                state[j][l] = initial[j];
+        }
+
+        md5_mb_update(state, lanes, 1);
+
+        for (size_t l = 0; l < used; l++) {
+            for (size_t j = 0; j < 4; j++)
+                hashes[i + l][j] = state[j][l];
+            md5_final(hashes[i + l]);
+        }
+    }
+}
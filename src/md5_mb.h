@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stddef.h> // for size_t
+#include <stdint.h> // for uint32_t, uint8_t
+
+/// @brief The maximum number of independent MD5 states hashed side by side
+#define MD5_MB_MAX_LANES 8
+
+/// @brief Hash `block_count` consecutive blocks for each lane, with the state transposed (state[word][lane])
+typedef void (*md5_mb_update_t)(uint32_t state[4][MD5_MB_MAX_LANES], const uint8_t * blocks[MD5_MB_MAX_LANES], size_t block_count);
+
+#if defined(__x86_64__)
+void md5_mb_update_avx2(uint32_t state[4][MD5_MB_MAX_LANES], const uint8_t * blocks[MD5_MB_MAX_LANES], size_t block_count);
+void md5_mb_update_sse2(uint32_t state[4][MD5_MB_MAX_LANES], const uint8_t * blocks[MD5_MB_MAX_LANES], size_t block_count);
+#endif
+
+/// @brief Hash in `lanes` SIMD lanes with `update`, or never side by side with NULL (for the kernel registry)
+void md5_mb_use(md5_mb_update_t update, size_t lanes);
+
+/// @brief Hash independent messages of at most SHORT_MESSAGE_MAX bytes, one padded block each, several per SIMD pass
+void md5_short(const uint8_t * const * messages, const size_t * sizes, size_t count, uint32_t (*hashes)[8]);
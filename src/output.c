@@ -0,0 +1,77 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "digest.h"
+#include "output.h"
+#include "utils.h"
+
+#define OUTPUT_HEX_ROW(high) \
+    high "0" high "1" high "2" high "3" high "4" high "5" high "6" high "7" \
+    high "8" high "9" high "a" high "b" high "c" high "d" high "e" high "f"
+
+/// @brief The two hex digits of every byte value, "000102...ff"
+static const char output_hex_pairs[] =
+    OUTPUT_HEX_ROW("0") OUTPUT_HEX_ROW("1") OUTPUT_HEX_ROW("2") OUTPUT_HEX_ROW("3")
+    OUTPUT_HEX_ROW("4") OUTPUT_HEX_ROW("5") OUTPUT_HEX_ROW("6") OUTPUT_HEX_ROW("7")
+    OUTPUT_HEX_ROW("8") OUTPUT_HEX_ROW("9") OUTPUT_HEX_ROW("a") OUTPUT_HEX_ROW("b")
+    OUTPUT_HEX_ROW("c") OUTPUT_HEX_ROW("d") OUTPUT_HEX_ROW("e") OUTPUT_HEX_ROW("f");
+
+/// @note Only the main thread prints, so the buffer needs no lock
+static uint8_t output_buffer[OUTPUT_BUFFER_SIZE];
+static size_t output_size;
+
+void output_flush(void) {
+    write_all(STDOUT_FILENO, output_buffer, output_size);
+    output_size = 0;
+}
+
+void output_write(const void * data, size_t size) {
+    if (output_size + size > OUTPUT_BUFFER_SIZE) {
+        output_flush();
+        // Echoed inputs and such are not worth copying
+        if (size > OUTPUT_BUFFER_SIZE / 2) {
+            write_all(STDOUT_FILENO, data, size);
+            return;
+        }
+    }
+    memcpy(output_buffer + output_size, data, size);
+    output_size += size;
+}
+
+void output_string(const char * str) {
+    output_write(str, strlen(str));
+}
+
+void output_format_hex(const uint32_t * hash, size_t word_count, uint8_t * out) {
+    for (size_t i = 0; i < word_count; i++) {
+        memcpy(out, output_hex_pairs + 2 * (hash[i] >> 24), 2);
+        memcpy(out + 2, output_hex_pairs + 2 * ((hash[i] >> 16) & 0xff), 2);
+        memcpy(out + 4, output_hex_pairs + 2 * ((hash[i] >> 8) & 0xff), 2);
+        memcpy(out + 6, output_hex_pairs + 2 * (hash[i] & 0xff), 2);
+        out += 8;
+    }
+}
+
+void output_hex(const uint32_t * hash, size_t word_count) {
+    if (output_size + word_count * 8 > OUTPUT_BUFFER_SIZE)
+        output_flush();
+    output_format_hex(hash, word_count, output_buffer + output_size);
+    output_size += word_count * 8;
+}
+
+void output_raw(const uint32_t * hash, size_t word_count) {
+    if (output_size + word_count * 4 > OUTPUT_BUFFER_SIZE)
+        output_flush();
+    ft_ssl_digest_bytes(hash, word_count, output_buffer + output_size);
+    output_size += word_count * 4;
+}
+
+void output_end_record(void) {
+    static int interactive = -1;
+    if (interactive == -1)
+        interactive = isatty(STDOUT_FILENO);
+    if (interactive)
+        output_flush();
+}
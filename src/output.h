@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stddef.h> // for size_t
+#include <stdint.h> // for uint32_t
+
+/// @brief Size of the standard output buffer (flushed in one write when full)
+#define OUTPUT_BUFFER_SIZE (1024 * 1024)
+
+/// @brief Append bytes to the standard output buffer (large ones are written through)
+void output_write(const void * data, size_t size);
+
+/// @brief Append a NUL-terminated string to the standard output buffer
+void output_string(const char * str);
+
+/// @brief Write the lowercase hex digits of the hash words to `out` (word_count * 8 bytes, not NUL-terminated)
+void output_format_hex(const uint32_t * hash, size_t word_count, uint8_t * out);
+
+/// @brief Append the lowercase hex digits of the hash words, most significant byte first
+void output_hex(const uint32_t * hash, size_t word_count);
+
+/// @brief Append the digest bytes of the hash words, as ft_ssl_digest_bytes lays them out
+void output_raw(const uint32_t * hash, size_t word_count);
+
+/// @brief End of an output record: flushed right away on a terminal, buffered otherwise
+void output_end_record(void);
+
+/// @brief Write the buffered output
+void output_flush(void);
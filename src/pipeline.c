@@ -0,0 +1,134 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "pipeline.h"
+
+/// @brief Fill a buffer completely, unless the input ends first
+static void pipeline_fill(pipeline_t * pipeline, pipeline_buffer_t * buffer) {
+
+    buffer->size = 0;
+    buffer->eof = false;
+
+    while (buffer->size < pipeline->buffer_size) {
+        const ssize_t read_bytes = read(pipeline->fd, buffer->data + buffer->size, pipeline->buffer_size - buffer->size);
+        if (read_bytes < 0 && errno == EINTR)
+            continue;
+        // Read errors end the input, like they do for fread
+        if (read_bytes <= 0) {
+            buffer->eof = true;
+            return;
+        }
+        buffer->size += (size_t)read_bytes;
+    }
+}
+
+static void * pipeline_read(void * arg) {
+
+    pipeline_t * pipeline = arg;
+    bool eof = false;
+
+    while (!eof) {
+
+        // Wait for a free buffer
+        pthread_mutex_lock(&pipeline->lock);
+        while (pipeline->count == PIPELINE_BUFFERS && !pipeline->stopped)
+            pthread_cond_wait(&pipeline->drained, &pipeline->lock);
+        if (pipeline->stopped) {
+            pthread_mutex_unlock(&pipeline->lock);
+            break;
+        }
+        pipeline_buffer_t * buffer = &pipeline->buffers[pipeline->head];
+        pthread_mutex_unlock(&pipeline->lock);
+
+        // Read without holding the lock, so that the consumer keeps hashing
+        pipeline_fill(pipeline, buffer);
+        eof = buffer->eof;
+
+        // Publish the buffer
+        pthread_mutex_lock(&pipeline->lock);
+        pipeline->head = (pipeline->head + 1) % PIPELINE_BUFFERS;
+        pipeline->count++;
+        pthread_cond_signal(&pipeline->filled);
+        pthread_mutex_unlock(&pipeline->lock);
+    }
+
+    return NULL;
+}
+
+static void pipeline_free(pipeline_t * pipeline) {
+    for (size_t i = 0; i < PIPELINE_BUFFERS; i++)
+        free(pipeline->buffers[i].data);
+    pthread_cond_destroy(&pipeline->drained);
+    pthread_cond_destroy(&pipeline->filled);
+    pthread_mutex_destroy(&pipeline->lock);
+}
+
+bool pipeline_start(pipeline_t * pipeline, int fd, size_t buffer_size) {
+
+    pipeline->fd = fd;
+    pipeline->buffer_size = buffer_size;
+    pipeline->head = 0;
+    pipeline->tail = 0;
+    pipeline->count = 0;
+    pipeline->stopped = false;
+    pthread_mutex_init(&pipeline->lock, NULL);
+    pthread_cond_init(&pipeline->filled, NULL);
+    pthread_cond_init(&pipeline->drained, NULL);
+
+    // Page-aligned buffers keep the kernel copies (and O_DIRECT-like filesystems) on the fast path
+    const size_t alignment = (size_t)sysconf(_SC_PAGESIZE);
+    for (size_t i = 0; i < PIPELINE_BUFFERS; i++) {
+        void * data = NULL;
+        if (posix_memalign(&data, alignment, buffer_size) != 0)
+            data = NULL;
+        pipeline->buffers[i].data = data;
+    }
+
+    for (size_t i = 0; i < PIPELINE_BUFFERS; i++) {
+        if (!pipeline->buffers[i].data) {
+            pipeline_free(pipeline);
+            return false;
+        }
+    }
+
+    if (pthread_create(&pipeline->reader, NULL, pipeline_read, pipeline) != 0) {
+        pipeline_free(pipeline);
+        return false;
+    }
+
+    return true;
+}
+
+const pipeline_buffer_t * pipeline_acquire(pipeline_t * pipeline) {
+
+    pthread_mutex_lock(&pipeline->lock);
+    while (pipeline->count == 0)
+        pthread_cond_wait(&pipeline->filled, &pipeline->lock);
+    const pipeline_buffer_t * buffer = &pipeline->buffers[pipeline->tail];
+    pthread_mutex_unlock(&pipeline->lock);
+
+    return buffer;
+}
+
+void pipeline_release(pipeline_t * pipeline) {
+
+    pthread_mutex_lock(&pipeline->lock);
+    pipeline->tail = (pipeline->tail + 1) % PIPELINE_BUFFERS;
+    pipeline->count--;
+    pthread_cond_signal(&pipeline->drained);
+    pthread_mutex_unlock(&pipeline->lock);
+}
+
+void pipeline_stop(pipeline_t * pipeline) {
+
+    pthread_mutex_lock(&pipeline->lock);
+    pipeline->stopped = true;
+    pthread_cond_signal(&pipeline->drained);
+    pthread_mutex_unlock(&pipeline->lock);
+
+    pthread_join(pipeline->reader, NULL);
+    pipeline_free(pipeline);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <pthread.h> // for pthread_t, pthread_mutex_t, pthread_cond_t
+#include <stdbool.h> // for bool
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint8_t
+
+/// @brief The number of buffers in the ring between the reader and the hashing thread
+#define PIPELINE_BUFFERS 4
+
+/// @brief Default size of each pipeline buffer (4 MiB)
+#define PIPELINE_BUFFER_SIZE (4 * 1024 * 1024)
+
+/// @brief A buffer filled by the reader thread
+typedef struct {
+    uint8_t * data; ///< Page-aligned storage
+    size_t size;    ///< Number of bytes read (the buffer is full unless it is the last one)
+    bool eof;       ///< This is the last buffer of the input
+} pipeline_buffer_t;
+
+/// @brief Ring of buffers filled by a reader thread and drained by the hashing thread
+typedef struct {
+    int fd;                                       ///< Input file descriptor
+    size_t buffer_size;                           ///< Capacity of each buffer
+    pipeline_buffer_t buffers[PIPELINE_BUFFERS];  ///< The ring
+    size_t head;                                  ///< Next buffer to fill
+    size_t tail;                                  ///< Next buffer to hash
+    size_t count;                                 ///< Number of filled buffers
+    bool stopped;                                 ///< The consumer gave up, the reader must exit
+    pthread_mutex_t lock;                         ///< Protects the ring indices
+    pthread_cond_t filled;                        ///< Signaled when a buffer is filled
+    pthread_cond_t drained;                       ///< Signaled when a buffer is released
+    pthread_t reader;                             ///< Reader thread
+} pipeline_t;
+
+/// @brief Allocate the ring and start reading `fd` on a separate thread
+/// @return false if the buffers or the thread could not be created
+bool pipeline_start(pipeline_t * pipeline, int fd, size_t buffer_size);
+
+/// @brief Wait for the next filled buffer (the one with `eof` set comes last)
+const pipeline_buffer_t * pipeline_acquire(pipeline_t * pipeline);
+
+/// @brief Hand the buffer returned by pipeline_acquire back to the reader
+void pipeline_release(pipeline_t * pipeline);
+
+/// @brief Join the reader thread and free the ring
+void pipeline_stop(pipeline_t * pipeline);
@@ -0,0 +1,195 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pool.h"
+
+static void * pool_thread(void * arg) {
+    pool_worker_t * worker = arg;
+    worker->pool->work(worker);
+    return NULL;
+}
+
+static void pool_push_back(pool_worker_t * worker, ft_ssl_job_t * job) {
+
+    pthread_mutex_lock(&worker->lock);
+
+    // Grow the deque, unrolling it at the start of the new storage
+    if (worker->size == worker->capacity) {
+        const size_t capacity = worker->capacity ? worker->capacity * 2 : 64;
+        ft_ssl_job_t ** jobs = malloc(capacity * sizeof(ft_ssl_job_t *));
+        if (!jobs) {
+            perror("malloc");
+            exit(EXIT_FAILURE);
+        }
+        for (size_t i = 0; i < worker->size; i++)
+            jobs[i] = worker->jobs[(worker->head + i) % worker->capacity];
+        free(worker->jobs);
+        worker->jobs = jobs;
+        worker->capacity = capacity;
+        worker->head = 0;
+    }
+
+    worker->jobs[(worker->head + worker->size) % worker->capacity] = job;
+    worker->size++;
+
+    pthread_mutex_unlock(&worker->lock);
+}
+
+static ft_ssl_job_t * pool_pop_front(pool_worker_t * worker) {
+
+    ft_ssl_job_t * job = NULL;
+
+    pthread_mutex_lock(&worker->lock);
+    if (worker->size) {
+        job = worker->jobs[worker->head];
+        worker->head = (worker->head + 1) % worker->capacity;
+        worker->size--;
+    }
+    pthread_mutex_unlock(&worker->lock);
+
+    return job;
+}
+
+static ft_ssl_job_t * pool_steal_back(pool_worker_t * victim) {
+
+    ft_ssl_job_t * job = NULL;
+
+    pthread_mutex_lock(&victim->lock);
+    if (victim->size) {
+        victim->size--;
+        job = victim->jobs[(victim->head + victim->size) % victim->capacity];
+    }
+    pthread_mutex_unlock(&victim->lock);
+
+    return job;
+}
+
+void pool_start(pool_t * pool, size_t worker_count, const ft_ssl_context_t * context, void (*work)(pool_worker_t *)) {
+
+    pool->workers = calloc(worker_count, sizeof(pool_worker_t));
+    if (!pool->workers) {
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    pool->worker_count = worker_count;
+    pool->next_worker = 0;
+    pool->work = work;
+    pool->queued = 0;
+    pool->closed = false;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->available, NULL);
+    pthread_cond_init(&pool->completed, NULL);
+
+    for (size_t i = 0; i < worker_count; i++) {
+        pool_worker_t * worker = &pool->workers[i];
+        worker->pool = pool;
+        memcpy(&worker->context, context, sizeof(ft_ssl_context_t));
+        pthread_mutex_init(&worker->lock, NULL);
+        if (pthread_create(&worker->thread, NULL, pool_thread, worker) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+void pool_submit(pool_t * pool, ft_ssl_job_t * job) {
+
+    // Deal jobs round-robin, stealing evens the load out afterwards
+    // The job is counted before a worker can take it: its pool->queued-- waits for the lock held here
+    pthread_mutex_lock(&pool->lock);
+    pool_push_back(&pool->workers[pool->next_worker], job);
+    pool->next_worker = (pool->next_worker + 1) % pool->worker_count;
+    pool->queued++;
+    pthread_cond_signal(&pool->available);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+ft_ssl_job_t * pool_next(pool_worker_t * worker, bool wait) {
+
+    pool_t * pool = worker->pool;
+
+    for (;;) {
+
+        // Own deque first, then the other workers' ones
+        ft_ssl_job_t * job = pool_pop_front(worker);
+        const size_t self = (size_t)(worker - pool->workers);
+        for (size_t i = 1; !job && i < pool->worker_count; i++)
+            job = pool_steal_back(&pool->workers[(self + i) % pool->worker_count]);
+
+        pthread_mutex_lock(&pool->lock);
+        if (job) {
+            pool->queued--;
+            pthread_mutex_unlock(&pool->lock);
+            return job;
+        }
+        if (!wait) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        while (!pool->queued && !pool->closed)
+            pthread_cond_wait(&pool->available, &pool->lock);
+        const bool drained = !pool->queued && pool->closed;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (drained)
+            return NULL;
+    }
+}
+
+void pool_complete(pool_t * pool, ft_ssl_job_t * job) {
+    pthread_mutex_lock(&pool->lock);
+    job->done = true;
+    pthread_cond_broadcast(&pool->completed);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+bool pool_done(pool_t * pool, ft_ssl_job_t * job) {
+    pthread_mutex_lock(&pool->lock);
+    const bool done = job->done;
+    pthread_mutex_unlock(&pool->lock);
+    return done;
+}
+
+void pool_wait(pool_t * pool, ft_ssl_job_t * job) {
+    pthread_mutex_lock(&pool->lock);
+    while (!job->done)
+        pthread_cond_wait(&pool->completed, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static ft_ssl_job_t * pool_source_next(void * arg, bool wait) {
+    return pool_next(arg, wait);
+}
+
+static void pool_source_done(void * arg, ft_ssl_job_t * job) {
+    pool_worker_t * worker = arg;
+    pool_complete(worker->pool, job);
+}
+
+ft_ssl_job_source_t pool_source(pool_worker_t * worker) {
+    return (ft_ssl_job_source_t){pool_source_next, pool_source_done, worker};
+}
+
+void pool_stop(pool_t * pool) {
+
+    pthread_mutex_lock(&pool->lock);
+    pool->closed = true;
+    pthread_cond_broadcast(&pool->available);
+    pthread_mutex_unlock(&pool->lock);
+
+    // The workers still running steal from the deques of the ones already joined: free them only once all are done
+    for (size_t i = 0; i < pool->worker_count; i++)
+        pthread_join(pool->workers[i].thread, NULL);
+    for (size_t i = 0; i < pool->worker_count; i++) {
+        pthread_mutex_destroy(&pool->workers[i].lock);
+        free(pool->workers[i].jobs);
+    }
+
+    pthread_cond_destroy(&pool->completed);
+    pthread_cond_destroy(&pool->available);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->workers);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <pthread.h> // for pthread_t, pthread_mutex_t, pthread_cond_t
+#include <stdbool.h> // for bool
+#include <stddef.h>  // for size_t
+
+#include "ft_ssl.h" // for ft_ssl_context_t, ft_ssl_job_t, ft_ssl_job_source_t
+
+typedef struct pool_s pool_t;
+
+/// @brief A worker thread with its own context and its own deque of jobs
+typedef struct {
+    pool_t * pool;             ///< Pool the worker belongs to
+    ft_ssl_context_t context;  ///< Context used to hash the worker's jobs
+    pthread_t thread;          ///< Worker thread
+    pthread_mutex_t lock;      ///< Protects the deque
+    ft_ssl_job_t ** jobs;      ///< Circular deque: the owner pops the front, thieves steal the back
+    size_t capacity;           ///< Capacity of the deque
+    size_t head;               ///< Index of the front job
+    size_t size;               ///< Number of jobs in the deque
+} pool_worker_t;
+
+/// @brief Work-stealing thread pool
+struct pool_s {
+    pool_worker_t * workers;         ///< Workers
+    size_t worker_count;             ///< Number of workers
+    size_t next_worker;              ///< Worker that receives the next submitted job
+    void (*work)(pool_worker_t *);   ///< Main loop of each worker
+    pthread_mutex_t lock;            ///< Protects the fields below and the job `done` flags (taken before a deque lock)
+    pthread_cond_t available;        ///< Signaled when jobs are submitted or the pool is closed
+    pthread_cond_t completed;        ///< Signaled when a job is done
+    size_t queued;                   ///< Number of jobs waiting in the deques
+    bool closed;                     ///< No more jobs will be submitted
+};
+
+/// @brief Start `worker_count` workers running `work`, each with a copy of `context`
+void pool_start(pool_t * pool, size_t worker_count, const ft_ssl_context_t * context, void (*work)(pool_worker_t *));
+
+/// @brief Queue a job, from a single producer thread (the pool does not take ownership of it)
+void pool_submit(pool_t * pool, ft_ssl_job_t * job);
+
+/// @brief Take the next job for a worker, from its own deque or stolen from another one
+/// @return NULL once the pool is closed and drained, or if no job is ready and `wait` is false
+ft_ssl_job_t * pool_next(pool_worker_t * worker, bool wait);
+
+/// @brief Mark a job as done and wake up whoever waits for it
+void pool_complete(pool_t * pool, ft_ssl_job_t * job);
+
+/// @brief Whether a job is done, without waiting for it
+bool pool_done(pool_t * pool, ft_ssl_job_t * job);
+
+/// @brief Wait until a job is done
+void pool_wait(pool_t * pool, ft_ssl_job_t * job);
+
+/// @brief The jobs of a worker as a job source: pool_next, then pool_complete
+ft_ssl_job_source_t pool_source(pool_worker_t * worker);
+
+/// @brief Stop accepting jobs, let the workers drain the deques and join them
+void pool_stop(pool_t * pool);
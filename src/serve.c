@@ -0,0 +1,500 @@
+#define _GNU_SOURCE // for accept4
+
+#include <errno.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "digest.h"
+#include "output.h"
+#include "pool.h"
+#include "serve.h"
+#include "utils.h"
+
+/// @brief Initial size of the input buffer of a connection
+#define SERVE_INPUT_SIZE (64 * 1024)
+
+/// @brief Unsent answers of a connection before the server stops reading it
+#define SERVE_OUTPUT_MAX (1024 * 1024)
+
+/// @brief A request of a connection, answered in arrival order
+typedef struct serve_request_s {
+    ft_ssl_job_t job;                      ///< Job of the pool (first member: the workers only see it)
+    const ft_ssl_algorithm_t * algorithm;  ///< Algorithm of the request (NULL if unknown)
+    uint8_t * payload;                     ///< Inline payload of a data request
+    const char * failure;                  ///< Protocol error answered instead of a digest
+    struct serve_request_s * next;         ///< Next request of the connection
+} serve_request_t;
+
+/// @brief A client connection, with its unparsed input and its unsent answers
+typedef struct {
+    int fd;                       ///< Connected socket (non-blocking)
+    uint8_t * input;              ///< Bytes received but not parsed yet
+    size_t input_size;            ///< Number of bytes in input
+    size_t input_capacity;        ///< Capacity of input
+    uint8_t * output;             ///< Answers not sent yet
+    size_t output_size;           ///< Number of bytes in output
+    size_t output_capacity;       ///< Capacity of output
+    serve_request_t * head;       ///< Oldest unanswered request
+    serve_request_t * tail;       ///< Newest unanswered request
+    size_t pending;               ///< Number of unanswered requests
+    bool eof;                     ///< No more requests will be read
+    bool broken;                  ///< The client is gone: answers are dropped
+} serve_connection_t;
+
+/// @brief State of the server loop
+typedef struct {
+    pool_t pool;                         ///< Workers hashing the requests
+    int listen_fd;                       ///< Listening socket
+    serve_connection_t ** connections;   ///< Open connections
+    size_t connection_count;             ///< Number of open connections
+    size_t connection_capacity;          ///< Capacity of connections
+    struct pollfd * fds;                 ///< Poll set: listening socket, wakeup, then the connections
+} serve_t;
+
+enum {
+    LONG_OPTION_SOCKET = 256,
+};
+
+static const struct option serve_long_options[] = {
+    {"socket", required_argument, NULL, LONG_OPTION_SOCKET},
+    {NULL, 0, NULL, 0}
+};
+
+/// @brief Written by the workers when a request is done, to wake up the loop
+static int serve_wakeup_fd = -1;
+
+/// @brief Set by SIGINT and SIGTERM
+static volatile sig_atomic_t serve_stopping = 0;
+
+static void serve_usage(void) {
+    fprintf(stderr, "Usage: ft_ssl serve --socket path [-j jobs]\n");
+    fprintf(stderr, "  --socket path  Unix domain socket to listen on (a stale one is replaced)\n");
+    fprintf(stderr, "  -j jobs        number of requests hashed in parallel (default: number of online CPUs)\n");
+}
+
+static void serve_stop(int signal) {
+    (void)signal;
+    serve_stopping = 1;
+}
+
+static void * serve_grow(void * data, size_t * capacity, size_t needed) {
+    size_t size = *capacity;
+    while (size < needed)
+        size *= 2;
+    if (size == *capacity)
+        return data;
+    data = realloc(data, size);
+    if (!data) {
+        perror("realloc");
+        exit(EXIT_FAILURE);
+    }
+    *capacity = size;
+    return data;
+}
+
+/// @brief Main loop of the pool workers
+static void serve_worker(pool_worker_t * worker) {
+
+    ft_ssl_job_t * job;
+    while ((job = pool_next(worker, true))) {
+        serve_request_t * request = (serve_request_t *)job;
+        if (job->filename) {
+            #pragma GCC diagnostic push
+            #pragma GCC diagnostic ignored "-Wcast-qual"
+            worker->context.entry.data = (ft_ssl_algorithm_t *)request->algorithm;
+            #pragma GCC diagnostic pop
+            ft_ssl_hash_job(&worker->context, job);
+        } else {
+            ft_ssl_hash_buffer(request->algorithm, job->data, job->size, job->hash);
+        }
+        pool_complete(worker->pool, job);
+        const uint64_t one = 1;
+        write(serve_wakeup_fd, &one, sizeof(one));
+    }
+}
+
+static void serve_enqueue(serve_connection_t * connection, serve_request_t * request) {
+    if (connection->tail)
+        connection->tail->next = request;
+    else
+        connection->head = request;
+    connection->tail = request;
+    connection->pending++;
+}
+
+static void serve_free_request(serve_request_t * request) {
+    free(request->job.filename);
+    free(request->payload);
+    free(request);
+}
+
+/// @brief Queue an answer that does not need the pool
+static void serve_fail(serve_connection_t * connection, serve_request_t * request, const char * failure) {
+    request->failure = failure;
+    request->job.done = true;
+    serve_enqueue(connection, request);
+}
+
+/// @brief Parse the complete requests of the input buffer, submitting them to the pool
+/// @return The number of requests parsed
+static size_t serve_parse(serve_t * server, serve_connection_t * connection) {
+
+    size_t start = 0;
+    size_t parsed = 0;
+    while (!connection->eof && connection->pending < SERVE_PIPELINE_DEPTH) {
+
+        const uint8_t * line = connection->input + start;
+        const size_t available = connection->input_size - start;
+        const uint8_t * end = memchr(line, '\n', available);
+        const size_t length = end ? (size_t)(end - line) : available;
+        if (!end && length <= SERVE_MAX_LINE)
+            break;
+
+        serve_request_t * request = calloc(1, sizeof(serve_request_t));
+        if (!request) {
+            perror("calloc");
+            exit(EXIT_FAILURE);
+        }
+        parsed++;
+
+        // `<algorithm> <kind> <argument>`
+        char text[SERVE_MAX_LINE + 1];
+        char * kind = NULL;
+        char * argument = NULL;
+        if (length <= SERVE_MAX_LINE) {
+            memcpy(text, line, length);
+            text[length] = '\0';
+            if ((kind = strchr(text, ' ')))
+                *kind++ = '\0';
+            if (kind && (argument = strchr(kind, ' ')))
+                *argument++ = '\0';
+        }
+
+        // The rest of the stream cannot be trusted once a request is malformed
+        size_t size = 0;
+        char * size_end = NULL;
+        if (argument && strcmp(kind, "data") == 0) {
+            errno = 0;
+            size = strtoull(argument, &size_end, 10);
+        }
+        const bool is_file = argument && strcmp(kind, "file") == 0 && *argument;
+        const bool is_data = size_end && *argument >= '0' && *argument <= '9' && !*size_end && errno == 0 && size <= SERVE_MAX_PAYLOAD;
+        if (!is_file && !is_data) {
+            serve_fail(connection, request, "malformed request");
+            connection->eof = true;
+            start = connection->input_size;
+            break;
+        }
+
+        // Wait for the whole payload
+        if (is_data && available - length - 1 < size) {
+            free(request);
+            parsed--;
+            connection->input = serve_grow(connection->input, &connection->input_capacity, length + 1 + size);
+            break;
+        }
+
+        if (is_file) {
+            request->job.filename = strdup(argument);
+            if (!request->job.filename) {
+                perror("strdup");
+                exit(EXIT_FAILURE);
+            }
+        } else {
+            request->payload = malloc(size ? size : 1);
+            if (!request->payload) {
+                perror("malloc");
+                exit(EXIT_FAILURE);
+            }
+            memcpy(request->payload, line + length + 1, size);
+            request->job.data = request->payload;
+            request->job.size = size;
+        }
+        start += length + 1 + (is_data ? size : 0);
+
+        request->algorithm = ft_ssl_algorithm(text);
+        if (!request->algorithm) {
+            serve_fail(connection, request, "unknown algorithm");
+            continue;
+        }
+        serve_enqueue(connection, request);
+        pool_submit(&server->pool, &request->job);
+    }
+
+    memmove(connection->input, connection->input + start, connection->input_size - start);
+    connection->input_size -= start;
+    return parsed;
+}
+
+static void serve_append(serve_connection_t * connection, const void * data, size_t size) {
+    connection->output = serve_grow(connection->output, &connection->output_capacity, connection->output_size + size);
+    memcpy(connection->output + connection->output_size, data, size);
+    connection->output_size += size;
+}
+
+/// @brief Move the done requests at the head of the connection to its output, in order
+/// @return The number of requests answered
+static size_t serve_answer(serve_t * server, serve_connection_t * connection) {
+
+    size_t answered = 0;
+    serve_request_t * request;
+    while ((request = connection->head) && pool_done(&server->pool, &request->job)) {
+
+        if (!connection->broken) {
+            if (request->failure || request->job.error) {
+                const char * reason = request->failure ? request->failure : strerror(request->job.error);
+                serve_append(connection, "error: ", 7);
+                serve_append(connection, reason, strlen(reason));
+            } else {
+                uint8_t hex[FT_SSL_MAX_DIGEST_SIZE * 2];
+                output_format_hex(request->job.hash, request->algorithm->word_count, hex);
+                serve_append(connection, hex, request->algorithm->word_count * 8);
+            }
+            serve_append(connection, "\n", 1);
+        }
+
+        if (!(connection->head = request->next))
+            connection->tail = NULL;
+        connection->pending--;
+        serve_free_request(request);
+        answered++;
+    }
+    return answered;
+}
+
+static void serve_receive(serve_connection_t * connection) {
+
+    connection->input = serve_grow(connection->input, &connection->input_capacity, connection->input_size + 1);
+    const ssize_t received = recv(connection->fd, connection->input + connection->input_size, connection->input_capacity - connection->input_size, MSG_DONTWAIT);
+    if (received > 0)
+        connection->input_size += (size_t)received;
+    else if (received == 0)
+        connection->eof = true;
+    else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        connection->eof = connection->broken = true;
+}
+
+static void serve_send(serve_connection_t * connection) {
+
+    const ssize_t sent = send(connection->fd, connection->output, connection->output_size, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (sent > 0) {
+        memmove(connection->output, connection->output + sent, connection->output_size - (size_t)sent);
+        connection->output_size -= (size_t)sent;
+    } else if (sent == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        connection->eof = connection->broken = true;
+    }
+}
+
+static void serve_accept(serve_t * server) {
+
+    int fd;
+    while ((fd = accept4(server->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1) {
+
+        if (server->connection_count == server->connection_capacity) {
+            server->connection_capacity = server->connection_capacity ? server->connection_capacity * 2 : 16;
+            server->connections = realloc(server->connections, server->connection_capacity * sizeof(serve_connection_t *));
+            server->fds = realloc(server->fds, (server->connection_capacity + 2) * sizeof(struct pollfd));
+            if (!server->connections || !server->fds) {
+                perror("realloc");
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        serve_connection_t * connection = calloc(1, sizeof(serve_connection_t));
+        if (!connection || !(connection->input = malloc(SERVE_INPUT_SIZE)) || !(connection->output = malloc(SERVE_INPUT_SIZE))) {
+            perror("malloc");
+            exit(EXIT_FAILURE);
+        }
+        connection->fd = fd;
+        connection->input_capacity = SERVE_INPUT_SIZE;
+        connection->output_capacity = SERVE_INPUT_SIZE;
+        server->connections[server->connection_count++] = connection;
+    }
+}
+
+static void serve_close(serve_connection_t * connection) {
+    close(connection->fd);
+    free(connection->input);
+    free(connection->output);
+    free(connection);
+}
+
+/// @brief Listen on a Unix domain socket, replacing a stale one nobody listens on anymore
+/// @return The listening socket, or -1 with errno set
+static int serve_listen(const char * path) {
+
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1)
+        return -1;
+    int bound = bind(fd, (struct sockaddr *)&address, sizeof(address));
+    if (bound == -1 && errno == EADDRINUSE) {
+        const int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        const bool stale = probe != -1 && connect(probe, (struct sockaddr *)&address, sizeof(address)) == -1 && errno == ECONNREFUSED;
+        if (probe != -1)
+            close(probe);
+        if (stale && unlink(path) == 0)
+            bound = bind(fd, (struct sockaddr *)&address, sizeof(address));
+        else if (!stale)
+            errno = EADDRINUSE;
+    }
+    if (bound == -1 || listen(fd, SOMAXCONN) == -1) {
+        const int error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
+
+/// @brief Poll the sockets until a signal stops the server
+static void serve_loop(serve_t * server) {
+
+    while (!serve_stopping) {
+
+        // Connections with too much in flight are not read until they catch up
+        server->fds[0] = (struct pollfd){server->listen_fd, POLLIN, 0};
+        server->fds[1] = (struct pollfd){serve_wakeup_fd, POLLIN, 0};
+        for (size_t i = 0; i < server->connection_count; i++) {
+            serve_connection_t * connection = server->connections[i];
+            short events = 0;
+            if (!connection->eof && connection->pending < SERVE_PIPELINE_DEPTH && connection->output_size < SERVE_OUTPUT_MAX)
+                events |= POLLIN;
+            if (connection->output_size && !connection->broken)
+                events |= POLLOUT;
+            // A hung up socket would be reported again and again while its last requests are hashed
+            server->fds[i + 2] = (struct pollfd){events ? connection->fd : -1, events, 0};
+        }
+
+        if (poll(server->fds, server->connection_count + 2, -1) == -1) {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            break;
+        }
+
+        if (server->fds[1].revents & POLLIN) {
+            uint64_t count;
+            read(serve_wakeup_fd, &count, sizeof(count));
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < server->connection_count; i++) {
+            serve_connection_t * connection = server->connections[i];
+
+            if (server->fds[i + 2].revents & (POLLIN | POLLHUP | POLLERR))
+                serve_receive(connection);
+            while (serve_parse(server, connection) + serve_answer(server, connection))
+                continue;
+            if (connection->output_size && !connection->broken)
+                serve_send(connection);
+            if (connection->broken)
+                connection->output_size = 0;
+
+            // Requests still in the pool point into the connection
+            if (connection->eof && !connection->pending && !connection->output_size)
+                serve_close(connection);
+            else
+                server->connections[kept++] = connection;
+        }
+        server->connection_count = kept;
+
+        // After the connections: the poll set may be reallocated
+        if (server->fds[0].revents & POLLIN)
+            serve_accept(server);
+    }
+}
+
+int serve_main(int ac, char ** av) {
+
+    const char * path = NULL;
+    const long online_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t worker_count = online_cpus > 0 ? (size_t)online_cpus : 1;
+
+    int opt;
+    while ((opt = getopt_long(ac, av, "+j:", serve_long_options, NULL)) != -1) {
+        switch (opt) {
+            case LONG_OPTION_SOCKET:
+                path = optarg;
+                break;
+            case 'j': {
+                char * end;
+                const long jobs = strtol(optarg, &end, 10);
+                if (*end || end == optarg || jobs < 1 || jobs > FT_SSL_MAX_WORKERS) {
+                    serve_usage();
+                    return EXIT_FAILURE;
+                }
+                worker_count = (size_t)jobs;
+                break;
+            }
+            default:
+                serve_usage();
+                return EXIT_FAILURE;
+        }
+    }
+    if (!path || optind != ac) {
+        serve_usage();
+        return EXIT_FAILURE;
+    }
+
+    serve_t server = {0};
+    if ((server.listen_fd = serve_listen(path)) == -1) {
+        fprintf(stderr, "ft_ssl: serve: %s: %s\n", path, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if ((serve_wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1) {
+        perror("eventfd");
+        return EXIT_FAILURE;
+    }
+    if (!(server.fds = malloc(2 * sizeof(struct pollfd)))) {
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
+
+    // No SA_RESTART: the signal has to interrupt poll
+    struct sigaction action = {.sa_handler = serve_stop};
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    // The workers pick the algorithm of each request
+    ft_ssl_context_t context;
+    memset(&context, 0, sizeof(context));
+    context.leaf_size = TREE_LEAF_SIZE;
+    context.worker_count = 1;
+    pool_start(&server.pool, worker_count, &context, serve_worker);
+
+    serve_loop(&server);
+
+    close(server.listen_fd);
+    unlink(path);
+    pool_stop(&server.pool);
+    for (size_t i = 0; i < server.connection_count; i++) {
+        while (server.connections[i]->head) {
+            serve_request_t * request = server.connections[i]->head;
+            server.connections[i]->head = request->next;
+            serve_free_request(request);
+        }
+        serve_close(server.connections[i]);
+    }
+    free(server.connections);
+    free(server.fds);
+    close(serve_wakeup_fd);
+    return serve_stopping ? EXIT_SUCCESS : EXIT_FAILURE;
+}
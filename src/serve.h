@@ -0,0 +1,20 @@
+#pragma once
+
+/// @brief Requests of a connection hashed or waiting to be, before the server stops reading it
+#define SERVE_PIPELINE_DEPTH 64
+
+/// @brief Largest inline payload of a request (64 MiB)
+#define SERVE_MAX_PAYLOAD (64 * 1024 * 1024)
+
+/// @brief Longest request line (a path, plus the algorithm and the request kind)
+#define SERVE_MAX_LINE 8192
+
+/// @brief `ft_ssl serve --socket path [-j jobs]`: hash the requests of local clients on a worker pool
+/// @details Every request is a line, answered by a line in the same order on its connection:
+///   `<algorithm> file <path>\n`          hash a file, read by the server
+///   `<algorithm> data <size>\n<bytes>`   hash the `size` bytes following the line
+/// The answer is the hex digest, or `error: <reason>`. A malformed request is answered, then the connection closed.
+/// @param ac Argument count, starting at "serve"
+/// @param av Arguments, starting at "serve"
+/// @return The exit status
+int serve_main(int ac, char ** av);
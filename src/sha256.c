@@ -2,11 +2,13 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "cpu.h"
 #include "ft_ssl.h"
+#include "kernel.h"
 #include "sha256.h"
-#include "utils.h"
+#include "sha256_mb.h"
 
-static void sha256_init(uint32_t hash[8]) {
+void sha256_init(uint32_t hash[8]) {
     hash[0] = 0x6a09e667;
     hash[1] = 0xbb67ae85;
     hash[2] = 0x3c6ef372;
@@ -17,7 +19,7 @@ static void sha256_init(uint32_t hash[8]) {
     hash[7] = 0x5be0cd19;
 }
 
-static void sha256_pad(uint8_t chunk[CHUNK_SIZE_TOTAL], size_t * chunk_size, size_t message_size) {
+void sha256_pad(uint8_t chunk[CHUNK_SIZE_TOTAL], size_t * chunk_size, size_t message_size) {
 
     // Append the bit '1' to the message
     chunk[*chunk_size] = 0x80;
@@ -51,7 +53,8 @@ static void sha256_pad(uint8_t chunk[CHUNK_SIZE_TOTAL], size_t * chunk_size, siz
     // *chunk_size is now the total size of the padded message, a multiple of 64.
 }
 
-static void sha256_update(uint8_t chunk[CHUNK_SIZE_TOTAL], size_t chunk_size, uint32_t hash[8]) {
+/// @brief The compression function as the specification writes it: a 64-word schedule and a loop over the rounds
+static void sha256_update_reference(const uint8_t chunk[CHUNK_SIZE_TOTAL], size_t chunk_size, uint32_t hash[8]) {
 
     // Load the state
     uint32_t a0 = hash[0];
@@ -128,8 +131,118 @@ static void sha256_update(uint8_t chunk[CHUNK_SIZE_TOTAL], size_t chunk_size, ui
     hash[7] = h0;
 }
 
-void sha256(ft_ssl_context_t * context, FILE * file) {
-    sha256_init(context->hash);
-    process_input(context, file, sha256_pad, sha256_update);
-    ft_ssl_print(context, file);
+/// @brief One round, with the working variables rotating through the arguments instead of being moved
+#define SHA256_ROUND(a, b, c, d, e, f, g, h, k, w) \
+    do { \
+        const uint32_t t1 = (h) + BSIG1(e) + CH(e, f, g) + (k) + (w); \
+        (d) += t1; \
+        (h) = t1 + BSIG0(a) + MAJ(a, b, c); \
+    } while (0)
+
+/// @brief Eight rounds from round j, after which the variables are back in place
+#define SHA256_ROUNDS_8(j, W) \
+    SHA256_ROUND(a, b, c, d, e, f, g, h, sha256_context.k[(j)], W(j)); \
+    SHA256_ROUND(h, a, b, c, d, e, f, g, sha256_context.k[(j) + 1], W((j) + 1)); \
+    SHA256_ROUND(g, h, a, b, c, d, e, f, sha256_context.k[(j) + 2], W((j) + 2)); \
+    SHA256_ROUND(f, g, h, a, b, c, d, e, sha256_context.k[(j) + 3], W((j) + 3)); \
+    SHA256_ROUND(e, f, g, h, a, b, c, d, sha256_context.k[(j) + 4], W((j) + 4)); \
+    SHA256_ROUND(d, e, f, g, h, a, b, c, sha256_context.k[(j) + 5], W((j) + 5)); \
+    SHA256_ROUND(c, d, e, f, g, h, a, b, sha256_context.k[(j) + 6], W((j) + 6)); \
+    SHA256_ROUND(b, c, d, e, f, g, h, a, sha256_context.k[(j) + 7], W((j) + 7)); \
+    (void)0
+
+/// @brief Words of the first 16 rounds, loaded from the block (big-endian)
+#define SHA256_LOAD(j) \
+    (w[j] = (uint32_t)block[4 * (j)] << 24 | (uint32_t)block[4 * (j) + 1] << 16 | (uint32_t)block[4 * (j) + 2] << 8 | block[4 * (j) + 3])
+
+/// @brief Words of the other rounds: the schedule keeps the last 16 words only, each new one replacing the oldest
+#define SHA256_SCHEDULE(j) \
+    (w[(j) & 15] += SSIG1(w[((j) - 2) & 15]) + w[((j) - 7) & 15] + SSIG0(w[((j) - 15) & 15]))
+
+/// @brief Fully unrolled compression function: round constants are immediates, and the schedule fits in registers
+static void sha256_update_unrolled(const uint8_t chunk[CHUNK_SIZE_TOTAL], size_t chunk_size, uint32_t hash[8]) {
+
+    uint32_t a = hash[0];
+    uint32_t b = hash[1];
+    uint32_t c = hash[2];
+    uint32_t d = hash[3];
+    uint32_t e = hash[4];
+    uint32_t f = hash[5];
+    uint32_t g = hash[6];
+    uint32_t h = hash[7];
+
+    for (size_t i = 0; i < chunk_size; i += 64) {
+        const uint8_t * block = chunk + i;
+        uint32_t w[16];
+
+        SHA256_ROUNDS_8(0, SHA256_LOAD);
+        SHA256_ROUNDS_8(8, SHA256_LOAD);
+        SHA256_ROUNDS_8(16, SHA256_SCHEDULE);
+        SHA256_ROUNDS_8(24, SHA256_SCHEDULE);
+        SHA256_ROUNDS_8(32, SHA256_SCHEDULE);
+        SHA256_ROUNDS_8(40, SHA256_SCHEDULE);
+        SHA256_ROUNDS_8(48, SHA256_SCHEDULE);
+        SHA256_ROUNDS_8(56, SHA256_SCHEDULE);
+
+        a = hash[0] += a;
+        b = hash[1] += b;
+        c = hash[2] += c;
+        d = hash[3] += d;
+        e = hash[4] += e;
+        f = hash[5] += f;
+        g = hash[6] += g;
+        h = hash[7] += h;
+    }
+}
+
+/// @brief Compression function, chosen at startup by the kernel registry (or with --engine)
+static void (*sha256_update_kernel)(const uint8_t *, size_t, uint32_t *) = sha256_update_unrolled;
+
+static void sha256_use_reference(void) {
+    sha256_update_kernel = sha256_update_reference;
+    sha256_mb_use(NULL, 0);
+}
+
+static void sha256_use_unrolled(void) {
+    sha256_update_kernel = sha256_update_unrolled;
+    sha256_mb_use(NULL, 0);
+}
+
+#if defined(__x86_64__)
+/// @brief Single streams stay on the unrolled kernel, many files and short messages go side by side in SIMD lanes
+static void sha256_use_sse2(void) {
+    sha256_update_kernel = sha256_update_unrolled;
+    sha256_mb_use(sha256_mb_update_sse2, 4);
+}
+
+static void sha256_use_avx2(void) {
+    sha256_update_kernel = sha256_update_unrolled;
+    sha256_mb_use(sha256_mb_update_avx2, 8);
+}
+
+/// @note A single SHA-NI stream outruns eight AVX2 lanes, so the lanes are left off
+static void sha256_use_shani(void) {
+    sha256_update_kernel = sha256_update_shani;
+    sha256_mb_use(NULL, 0);
+}
+#endif
+
+const ft_ssl_kernel_t sha256_kernels[] = {
+    {"reference", 0, sha256_use_reference},
+    {"unrolled", 0, sha256_use_unrolled},
+#if defined(__x86_64__)
+    {"sse2", 0, sha256_use_sse2},
+    {"avx2", CPU_FEATURE_AVX2, sha256_use_avx2},
+    {"shani", CPU_FEATURE_SHA | CPU_FEATURE_SSE41, sha256_use_shani},
+#endif
+    {NULL, 0, NULL}
+};
+
+__attribute__((constructor))
+static void sha256_select_kernel(void) {
+    kernel_select_default("sha256");
+}
+
+void sha256_update(const uint8_t chunk[CHUNK_SIZE_TOTAL], size_t chunk_size, uint32_t hash[8]) {
+    sha256_update_kernel(chunk, chunk_size, hash);
 }
\ No newline at end of file
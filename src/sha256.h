@@ -29,4 +29,14 @@ static const sha256_context_t sha256_context = {
     }
 };
 
-void sha256(ft_ssl_context_t * context, FILE * file);
\ No newline at end of file
+void sha256_init(uint32_t hash[8]);
+void sha256_pad(uint8_t chunk[CHUNK_SIZE_TOTAL], size_t * chunk_size, size_t message_size);
+void sha256_update(const uint8_t chunk[CHUNK_SIZE_TOTAL], size_t chunk_size, uint32_t hash[8]);
+
+/// @brief Implementations of sha256_update: reference, unrolled, and shani where the CPU has the SHA extensions
+extern const ft_ssl_kernel_t sha256_kernels[];
+
+#if defined(__x86_64__)
+/// @brief SHA-256 compression using the SHA extensions (only call if the CPU has them)
+void sha256_update_shani(const uint8_t chunk[CHUNK_SIZE_TOTAL], size_t chunk_size, uint32_t hash[8]);
+#endif
\ No newline at end of file
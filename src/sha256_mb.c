@@ -0,0 +1,397 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ft_ssl.h"
+#include "sha256.h"
+#include "sha256_mb.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+
+#define AVX2_ADD(a, b) _mm256_add_epi32((a), (b))
+#define AVX2_XOR(a, b) _mm256_xor_si256((a), (b))
+#define AVX2_ROTR(x, n) _mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+#define AVX2_CH(a, b, c) AVX2_XOR(_mm256_and_si256((a), (b)), _mm256_andnot_si256((a), (c)))
+#define AVX2_MAJ(a, b, c) _mm256_or_si256(_mm256_and_si256((a), (b)), _mm256_and_si256((c), _mm256_or_si256((a), (b))))
+#define AVX2_BSIG0(x) AVX2_XOR(AVX2_XOR(AVX2_ROTR(x, 2), AVX2_ROTR(x, 13)), AVX2_ROTR(x, 22))
+#define AVX2_BSIG1(x) AVX2_XOR(AVX2_XOR(AVX2_ROTR(x, 6), AVX2_ROTR(x, 11)), AVX2_ROTR(x, 25))
+#define AVX2_SSIG0(x) AVX2_XOR(AVX2_XOR(AVX2_ROTR(x, 7), AVX2_ROTR(x, 18)), _mm256_srli_epi32((x), 3))
+#define AVX2_SSIG1(x) AVX2_XOR(AVX2_XOR(AVX2_ROTR(x, 17), AVX2_ROTR(x, 19)), _mm256_srli_epi32((x), 10))
+
+__attribute__((target("avx2")))
+void sha256_mb_update_avx2(uint32_t state[8][SHA256_MB_MAX_LANES], const uint8_t * blocks[SHA256_MB_MAX_LANES], size_t block_count) {
+
+    const __m256i bswap_mask = _mm256_set_epi64x(0x0c0d0e0f08090a0bLL, 0x0405060700010203LL,
+                                                  0x0c0d0e0f08090a0bLL, 0x0405060700010203LL);
+
+    // Load the state, one vector per word with one lane per element
+    __m256i s[8];
+    for (size_t j = 0; j < 8; j++)
+        s[j] = _mm256_loadu_si256((const __m256i *)state[j]);
+
+    // Process each 512-bit chunk
+    for (size_t i = 0; i < block_count * 64; i += 64) {
+        __m256i w[16];
+
+        // Transpose the blocks so that w[j] holds word j of every lane (big-endian)
+        for (size_t half = 0; half < 2; half++) {
+            __m256i r[8];
+            for (size_t lane = 0; lane < 8; lane++)
+                r[lane] = _mm256_loadu_si256((const __m256i *)(blocks[lane] + i + half * 32));
+
+            const __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+            const __m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+            const __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+            const __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+            const __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+            const __m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+            const __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+            const __m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+
+            const __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+            const __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+            const __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+            const __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+            const __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+            const __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+            const __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+            const __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+            __m256i * words = w + half * 8;
+            words[0] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u0, u4, 0x20), bswap_mask);
+            words[1] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u1, u5, 0x20), bswap_mask);
+            words[2] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u2, u6, 0x20), bswap_mask);
+            words[3] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u3, u7, 0x20), bswap_mask);
+            words[4] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u0, u4, 0x31), bswap_mask);
+            words[5] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u1, u5, 0x31), bswap_mask);
+            words[6] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u2, u6, 0x31), bswap_mask);
+            words[7] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u3, u7, 0x31), bswap_mask);
+        }
+
+        // initialize the working variables
+        __m256i a = s[0];
+        __m256i b = s[1];
+        __m256i c = s[2];
+        __m256i d = s[3];
+        __m256i e = s[4];
+        __m256i f = s[5];
+        __m256i g = s[6];
+        __m256i h = s[7];
+
+        // Compression function main loop, extending the schedule in a 16-word window
+        for (size_t j = 0; j < 64; j++) {
+
+            if (j >= 16)
+                w[j & 15] = AVX2_ADD(AVX2_ADD(AVX2_SSIG1(w[(j - 2) & 15]), w[(j - 7) & 15]),
+                                     AVX2_ADD(AVX2_SSIG0(w[(j - 15) & 15]), w[j & 15]));
+
+            const __m256i k = _mm256_set1_epi32((int)sha256_context.k[j]);
+            const __m256i t1 = AVX2_ADD(AVX2_ADD(AVX2_ADD(h, AVX2_BSIG1(e)), AVX2_CH(e, f, g)), AVX2_ADD(k, w[j & 15]));
+            const __m256i t2 = AVX2_ADD(AVX2_BSIG0(a), AVX2_MAJ(a, b, c));
+
+            h = g;
+            g = f;
+            f = e;
+            e = AVX2_ADD(d, t1);
+            d = c;
+            c = b;
+            b = a;
+            a = AVX2_ADD(t1, t2);
+        }
+
+        // Compute the intermediate hash value
+        s[0] = AVX2_ADD(s[0], a);
+        s[1] = AVX2_ADD(s[1], b);
+        s[2] = AVX2_ADD(s[2], c);
+        s[3] = AVX2_ADD(s[3], d);
+        s[4] = AVX2_ADD(s[4], e);
+        s[5] = AVX2_ADD(s[5], f);
+        s[6] = AVX2_ADD(s[6], g);
+        s[7] = AVX2_ADD(s[7], h);
+    }
+
+    // Update the state
+    for (size_t j = 0; j < 8; j++)
+        _mm256_storeu_si256((__m256i *)state[j], s[j]);
+}
+
+#define SSE2_ADD(a, b) _mm_add_epi32((a), (b))
+#define SSE2_XOR(a, b) _mm_xor_si128((a), (b))
+#define SSE2_ROTR(x, n) _mm_or_si128(_mm_srli_epi32((x), (n)), _mm_slli_epi32((x), 32 - (n)))
+#define SSE2_CH(a, b, c) SSE2_XOR(_mm_and_si128((a), (b)), _mm_andnot_si128((a), (c)))
+#define SSE2_MAJ(a, b, c) _mm_or_si128(_mm_and_si128((a), (b)), _mm_and_si128((c), _mm_or_si128((a), (b))))
+#define SSE2_BSIG0(x) SSE2_XOR(SSE2_XOR(SSE2_ROTR(x, 2), SSE2_ROTR(x, 13)), SSE2_ROTR(x, 22))
+#define SSE2_BSIG1(x) SSE2_XOR(SSE2_XOR(SSE2_ROTR(x, 6), SSE2_ROTR(x, 11)), SSE2_ROTR(x, 25))
+#define SSE2_SSIG0(x) SSE2_XOR(SSE2_XOR(SSE2_ROTR(x, 7), SSE2_ROTR(x, 18)), _mm_srli_epi32((x), 3))
+#define SSE2_SSIG1(x) SSE2_XOR(SSE2_XOR(SSE2_ROTR(x, 17), SSE2_ROTR(x, 19)), _mm_srli_epi32((x), 10))
+
+/// @note SSE2 has no byte shuffle, so the byte swap is done with shifts
+#define SSE2_BSWAP(x) \
+    _mm_or_si128(_mm_or_si128(_mm_slli_epi32((x), 24), _mm_srli_epi32((x), 24)), \
+                 _mm_or_si128(_mm_and_si128(_mm_slli_epi32((x), 8), _mm_set1_epi32(0x00ff0000)), \
+                              _mm_and_si128(_mm_srli_epi32((x), 8), _mm_set1_epi32(0x0000ff00))))
+
+void sha256_mb_update_sse2(uint32_t state[8][SHA256_MB_MAX_LANES], const uint8_t * blocks[SHA256_MB_MAX_LANES], size_t block_count) {
+
+    // Load the state of the first four lanes
+    __m128i s[8];
+    for (size_t j = 0; j < 8; j++)
+        s[j] = _mm_loadu_si128((const __m128i *)state[j]);
+
+    // Process each 512-bit chunk
+    for (size_t i = 0; i < block_count * 64; i += 64) {
+        __m128i w[16];
+
+        // Transpose the blocks so that w[j] holds word j of every lane (big-endian)
+        for (size_t quarter = 0; quarter < 4; quarter++) {
+            const __m128i r0 = _mm_loadu_si128((const __m128i *)(blocks[0] + i + quarter * 16));
+            const __m128i r1 = _mm_loadu_si128((const __m128i *)(blocks[1] + i + quarter * 16));
+            const __m128i r2 = _mm_loadu_si128((const __m128i *)(blocks[2] + i + quarter * 16));
+            const __m128i r3 = _mm_loadu_si128((const __m128i *)(blocks[3] + i + quarter * 16));
+
+            const __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+            const __m128i t1 = _mm_unpackhi_epi32(r0, r1);
+            const __m128i t2 = _mm_unpacklo_epi32(r2, r3);
+            const __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+            __m128i * words = w + quarter * 4;
+            words[0] = SSE2_BSWAP(_mm_unpacklo_epi64(t0, t2));
+            words[1] = SSE2_BSWAP(_mm_unpackhi_epi64(t0, t2));
+            words[2] = SSE2_BSWAP(_mm_unpacklo_epi64(t1, t3));
+            words[3] = SSE2_BSWAP(_mm_unpackhi_epi64(t1, t3));
+        }
+
+        // initialize the working variables
+        __m128i a = s[0];
+        __m128i b = s[1];
+        __m128i c = s[2];
+        __m128i d = s[3];
+        __m128i e = s[4];
+        __m128i f = s[5];
+        __m128i g = s[6];
+        __m128i h = s[7];
+
+        // Compression function main loop, extending the schedule in a 16-word window
+        for (size_t j = 0; j < 64; j++) {
+
+            if (j >= 16)
+                w[j & 15] = SSE2_ADD(SSE2_ADD(SSE2_SSIG1(w[(j - 2) & 15]), w[(j - 7) & 15]),
+                                     SSE2_ADD(SSE2_SSIG0(w[(j - 15) & 15]), w[j & 15]));
+
+            const __m128i k = _mm_set1_epi32((int)sha256_context.k[j]);
+            const __m128i t1 = SSE2_ADD(SSE2_ADD(SSE2_ADD(h, SSE2_BSIG1(e)), SSE2_CH(e, f, g)), SSE2_ADD(k, w[j & 15]));
+            const __m128i t2 = SSE2_ADD(SSE2_BSIG0(a), SSE2_MAJ(a, b, c));
+
+            h = g;
+            g = f;
+            f = e;
+            e = SSE2_ADD(d, t1);
+            d = c;
+            c = b;
+            b = a;
+            a = SSE2_ADD(t1, t2);
+        }
+
+        // Compute the intermediate hash value
+        s[0] = SSE2_ADD(s[0], a);
+        s[1] = SSE2_ADD(s[1], b);
+        s[2] = SSE2_ADD(s[2], c);
+        s[3] = SSE2_ADD(s[3], d);
+        s[4] = SSE2_ADD(s[4], e);
+        s[5] = SSE2_ADD(s[5], f);
+        s[6] = SSE2_ADD(s[6], g);
+        s[7] = SSE2_ADD(s[7], h);
+    }
+
+    // Update the state
+    for (size_t j = 0; j < 8; j++)
+        _mm_storeu_si128((__m128i *)state[j], s[j]);
+}
+#endif
+
+/// @brief Multi-buffer kernel and its number of lanes, chosen by the kernel registry (0 lanes when off)
+static sha256_mb_update_t sha256_mb_update;
+static size_t sha256_mb_lanes;
+
+void sha256_mb_use(sha256_mb_update_t update, size_t lanes) {
+    sha256_mb_update = update;
+    sha256_mb_lanes = update ? lanes : 0;
+}
+
+/// @brief Read the next chunk of a lane, padding it if the input is exhausted
+static void sha256_mb_refill(sha256_mb_lane_t * lane) {
+
+    lane->chunk_size = fread(lane->chunk, 1, CHUNK_SIZE_READ, lane->file);
+    lane->message_size += lane->chunk_size;
+    lane->offset = 0;
+
+    if (lane->chunk_size < CHUNK_SIZE_READ) {
+        sha256_pad(lane->chunk, &lane->chunk_size, lane->message_size);
+        lane->padded = true;
+    }
+}
+
+/// @brief Open a job's file and start hashing it in a lane
+/// @return false if the file could not be opened (the job then carries the error)
+static bool sha256_mb_start(sha256_mb_lane_t * lane, ft_ssl_job_t * job, uint32_t state[8][SHA256_MB_MAX_LANES], size_t index) {
+
+    lane->file = fopen(job->filename, "rb");
+    if (!lane->file) {
+        job->error = errno;
+        return false;
+    }
+
+    lane->job = job;
+    lane->message_size = 0;
+    lane->padded = false;
+
+    uint32_t hash[8];
+    sha256_init(hash);
+    for (size_t j = 0; j < 8; j++)
+        state[j][index] = hash[j];
+
+    sha256_mb_refill(lane);
+    return true;
+}
+
+/// @brief Store the hash of a lane's job and release the lane
+static ft_ssl_job_t * sha256_mb_finish(sha256_mb_lane_t * lane, uint32_t state[8][SHA256_MB_MAX_LANES], size_t index) {
+
+    ft_ssl_job_t * job = lane->job;
+    for (size_t j = 0; j < 8; j++)
+        job->hash[j] = state[j][index];
+
+    fclose(lane->file);
+    lane->job = NULL;
+    return job;
+}
+
+bool sha256_many(ft_ssl_context_t * context, ft_ssl_job_source_t * source) {
+
+    (void)context;
+    if (!sha256_mb_lanes)
+        return false;
+
+    // Blocks fed to idle lanes, whose results are discarded
+    static const uint8_t idle_chunk[CHUNK_SIZE_TOTAL];
+
+    sha256_mb_lane_t * lanes = calloc(SHA256_MB_MAX_LANES, sizeof(sha256_mb_lane_t));
+    if (!lanes) {
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+
+    uint32_t state[8][SHA256_MB_MAX_LANES] = {{0}};
+    const uint8_t * blocks[SHA256_MB_MAX_LANES];
+    size_t active = 0;
+    bool drained = false;
+
+    for (;;) {
+
+        // Feed idle lanes from the job source, only blocking when every lane is idle
+        for (size_t l = 0; l < sha256_mb_lanes && !drained; l++) {
+            while (!lanes[l].job) {
+                ft_ssl_job_t * job = source->next(source->arg, active == 0);
+                if (!job) {
+                    drained = active == 0;
+                    break;
+                }
+                if (sha256_mb_start(&lanes[l], job, state, l))
+                    active++;
+                else
+                    source->done(source->arg, job);
+            }
+        }
+
+        if (!active) {
+            if (drained)
+                break;
+            continue;
+        }
+
+        // Hash as many blocks as every busy lane has buffered
+        size_t block_count = CHUNK_SIZE_TOTAL / BLOCK_SIZE;
+        for (size_t l = 0; l < SHA256_MB_MAX_LANES; l++) {
+            if (l < sha256_mb_lanes && lanes[l].job) {
+                const size_t available = (lanes[l].chunk_size - lanes[l].offset) / BLOCK_SIZE;
+                if (available < block_count)
+                    block_count = available;
+                blocks[l] = lanes[l].chunk + lanes[l].offset;
+            } else {
+                blocks[l] = idle_chunk;
+            }
+        }
+        sha256_mb_update(state, blocks, block_count);
+
+        // Refill the lanes that ran out of data, release the finished ones
+        for (size_t l = 0; l < sha256_mb_lanes; l++) {
+            if (!lanes[l].job)
+                continue;
+            lanes[l].offset += block_count * BLOCK_SIZE;
+            if (lanes[l].offset < lanes[l].chunk_size)
+                continue;
+            if (lanes[l].padded) {
+                source->done(source->arg, sha256_mb_finish(&lanes[l], state, l));
+                active--;
+            } else {
+                sha256_mb_refill(&lanes[l]);
+            }
+        }
+    }
+
+    free(lanes);
+    return true;
+}
+
+/// @brief Pad a message of at most SHORT_MESSAGE_MAX bytes into a single block
+static void sha256_short_block(uint8_t block[BLOCK_SIZE], const uint8_t * message, size_t size) {
+    memset(block, 0, BLOCK_SIZE);
+    memcpy(block, message, size);
+    block[size] = 0x80;
+    const uint64_t bit_size = (uint64_t)size * 8;
+    for (size_t i = 0; i < 8; i++)
+        block[BLOCK_SIZE - 1 - i] = (uint8_t)(bit_size >> (8 * i));
+}
+
+void sha256_short(const uint8_t * const * messages, const size_t * sizes, size_t count, uint32_t (*hashes)[8]) {
+
+    uint8_t blocks[SHA256_MB_MAX_LANES][BLOCK_SIZE];
+
+    // One block at a time through sha256_update (SHA-NI, or no SIMD lanes)
+    if (!sha256_mb_lanes) {
+        uint8_t chunk[CHUNK_SIZE_TOTAL]; // sized as the sha256_update prototype expects
+        for (size_t i = 0; i < count; i++) {
+            sha256_short_block(chunk, messages[i], sizes[i]);
+            sha256_init(hashes[i]);
+            sha256_update(chunk, BLOCK_SIZE, hashes[i]);
+        }
+        return;
+    }
+
+    uint32_t initial[8];
+    sha256_init(initial);
+
+    for (size_t i = 0; i < count; i += sha256_mb_lanes) {
+
+        // Idle lanes (past the last message) hash the first block again
+        const size_t used = count - i < sha256_mb_lanes ? count - i : sha256_mb_lanes;
+        const uint8_t * lanes[SHA256_MB_MAX_LANES];
+        uint32_t state[8][SHA256_MB_MAX_LANES];
+        for (size_t l = 0; l < SHA256_MB_MAX_LANES; l++) {
+            if (l < used)
+                sha256_short_block(blocks[l], messages[i + l], sizes[i + l]);
+            lanes[l] = l < used ? blocks[l] : blocks[0];
+            for (size_t j = 0; j < 8; j++)
+                state[j][l] = initial[j];
+        }
+
+        sha256_mb_update(state, lanes, 1);
+
+        for (size_t l = 0; l < used; l++)
+            for (size_t j = 0; j < 8; j++)
+                hashes[i + l][j] = state[j][l];
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdbool.h> // for bool
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint32_t, uint8_t
+
+#include "ft_ssl.h" // for ft_ssl_context_t
+
+/// @brief The maximum number of independent SHA-256 states hashed side by side
+#define SHA256_MB_MAX_LANES 8
+
+/// @brief Lane state for the multi-buffer engine
+typedef struct {
+    ft_ssl_job_t * job;              ///< Job hashed in this lane (NULL if the lane is idle)
+    FILE * file;                     ///< Input stream of the job
+    uint8_t chunk[CHUNK_SIZE_TOTAL]; ///< Buffer for input data
+    size_t chunk_size;               ///< Number of bytes in the chunk
+    size_t offset;                   ///< Offset of the next block to hash in the chunk
+    size_t message_size;             ///< Total message size read so far
+    bool padded;                     ///< The chunk holds the final (padded) blocks
+} sha256_mb_lane_t;
+
+/// @brief Hash `block_count` consecutive blocks for each lane, with the state transposed (state[word][lane])
+typedef void (*sha256_mb_update_t)(uint32_t state[8][SHA256_MB_MAX_LANES], const uint8_t * blocks[SHA256_MB_MAX_LANES], size_t block_count);
+
+#if defined(__x86_64__)
+void sha256_mb_update_avx2(uint32_t state[8][SHA256_MB_MAX_LANES], const uint8_t * blocks[SHA256_MB_MAX_LANES], size_t block_count);
+void sha256_mb_update_sse2(uint32_t state[8][SHA256_MB_MAX_LANES], const uint8_t * blocks[SHA256_MB_MAX_LANES], size_t block_count);
+#endif
+
+/// @brief Hash in `lanes` SIMD lanes with `update`, or never side by side with NULL (for the kernel registry)
+void sha256_mb_use(sha256_mb_update_t update, size_t lanes);
+
+/// @brief Hash every job of a source, interleaving up to eight files in SIMD lanes
+/// @return false if no multi-buffer kernel is available on this CPU (no job is taken then)
+bool sha256_many(ft_ssl_context_t * context, ft_ssl_job_source_t * source);
+
+/// @brief Hash independent messages of at most SHORT_MESSAGE_MAX bytes, one padded block each, several per SIMD pass
+void sha256_short(const uint8_t * const * messages, const size_t * sizes, size_t count, uint32_t (*hashes)[8]);
@@ -0,0 +1,124 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "sha256.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+
+/// @brief Four rounds with the message words `msg` (plus the matching constants)
+#define SHANI_ROUNDS4(msg, group) \
+    tmp = _mm_add_epi32((msg), _mm_loadu_si128((const __m128i *)&sha256_context.k[4 * (group)])); \
+    state1 = _mm_sha256rnds2_epu32(state1, state0, tmp); \
+    tmp = _mm_shuffle_epi32(tmp, 0x0E); \
+    state0 = _mm_sha256rnds2_epu32(state0, state1, tmp);
+
+/// @brief First half of the schedule: a = sigma0 part of the next four words
+#define SHANI_MSG1(a, b) \
+    (a) = _mm_sha256msg1_epu32((a), (b));
+
+/// @brief Second half of the schedule: a = next four words, from the previous two groups
+#define SHANI_MSG2(a, prev, cur) \
+    (a) = _mm_add_epi32((a), _mm_alignr_epi8((cur), (prev), 4)); \
+    (a) = _mm_sha256msg2_epu32((a), (cur));
+
+/// @brief Load four big-endian message words
+#define SHANI_LOAD(msg, offset) \
+    (msg) = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(chunk + i + (offset))), bswap_mask);
+
+__attribute__((target("sha,sse4.1")))
+void sha256_update_shani(const uint8_t chunk[CHUNK_SIZE_TOTAL], size_t chunk_size, uint32_t hash[8]) {
+
+    const __m128i bswap_mask = _mm_set_epi64x(0x0c0d0e0f08090a0bLL, 0x0405060700010203LL);
+
+    // The SHA instructions work on the state split as ABEF / CDGH
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&hash[0]), 0xB1);    // CDAB
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&hash[4]), 0x1B); // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);                                     // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);                                          // CDGH
+
+    // Process each 512-bit chunk
+    for (size_t i = 0; i < chunk_size; i += 64) {
+
+        const __m128i abef = state0;
+        const __m128i cdgh = state1;
+        __m128i m0, m1, m2, m3;
+
+        // Rounds 0-15: the message words come straight from the block
+        SHANI_LOAD(m0, 0);
+        SHANI_ROUNDS4(m0, 0);
+
+        SHANI_LOAD(m1, 16);
+        SHANI_ROUNDS4(m1, 1);
+        SHANI_MSG1(m0, m1);
+
+        SHANI_LOAD(m2, 32);
+        SHANI_ROUNDS4(m2, 2);
+        SHANI_MSG1(m1, m2);
+
+        SHANI_LOAD(m3, 48);
+        SHANI_ROUNDS4(m3, 3);
+        SHANI_MSG2(m0, m2, m3);
+        SHANI_MSG1(m2, m3);
+
+        // Rounds 16-51: extend the schedule four words ahead of the rounds
+        SHANI_ROUNDS4(m0, 4);
+        SHANI_MSG2(m1, m3, m0);
+        SHANI_MSG1(m3, m0);
+
+        SHANI_ROUNDS4(m1, 5);
+        SHANI_MSG2(m2, m0, m1);
+        SHANI_MSG1(m0, m1);
+
+        SHANI_ROUNDS4(m2, 6);
+        SHANI_MSG2(m3, m1, m2);
+        SHANI_MSG1(m1, m2);
+
+        SHANI_ROUNDS4(m3, 7);
+        SHANI_MSG2(m0, m2, m3);
+        SHANI_MSG1(m2, m3);
+
+        SHANI_ROUNDS4(m0, 8);
+        SHANI_MSG2(m1, m3, m0);
+        SHANI_MSG1(m3, m0);
+
+        SHANI_ROUNDS4(m1, 9);
+        SHANI_MSG2(m2, m0, m1);
+        SHANI_MSG1(m0, m1);
+
+        SHANI_ROUNDS4(m2, 10);
+        SHANI_MSG2(m3, m1, m2);
+        SHANI_MSG1(m1, m2);
+
+        SHANI_ROUNDS4(m3, 11);
+        SHANI_MSG2(m0, m2, m3);
+        SHANI_MSG1(m2, m3);
+
+        SHANI_ROUNDS4(m0, 12);
+        SHANI_MSG2(m1, m3, m0);
+        SHANI_MSG1(m3, m0);
+
+        // Rounds 52-63: the last words only need their second schedule half
+        SHANI_ROUNDS4(m1, 13);
+        SHANI_MSG2(m2, m0, m1);
+
+        SHANI_ROUNDS4(m2, 14);
+        SHANI_MSG2(m3, m1, m2);
+
+        SHANI_ROUNDS4(m3, 15);
+
+        // Compute the intermediate hash value
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+    // Back from ABEF / CDGH to ABCD / EFGH
+    tmp = _mm_shuffle_epi32(state0, 0x1B);       // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);    // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0); // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);    // HGFE
+
+    _mm_storeu_si128((__m128i *)&hash[0], state0);
+    _mm_storeu_si128((__m128i *)&hash[4], state1);
+}
+#endif
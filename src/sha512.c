@@ -0,0 +1,254 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "ft_ssl.h"
+#include "kernel.h"
+#include "sha512.h"
+
+#define SHA512_ROTATE_RIGHT(a, n) (((a) >> (n)) | ((a) << (64 - (n))))
+
+#define SHA512_CH(a, b, c) (((a) & (b)) ^ (~(a) & (c)))
+#define SHA512_MAJ(a, b, c) (((a) & (b)) ^ ((a) & (c)) ^ ((b) & (c)))
+#define SHA512_BSIG0(x) (SHA512_ROTATE_RIGHT(x, 28) ^ SHA512_ROTATE_RIGHT(x, 34) ^ SHA512_ROTATE_RIGHT(x, 39))
+#define SHA512_BSIG1(x) (SHA512_ROTATE_RIGHT(x, 14) ^ SHA512_ROTATE_RIGHT(x, 18) ^ SHA512_ROTATE_RIGHT(x, 41))
+#define SHA512_SSIG0(x) (SHA512_ROTATE_RIGHT(x, 1) ^ SHA512_ROTATE_RIGHT(x, 8) ^ ((x) >> 7))
+#define SHA512_SSIG1(x) (SHA512_ROTATE_RIGHT(x, 19) ^ SHA512_ROTATE_RIGHT(x, 61) ^ ((x) >> 6))
+
+static const uint64_t sha512_k[80] = {
+    0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfec4d3b2f, 0xe9b5dba58189dbbc, 0x3956c25bf348b538,
+    0x59f111f1b605d019, 0x923f82a4af194f9b, 0xab1c5ed5da6d8118, 0xd807aa98a3030242, 0x12835b0145706fbe,
+    0x243185be4ee4b28c, 0x550c7dc3d5ffb4e2, 0x72be5d74f27b896f, 0x80deb1fe3b1696b1, 0x9bdc06a725c71235,
+    0xc19bf174cf692694, 0xe49b69c19ef14ad2, 0xefbe4786384f25e3, 0x0fc19dc68b8cd5b5, 0x240ca1cc77ac9c65,
+    0x2de92c6f592b0275, 0x4a7484aa6ea6e483, 0x5cb0a9dcbd41fbd4, 0x76f988da831153b5, 0x983e5152ee66dfab,
+    0xa831c66d2db43210, 0xb00327c898fb213f, 0xbf597fc7beef0ee4, 0xc6e00bf33da88fc2, 0xd5a79147930aa725,
+    0x06ca6351e003826f, 0x142929670a0e6e70, 0x27b70a8546d22ffc, 0x2e1b21385c26c926, 0x4d2c6dfc5ac42aed,
+    0x53380d139d95b3df, 0x650a73548baf63de, 0x766a0abb3c77b2a8, 0x81c2c92e47edaee6, 0x92722c851482353b,
+    0xa2bfe8a14cf10364, 0xa81a664bbc423001, 0xc24b8b70d0f89791, 0xc76c51a30654be30, 0xd192e819d6ef5218,
+    0xd69906245565a910, 0xf40e35855771202a, 0x106aa07032bbd1b8, 0x19a4c116b8d2d0c8, 0x1e376c085141ab53,
+    0x2748774cdf8eeb99, 0x34b0bcb5e19b48a8, 0x391c0cb3c5c95a63, 0x4ed8aa4ae3418acb, 0x5b9cca4f7763e373,
+    0x682e6ff3d6b2b8a3, 0x748f82ee5defb2fc, 0x78a5636f43172f60, 0x84c87814a1f0ab72, 0x8cc702081a6439ec,
+    0x90befffa23631e28, 0xa4506cebde82bde9, 0xbef9a3f7b2c67915, 0xc67178f2e372532b, 0xca273eceea26619c,
+    0xd186b8c721c0c207, 0xeada7dd6cde0eb1e, 0xf57d4f7fee6ed178, 0x06f067aa72176fba, 0x0a637dc5a2c898a6,
+    0x113f9804bef90dae, 0x1b710b35131c471b, 0x28db77f523047d84, 0x32caab7b40c72493, 0x3c9ebe0a15c9bebc,
+    0x431d67c49c100d4c, 0x4cc5d4becb3e42b6, 0x597f299cfc657e2a, 0x5fcb6fab3ad6faec, 0x6c44198c4a475817
+};
+
+static void sha512_set(uint32_t hash[FT_SSL_MAX_STATE_WORDS], const uint64_t state[8]) {
+    for (size_t i = 0; i < 8; i++) {
+        hash[2 * i] = (uint32_t)(state[i] >> 32);
+        hash[2 * i + 1] = (uint32_t)state[i];
+    }
+}
+
+void sha512_init(uint32_t hash[FT_SSL_MAX_STATE_WORDS]) {
+    static const uint64_t initial[8] = {
+        0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+        0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b, 0x5be0cd19137e2179
+    };
+    sha512_set(hash, initial);
+}
+
+void sha384_init(uint32_t hash[FT_SSL_MAX_STATE_WORDS]) {
+    static const uint64_t initial[8] = {
+        0xcbbb9d5dc1059ed8, 0x629a292a367cd507, 0x9159015a3070dd17, 0x152fecd8f70e5939,
+        0x67332667ffc00b31, 0x8eb44a8768581511, 0xdb0c2e0d64f98fa7, 0x47b5481dbefa4fa4
+    };
+    sha512_set(hash, initial);
+}
+
+void sha512_256_init(uint32_t hash[FT_SSL_MAX_STATE_WORDS]) {
+    static const uint64_t initial[8] = {
+        0x22312194fc2bf72c, 0x9f555fa3c84c64c2, 0x2393b86b6f53b151, 0x963877195940eabd,
+        0x96283ee2a88effe3, 0xbe5e1e2553863992, 0x2b0199fc2c85b8aa, 0x0eb72ddc81c52ca2
+    };
+    sha512_set(hash, initial);
+}
+
+void sha512_pad(uint8_t chunk[CHUNK_SIZE_TOTAL], size_t * chunk_size, size_t message_size) {
+
+    // Append the bit '1' to the message
+    chunk[*chunk_size] = 0x80;
+    (*chunk_size)++;
+
+    // Pad with zeros until the total length is congruent to 112 (mod 128),
+    // which leaves 16 bytes (128 bits) for the original length
+    const size_t current_mod_128 = *chunk_size % SHA512_BLOCK_SIZE;
+    const size_t zeros_to_add = current_mod_128 <= 112 ? 112 - current_mod_128 : (SHA512_BLOCK_SIZE - current_mod_128) + 112;
+    memset(chunk + *chunk_size, 0, zeros_to_add);
+    *chunk_size += zeros_to_add;
+
+    // Append the original message size in bits (big-endian), the high half holding the bits shifted out of size_t
+    const uint64_t high = (uint64_t)message_size >> 61;
+    const uint64_t low = (uint64_t)message_size << 3;
+    for (size_t i = 0; i < 8; i++) {
+        chunk[*chunk_size + i] = (uint8_t)(high >> (56 - 8 * i));
+        chunk[*chunk_size + 8 + i] = (uint8_t)(low >> (56 - 8 * i));
+    }
+    *chunk_size += 16;
+}
+
+/// @brief The compression function as the specification writes it: an 80-word schedule and a loop over the rounds
+static void sha512_update_reference(const uint8_t chunk[CHUNK_SIZE_TOTAL], size_t chunk_size, uint32_t hash[FT_SSL_MAX_STATE_WORDS]) {
+
+    // Load the state
+    uint64_t state[8];
+    for (size_t i = 0; i < 8; i++)
+        state[i] = (uint64_t)hash[2 * i] << 32 | hash[2 * i + 1];
+
+    // Process each 1024-bit block
+    for (size_t i = 0; i < chunk_size; i += SHA512_BLOCK_SIZE) {
+        uint64_t w[80];
+
+        // Convert bytes to words (big-endian)
+        for (size_t j = 0; j < 16; j++) {
+            uint64_t word = 0;
+            for (size_t k = 0; k < 8; k++)
+                word = word << 8 | chunk[i + j * 8 + k];
+            w[j] = word;
+        }
+
+        // Extend the first 16 words to the remaining 64 words
+        for (size_t j = 16; j < 80; j++)
+            w[j] = SHA512_SSIG1(w[j - 2]) + w[j - 7] + SHA512_SSIG0(w[j - 15]) + w[j - 16];
+
+        // Initialize the working variables
+        uint64_t a = state[0];
+        uint64_t b = state[1];
+        uint64_t c = state[2];
+        uint64_t d = state[3];
+        uint64_t e = state[4];
+        uint64_t f = state[5];
+        uint64_t g = state[6];
+        uint64_t h = state[7];
+
+        // Compression function main loop
+        for (size_t j = 0; j < 80; j++) {
+
+            const uint64_t t1 = h + SHA512_BSIG1(e) + SHA512_CH(e, f, g) + sha512_k[j] + w[j];
+            const uint64_t t2 = SHA512_BSIG0(a) + SHA512_MAJ(a, b, c);
+
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        // Compute the intermediate hash value
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+
+    // Update the state
+    sha512_set(hash, state);
+}
+
+/// @brief One round, with the working variables rotating through the arguments instead of being moved
+#define SHA512_ROUND(a, b, c, d, e, f, g, h, k, w) \
+    do { \
+        const uint64_t t1 = (h) + SHA512_BSIG1(e) + SHA512_CH(e, f, g) + (k) + (w); \
+        (d) += t1; \
+        (h) = t1 + SHA512_BSIG0(a) + SHA512_MAJ(a, b, c); \
+    } while (0)
+
+/// @brief Eight rounds from round j, after which the variables are back in place
+#define SHA512_ROUNDS_8(j, W) \
+    SHA512_ROUND(a, b, c, d, e, f, g, h, sha512_k[(j)], W(j)); \
+    SHA512_ROUND(h, a, b, c, d, e, f, g, sha512_k[(j) + 1], W((j) + 1)); \
+    SHA512_ROUND(g, h, a, b, c, d, e, f, sha512_k[(j) + 2], W((j) + 2)); \
+    SHA512_ROUND(f, g, h, a, b, c, d, e, sha512_k[(j) + 3], W((j) + 3)); \
+    SHA512_ROUND(e, f, g, h, a, b, c, d, sha512_k[(j) + 4], W((j) + 4)); \
+    SHA512_ROUND(d, e, f, g, h, a, b, c, sha512_k[(j) + 5], W((j) + 5)); \
+    SHA512_ROUND(c, d, e, f, g, h, a, b, sha512_k[(j) + 6], W((j) + 6)); \
+    SHA512_ROUND(b, c, d, e, f, g, h, a, sha512_k[(j) + 7], W((j) + 7)); \
+    (void)0
+
+/// @brief Words of the first 16 rounds, loaded from the block (big-endian)
+#define SHA512_LOAD(j) \
+    (w[j] = (uint64_t)block[8 * (j)] << 56 | (uint64_t)block[8 * (j) + 1] << 48 | (uint64_t)block[8 * (j) + 2] << 40 | \
+            (uint64_t)block[8 * (j) + 3] << 32 | (uint64_t)block[8 * (j) + 4] << 24 | (uint64_t)block[8 * (j) + 5] << 16 | \
+            (uint64_t)block[8 * (j) + 6] << 8 | block[8 * (j) + 7])
+
+/// @brief Words of the other rounds: the schedule keeps the last 16 words only, each new one replacing the oldest
+#define SHA512_SCHEDULE(j) \
+    (w[(j) & 15] += SHA512_SSIG1(w[((j) - 2) & 15]) + w[((j) - 7) & 15] + SHA512_SSIG0(w[((j) - 15) & 15]))
+
+/// @brief Fully unrolled compression function: round constants are immediates, and the schedule stays small
+static void sha512_update_unrolled(const uint8_t chunk[CHUNK_SIZE_TOTAL], size_t chunk_size, uint32_t hash[FT_SSL_MAX_STATE_WORDS]) {
+
+    uint64_t state[8];
+    for (size_t i = 0; i < 8; i++)
+        state[i] = (uint64_t)hash[2 * i] << 32 | hash[2 * i + 1];
+
+    uint64_t a = state[0];
+    uint64_t b = state[1];
+    uint64_t c = state[2];
+    uint64_t d = state[3];
+    uint64_t e = state[4];
+    uint64_t f = state[5];
+    uint64_t g = state[6];
+    uint64_t h = state[7];
+
+    for (size_t i = 0; i < chunk_size; i += SHA512_BLOCK_SIZE) {
+        const uint8_t * block = chunk + i;
+        uint64_t w[16];
+
+        SHA512_ROUNDS_8(0, SHA512_LOAD);
+        SHA512_ROUNDS_8(8, SHA512_LOAD);
+        SHA512_ROUNDS_8(16, SHA512_SCHEDULE);
+        SHA512_ROUNDS_8(24, SHA512_SCHEDULE);
+        SHA512_ROUNDS_8(32, SHA512_SCHEDULE);
+        SHA512_ROUNDS_8(40, SHA512_SCHEDULE);
+        SHA512_ROUNDS_8(48, SHA512_SCHEDULE);
+        SHA512_ROUNDS_8(56, SHA512_SCHEDULE);
+        SHA512_ROUNDS_8(64, SHA512_SCHEDULE);
+        SHA512_ROUNDS_8(72, SHA512_SCHEDULE);
+
+        a = state[0] += a;
+        b = state[1] += b;
+        c = state[2] += c;
+        d = state[3] += d;
+        e = state[4] += e;
+        f = state[5] += f;
+        g = state[6] += g;
+        h = state[7] += h;
+    }
+
+    sha512_set(hash, state);
+}
+
+/// @brief Compression function, chosen at startup by the kernel registry (or with --engine)
+static void (*sha512_update_kernel)(const uint8_t *, size_t, uint32_t *) = sha512_update_unrolled;
+
+static void sha512_use_reference(void) {
+    sha512_update_kernel = sha512_update_reference;
+}
+
+static void sha512_use_unrolled(void) {
+    sha512_update_kernel = sha512_update_unrolled;
+}
+
+const ft_ssl_kernel_t sha512_kernels[] = {
+    {"reference", 0, sha512_use_reference},
+    {"unrolled", 0, sha512_use_unrolled},
+    {NULL, 0, NULL}
+};
+
+/// @note SHA-384 and SHA-512/256 share these kernels
+__attribute__((constructor))
+static void sha512_select_kernel(void) {
+    kernel_select_default("sha512");
+}
+
+void sha512_update(const uint8_t chunk[CHUNK_SIZE_TOTAL], size_t chunk_size, uint32_t hash[FT_SSL_MAX_STATE_WORDS]) {
+    sha512_update_kernel(chunk, chunk_size, hash);
+}
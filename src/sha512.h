@@ -0,0 +1,18 @@
+#pragma once
+
+#include "ft_ssl.h" // for CHUNK_SIZE_TOTAL, FT_SSL_MAX_STATE_WORDS, ft_ssl_kernel_t
+
+/// @brief The size of a SHA-512 block in bytes (128 bytes = 1024 bits)
+#define SHA512_BLOCK_SIZE 128
+
+/// @note The state is eight 64-bit words, stored as 16 32-bit words (high half first),
+/// so that the big-endian hash words print and serialize like the 32-bit algorithms.
+/// SHA-384 and SHA-512/256 only differ by their initial value and their truncated output.
+void sha512_init(uint32_t hash[FT_SSL_MAX_STATE_WORDS]);
+void sha384_init(uint32_t hash[FT_SSL_MAX_STATE_WORDS]);
+void sha512_256_init(uint32_t hash[FT_SSL_MAX_STATE_WORDS]);
+void sha512_pad(uint8_t chunk[CHUNK_SIZE_TOTAL], size_t * chunk_size, size_t message_size);
+void sha512_update(const uint8_t chunk[CHUNK_SIZE_TOTAL], size_t chunk_size, uint32_t hash[FT_SSL_MAX_STATE_WORDS]);
+
+/// @brief Implementations of sha512_update (shared by the whole family): reference and unrolled
+extern const ft_ssl_kernel_t sha512_kernels[];
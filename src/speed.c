@@ -0,0 +1,243 @@
+#define _GNU_SOURCE // for sched_setaffinity, sched_getcpu
+
+#include <errno.h>
+#include <getopt.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "digest.h"
+#include "kernel.h"
+#include "speed.h"
+
+/// @brief Message sizes, from a single partial block to a large buffer
+static const size_t speed_sizes[] = {16, 64, 256, 1024, 8192, 16384, 1024 * 1024};
+
+#define SPEED_SIZE_COUNT (sizeof(speed_sizes) / sizeof(speed_sizes[0]))
+
+/// @brief Options of the speed subcommand
+typedef struct {
+    double duration;      ///< Measuring time per algorithm and size
+    double warmup;        ///< Warmup time per algorithm and size
+    int cpu;              ///< CPU to pin the thread to
+    bool json;            ///< Print a JSON document instead of a table
+    const char * engine;  ///< Kernel of every algorithm (NULL for the default ones)
+} speed_options_t;
+
+/// @brief Result of one algorithm over one message size
+typedef struct {
+    size_t size;           ///< Message size
+    uint64_t messages;     ///< Number of messages hashed
+    double seconds;        ///< Measured time
+    double cycles;         ///< Elapsed timestamp counter cycles (0 if the CPU has none)
+} speed_result_t;
+
+enum {
+    LONG_OPTION_DURATION = 256,
+    LONG_OPTION_WARMUP,
+    LONG_OPTION_CPU,
+    LONG_OPTION_JSON,
+    LONG_OPTION_ENGINE,
+};
+
+static const struct option speed_long_options[] = {
+    {"duration", required_argument, NULL, LONG_OPTION_DURATION},
+    {"warmup", required_argument, NULL, LONG_OPTION_WARMUP},
+    {"cpu", required_argument, NULL, LONG_OPTION_CPU},
+    {"json", no_argument, NULL, LONG_OPTION_JSON},
+    {"engine", required_argument, NULL, LONG_OPTION_ENGINE},
+    {NULL, 0, NULL, 0}
+};
+
+static void speed_usage(void) {
+    fprintf(stderr, "Usage: ft_ssl speed [--duration seconds] [--warmup seconds] [--cpu n] [--engine name] [--json] [algorithm...]\n");
+    fprintf(stderr, "  --duration seconds  measuring time for each algorithm and block size (default %.1f)\n", SPEED_DURATION);
+    fprintf(stderr, "  --warmup seconds    unmeasured run before each measure (default %.1f)\n", SPEED_WARMUP);
+    fprintf(stderr, "  --cpu n             CPU to pin the benchmark to (default: the one it starts on)\n");
+    fprintf(stderr, "  --engine name       measure this implementation of the algorithms (default: the fastest one)\n");
+    fprintf(stderr, "  --json              machine-readable output\n");
+}
+
+static double speed_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+static uint64_t speed_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static bool speed_parse_seconds(const char * str, double * seconds) {
+    char * end;
+    errno = 0;
+    *seconds = strtod(str, &end);
+    return !errno && end != str && !*end && *seconds >= 0 && *seconds <= 3600;
+}
+
+/// @brief Hash messages of `size` bytes for about `duration` seconds
+static speed_result_t speed_run(const ft_ssl_algorithm_t * algorithm, const uint8_t * buffer, size_t size, double duration) {
+
+    speed_result_t result = {size, 0, 0, 0};
+    uint8_t digest_bytes[FT_SSL_MAX_DIGEST_SIZE];
+    ft_ssl_digest_t digest;
+
+    // Check the clock once per batch only, growing the batches until they take about 10 ms
+    uint64_t batch = 1;
+    const double start = speed_now();
+    const uint64_t start_cycles = speed_cycles();
+    double now = start;
+
+    while (now - start < duration) {
+        for (uint64_t i = 0; i < batch; i++) {
+            ft_ssl_digest_init(&digest, algorithm);
+            ft_ssl_digest_update(&digest, buffer, size);
+            ft_ssl_digest_final(&digest, digest_bytes);
+        }
+        result.messages += batch;
+        const double batch_start = now;
+        now = speed_now();
+        if (now - batch_start < 0.01)
+            batch *= 2;
+    }
+
+    result.seconds = now - start;
+    result.cycles = (double)(speed_cycles() - start_cycles);
+
+    // Keep the hashing from being optimized out
+    __asm__ volatile("" : : "r"(digest_bytes) : "memory");
+    return result;
+}
+
+static void speed_print_table(const ft_ssl_algorithm_t * algorithm, const speed_result_t * results) {
+    for (size_t i = 0; i < SPEED_SIZE_COUNT; i++) {
+        const double bytes = (double)results[i].messages * (double)results[i].size;
+        printf("%-10s %8zu bytes %12.2f MB/s", algorithm->lower_name, results[i].size, bytes / results[i].seconds / 1e6);
+        if (results[i].cycles > 0)
+            printf(" %10.2f cycles/byte", results[i].cycles / bytes);
+        printf("\n");
+    }
+}
+
+static void speed_print_json(const ft_ssl_algorithm_t * algorithm, const speed_result_t * results, bool first) {
+    for (size_t i = 0; i < SPEED_SIZE_COUNT; i++) {
+        const double bytes = (double)results[i].messages * (double)results[i].size;
+        printf("%s\n    {\"algorithm\": \"%s\", \"block_size\": %zu, \"messages\": %llu, \"seconds\": %.6f, \"mb_per_s\": %.3f, \"cycles_per_byte\": %.4f}",
+               first && i == 0 ? "" : ",", algorithm->lower_name, results[i].size, (unsigned long long)results[i].messages,
+               results[i].seconds, bytes / results[i].seconds / 1e6, results[i].cycles > 0 ? results[i].cycles / bytes : 0.0);
+    }
+}
+
+int speed_main(int ac, char ** av) {
+
+    speed_options_t options = {SPEED_DURATION, SPEED_WARMUP, sched_getcpu(), false, NULL};
+
+    int opt;
+    while ((opt = getopt_long(ac, av, "+", speed_long_options, NULL)) != -1) {
+        switch (opt) {
+            case LONG_OPTION_DURATION:
+                if (!speed_parse_seconds(optarg, &options.duration) || options.duration == 0) {
+                    speed_usage();
+                    return EXIT_FAILURE;
+                }
+                break;
+            case LONG_OPTION_WARMUP:
+                if (!speed_parse_seconds(optarg, &options.warmup)) {
+                    speed_usage();
+                    return EXIT_FAILURE;
+                }
+                break;
+            case LONG_OPTION_CPU: {
+                char * end;
+                const long cpu = strtol(optarg, &end, 10);
+                if (*end || end == optarg || cpu < 0 || cpu >= CPU_SETSIZE) {
+                    speed_usage();
+                    return EXIT_FAILURE;
+                }
+                options.cpu = (int)cpu;
+                break;
+            }
+            case LONG_OPTION_JSON:
+                options.json = true;
+                break;
+            case LONG_OPTION_ENGINE:
+                options.engine = optarg;
+                break;
+            default:
+                speed_usage();
+                return EXIT_FAILURE;
+        }
+    }
+
+    // Every algorithm by default
+    const ft_ssl_algorithm_t * algorithms[16];
+    size_t algorithm_count = 0;
+    for (int i = optind; i < ac; i++) {
+        const ft_ssl_algorithm_t * algorithm = ft_ssl_algorithm(av[i]);
+        if (!algorithm || algorithm_count == sizeof(algorithms) / sizeof(algorithms[0])) {
+            speed_usage();
+            return EXIT_FAILURE;
+        }
+        algorithms[algorithm_count++] = algorithm;
+    }
+    for (size_t i = 0; optind == ac && ft_ssl_algorithms[i].lower_name && i < sizeof(algorithms) / sizeof(algorithms[0]); i++)
+        algorithms[algorithm_count++] = &ft_ssl_algorithms[i];
+    for (size_t i = 0; options.engine && i < algorithm_count; i++)
+        if (!kernel_select(algorithms[i], options.engine))
+            return EXIT_FAILURE;
+
+    // Migrations between cores (and their clocks) skew the short measures
+    bool pinned = false;
+    if (options.cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET((size_t)options.cpu, &set);
+        pinned = sched_setaffinity(0, sizeof(set), &set) == 0;
+        if (!pinned)
+            fprintf(stderr, "ft_ssl: speed: cannot pin to CPU %d: %s\n", options.cpu, strerror(errno));
+    }
+
+    uint8_t * buffer = calloc(speed_sizes[SPEED_SIZE_COUNT - 1], 1);
+    if (!buffer) {
+        perror("calloc");
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < speed_sizes[SPEED_SIZE_COUNT - 1]; i++)
+        buffer[i] = (uint8_t)(i * 131 + 7);
+
+    if (options.json)
+        printf("{\n  \"cpu\": %d,\n  \"pinned\": %s,\n  \"duration\": %.3f,\n  \"warmup\": %.3f,\n  \"results\": [",
+               options.cpu, pinned ? "true" : "false", options.duration, options.warmup);
+
+    for (size_t a = 0; a < algorithm_count; a++) {
+        speed_result_t results[SPEED_SIZE_COUNT];
+        for (size_t i = 0; i < SPEED_SIZE_COUNT; i++) {
+            if (options.warmup > 0)
+                speed_run(algorithms[a], buffer, speed_sizes[i], options.warmup);
+            results[i] = speed_run(algorithms[a], buffer, speed_sizes[i], options.duration);
+        }
+        if (options.json)
+            speed_print_json(algorithms[a], results, a == 0);
+        else
+            speed_print_table(algorithms[a], results);
+        fflush(stdout);
+    }
+
+    if (options.json)
+        printf("\n  ]\n}\n");
+
+    free(buffer);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+/// @brief Default measuring time for each algorithm and block size, in seconds
+#define SPEED_DURATION 1.0
+
+/// @brief Default warmup time before each measure, in seconds
+#define SPEED_WARMUP 0.1
+
+/// @brief `ft_ssl speed [options] [algorithm...]`: in-process throughput of each algorithm over several block sizes
+/// @param ac Argument count, starting at "speed"
+/// @param av Arguments, starting at "speed"
+/// @return The exit status
+int speed_main(int ac, char ** av);
@@ -0,0 +1,157 @@
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "ft_ssl.h"
+#include "stats.h"
+
+static uint64_t stats_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+static uint64_t stats_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static int stats_perf_open(uint64_t config, int group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = group_fd == -1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+/// @brief Count the cycles and instructions of the calling thread (fds left at -1 if perf_event_paranoid or the VM forbids it)
+static void stats_perf_start(int fds[2]) {
+
+    fds[0] = stats_perf_open(PERF_COUNT_HW_CPU_CYCLES, -1);
+    fds[1] = fds[0] == -1 ? -1 : stats_perf_open(PERF_COUNT_HW_INSTRUCTIONS, fds[0]);
+    if (fds[1] == -1) {
+        if (fds[0] != -1)
+            close(fds[0]);
+        fds[0] = -1;
+        return;
+    }
+    ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+/// @brief Read the group of stats_perf_start and close it
+static void stats_perf_stop(const int fds[2], stats_counters_t * counters) {
+
+    struct {
+        uint64_t count;
+        uint64_t values[2];
+    } group;
+
+    ioctl(fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    if (read(fds[0], &group, sizeof(group)) == (ssize_t)sizeof(group) && group.count == 2) {
+        counters->hw_cycles = group.values[0];
+        counters->hw_instructions = group.values[1];
+        counters->hw_inputs = 1;
+    }
+    close(fds[1]);
+    close(fds[0]);
+}
+
+static void stats_print(const char * label, const stats_counters_t * counters) {
+
+    const double bytes = counters->bytes ? (double)counters->bytes : 1;
+    fprintf(stderr, "ft_ssl: stats: %s: ", label);
+    if (counters->inputs != 1)
+        fprintf(stderr, "%zu inputs, ", counters->inputs);
+    fprintf(stderr, "%zu bytes, %zu reads (%.0f bytes avg), io %.3f ms, update %.3f ms, %zu blocks", counters->bytes, counters->reads,
+            counters->reads ? (double)counters->bytes / (double)counters->reads : 0.0, (double)counters->io_ns / 1e6,
+            (double)counters->update_ns / 1e6, counters->blocks);
+    if (counters->update_cycles)
+        fprintf(stderr, ", %.2f cycles/byte", (double)counters->update_cycles / bytes);
+    if (counters->hw_inputs == counters->inputs && counters->hw_cycles)
+        fprintf(stderr, ", %.2f core cycles/byte, %.2f IPC", (double)counters->hw_cycles / bytes,
+                (double)counters->hw_instructions / (double)counters->hw_cycles);
+    fprintf(stderr, "\n");
+}
+
+stats_t * stats_new(size_t block_size) {
+    stats_t * stats = calloc(1, sizeof(stats_t));
+    if (stats) {
+        stats->block_size = block_size;
+        pthread_mutex_init(&stats->lock, NULL);
+    }
+    return stats;
+}
+
+void stats_free(stats_t * stats) {
+    stats_print("total", &stats->total);
+    pthread_mutex_destroy(&stats->lock);
+    free(stats);
+}
+
+void stats_input_start(stats_input_t * input) {
+    memset(&input->counters, 0, sizeof(input->counters));
+    stats_perf_start(input->perf_fds);
+    input->mark_ns = stats_now();
+    input->mark_cycles = stats_cycles();
+}
+
+void stats_read(stats_input_t * input) {
+    const uint64_t now = stats_now();
+    input->counters.io_ns += now - input->mark_ns;
+    input->counters.reads++;
+    input->mark_ns = now;
+    input->mark_cycles = stats_cycles();
+}
+
+void stats_update(stats_input_t * input) {
+    const uint64_t cycles = stats_cycles();
+    const uint64_t now = stats_now();
+    input->counters.update_ns += now - input->mark_ns;
+    input->counters.update_cycles += cycles - input->mark_cycles;
+    input->mark_ns = now;
+    input->mark_cycles = cycles;
+}
+
+void stats_input_end(stats_t * stats, stats_input_t * input, const char * label, size_t bytes) {
+
+    stats_counters_t * counters = &input->counters;
+    if (input->perf_fds[0] != -1)
+        stats_perf_stop(input->perf_fds, counters);
+
+    // The padding adds the 0x80 byte and the length (64 bits, or 128 bits with 128-byte blocks)
+    counters->inputs = 1;
+    counters->bytes = bytes;
+    counters->blocks = (bytes + stats->block_size / 8 + stats->block_size) / stats->block_size;
+    stats_print(label, counters);
+
+    pthread_mutex_lock(&stats->lock);
+    stats->total.inputs += counters->inputs;
+    stats->total.bytes += counters->bytes;
+    stats->total.reads += counters->reads;
+    stats->total.io_ns += counters->io_ns;
+    stats->total.update_ns += counters->update_ns;
+    stats->total.update_cycles += counters->update_cycles;
+    stats->total.blocks += counters->blocks;
+    stats->total.hw_cycles += counters->hw_cycles;
+    stats->total.hw_instructions += counters->hw_instructions;
+    stats->total.hw_inputs += counters->hw_inputs;
+    pthread_mutex_unlock(&stats->lock);
+}
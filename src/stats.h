@@ -0,0 +1,55 @@
+#pragma once
+
+#include <pthread.h> // for pthread_mutex_t
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint64_t
+
+/// @brief Counters of one input, or the totals of a run
+typedef struct {
+    size_t inputs;            ///< Inputs hashed
+    size_t bytes;             ///< Bytes hashed
+    size_t reads;             ///< Read calls (fread calls, pipeline buffers, or one per mapping)
+    uint64_t io_ns;           ///< Wall time reading (and echoing with -p)
+    uint64_t update_ns;       ///< Wall time in the digest update and final
+    uint64_t update_cycles;   ///< Timestamp counter cycles in the digest update and final
+    size_t blocks;            ///< Blocks compressed, padding included
+    uint64_t hw_cycles;       ///< Core cycles over the whole input, from perf_event_open
+    uint64_t hw_instructions; ///< Instructions retired over the whole input
+    size_t hw_inputs;         ///< Inputs measured with the hardware counters
+} stats_counters_t;
+
+/// @brief Totals of --stats, shared by the workers
+typedef struct stats_s {
+    stats_counters_t total; ///< Sum of the inputs
+    size_t block_size;      ///< Block size of the algorithm, to count the blocks
+    pthread_mutex_t lock;   ///< Protects total
+} stats_t;
+
+/// @brief Measure of one input in progress
+typedef struct {
+    stats_counters_t counters; ///< Counters of the input
+    uint64_t mark_ns;          ///< Time of the last stats_read or stats_update
+    uint64_t mark_cycles;      ///< Timestamp counter at the last stats_read or stats_update
+    int perf_fds[2];           ///< Cycles (the group leader) and instructions counters, -1 if unavailable
+} stats_input_t;
+
+/// @brief Allocate the totals of --stats
+/// @return NULL on allocation failure
+stats_t * stats_new(size_t block_size);
+
+/// @brief Print the totals to stderr and free them
+void stats_free(stats_t * stats);
+
+/// @brief Start measuring an input: time, timestamp counter, and the hardware counters if perf_event_open allows it
+void stats_input_start(stats_input_t * input);
+
+/// @brief Account the time since the last mark as I/O, for one read call
+void stats_read(stats_input_t * input);
+
+/// @brief Account the time since the last mark as hashing
+void stats_update(stats_input_t * input);
+
+/// @brief Stop measuring an input, print its counters to stderr and add them to the totals
+/// @param label Name of the input in the report
+/// @param bytes Bytes hashed (not counting a resumed midstate)
+void stats_input_end(stats_t * stats, stats_input_t * input, const char * label, size_t bytes);
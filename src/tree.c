@@ -0,0 +1,196 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "digest.h"
+#include "output.h"
+#include "pool.h"
+#include "tree.h"
+#include "utils.h"
+
+/// @brief Digests of the leaves, in order
+typedef struct {
+    uint8_t * digests; ///< Concatenated leaf digests
+    size_t count;      ///< Number of leaves
+    size_t capacity;   ///< Number of digests that fit in `digests`
+} tree_leaves_t;
+
+static void tree_add_leaf(tree_leaves_t * leaves, size_t digest_size, const uint32_t hash[FT_SSL_MAX_STATE_WORDS], size_t word_count) {
+
+    if (leaves->count == leaves->capacity) {
+        const size_t capacity = leaves->capacity ? leaves->capacity * 2 : 16;
+        uint8_t * digests = realloc(leaves->digests, capacity * digest_size);
+        if (!digests) {
+            perror("realloc");
+            exit(EXIT_FAILURE);
+        }
+        leaves->digests = digests;
+        leaves->capacity = capacity;
+    }
+
+    ft_ssl_digest_bytes(hash, word_count, leaves->digests + leaves->count * digest_size);
+    leaves->count++;
+}
+
+/// @brief Main loop of the pool workers, each job being a leaf in memory
+static void tree_worker(pool_worker_t * worker) {
+
+    const ft_ssl_algorithm_t * algorithm = worker->context.entry.data;
+
+    ft_ssl_job_t * job;
+    while ((job = pool_next(worker, true))) {
+        ft_ssl_hash_buffer(algorithm, job->data, job->size, job->hash);
+        pool_complete(worker->pool, job);
+    }
+}
+
+/// @brief Hash the leaves of a message in memory, on a pool of workers if there are several
+static void tree_hash_leaves(ft_ssl_context_t * context, const uint8_t * data, size_t size, tree_leaves_t * leaves) {
+
+    const ft_ssl_algorithm_t * algorithm = context->entry.data;
+    const size_t digest_size = algorithm->word_count * 4;
+
+    // An empty input still has one (empty) leaf
+    const size_t count = size ? (size + context->leaf_size - 1) / context->leaf_size : 1;
+    ft_ssl_job_t * jobs = calloc(count, sizeof(ft_ssl_job_t));
+    if (!jobs) {
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < count; i++) {
+        const size_t offset = i * context->leaf_size;
+        jobs[i].data = data + offset;
+        jobs[i].size = size - offset < context->leaf_size ? size - offset : context->leaf_size;
+    }
+
+    const size_t worker_count = context->worker_count < count ? context->worker_count : count;
+    if (worker_count == 1) {
+        for (size_t i = 0; i < count; i++)
+            ft_ssl_hash_buffer(algorithm, jobs[i].data, jobs[i].size, jobs[i].hash);
+    } else {
+        pool_t pool;
+        pool_start(&pool, worker_count, context, tree_worker);
+        for (size_t i = 0; i < count; i++)
+            pool_submit(&pool, &jobs[i]);
+        for (size_t i = 0; i < count; i++)
+            pool_wait(&pool, &jobs[i]);
+        pool_stop(&pool);
+    }
+
+    for (size_t i = 0; i < count; i++)
+        tree_add_leaf(leaves, digest_size, jobs[i].hash, algorithm->word_count);
+    free(jobs);
+}
+
+/// @brief Hash the leaves of a stream one after the other, as they are read
+static void tree_hash_stream(ft_ssl_context_t * context, FILE * file, tree_leaves_t * leaves) {
+
+    const ft_ssl_algorithm_t * algorithm = context->entry.data;
+    const size_t digest_size = algorithm->word_count * 4;
+
+    uint8_t * leaf = malloc(context->leaf_size);
+    if (!leaf) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    for (;;) {
+        const size_t size = fread(leaf, 1, context->leaf_size, file);
+        if (size == 0 && leaves->count > 0)
+            break;
+
+        if (file == stdin && IS_OPTION_P(context->options))
+            output_write(leaf, size);
+        context->message_size += size;
+
+        uint32_t hash[FT_SSL_MAX_STATE_WORDS];
+        ft_ssl_hash_buffer(algorithm, leaf, size, hash);
+        tree_add_leaf(leaves, digest_size, hash, algorithm->word_count);
+
+        if (size < context->leaf_size)
+            break;
+    }
+
+    free(leaf);
+}
+
+/// @brief Write one line per leaf: digest, offset, size and input
+static void tree_write_manifest(ft_ssl_context_t * context, const tree_leaves_t * leaves, FILE * file) {
+
+    const size_t digest_size = ((ft_ssl_algorithm_t *)context->entry.data)->word_count * 4;
+
+    for (size_t i = 0; i < leaves->count; i++) {
+        for (size_t j = 0; j < digest_size; j++)
+            fprintf(context->manifest, "%02x", leaves->digests[i * digest_size + j]);
+
+        const size_t offset = i * context->leaf_size;
+        const size_t size = i + 1 < leaves->count ? context->leaf_size : context->message_size - offset;
+        fprintf(context->manifest, " %zu %zu ", offset, size);
+
+        if (context->filename)
+            fprintf(context->manifest, "%s\n", context->filename);
+        else if (file != stdin && context->p_message)
+            fprintf(context->manifest, "\"%s\"\n", context->p_message);
+        else
+            fprintf(context->manifest, "stdin\n");
+    }
+}
+
+/// @brief Write the manifest and hash the leaf digests into the root
+static void tree_hash_root(ft_ssl_context_t * context, tree_leaves_t * leaves, FILE * file) {
+
+    const ft_ssl_algorithm_t * algorithm = context->entry.data;
+
+    if (context->manifest)
+        tree_write_manifest(context, leaves, file);
+
+    ft_ssl_hash_buffer(algorithm, leaves->digests, leaves->count * algorithm->word_count * 4, context->hash);
+    free(leaves->digests);
+}
+
+void tree_hash(ft_ssl_context_t * context, FILE * file) {
+
+    tree_leaves_t leaves = {NULL, 0, 0};
+
+    context->message_size = 0;
+
+    if (file == stdin && IS_OPTION_P(context->options) && !IS_OPTION_Q(context->options))
+        output_write("(\"", 2);
+
+    // Only a mapped file can be split up front, other inputs are read leaf by leaf
+    ft_ssl_mapping_t mapping;
+    bool mapped = ft_ssl_map(file, 0, &mapping);
+    if (mapped) {
+        context->message_size = mapping.size;
+        tree_hash_leaves(context, mapping.data, mapping.size, &leaves);
+
+        // The zeros read past a truncation are not the file: read what is left of it instead
+        mapped = ft_ssl_map_intact(&mapping);
+        if (mapped && file == stdin && IS_OPTION_P(context->options))
+            output_write(mapping.data, mapping.size);
+        if (!mapped) {
+            free(leaves.digests);
+            leaves = (tree_leaves_t){NULL, 0, 0};
+            context->message_size = 0;
+        }
+        ft_ssl_unmap(file, &mapping);
+    }
+    if (!mapped)
+        tree_hash_stream(context, file, &leaves);
+
+    if (file == stdin && IS_OPTION_P(context->options) && !IS_OPTION_Q(context->options))
+        output_write("\")= ", 4);
+
+    tree_hash_root(context, &leaves, file);
+}
+
+void tree_hash_buffer(ft_ssl_context_t * context, const uint8_t * data, size_t size) {
+
+    tree_leaves_t leaves = {NULL, 0, 0};
+
+    context->message_size = size;
+    tree_hash_leaves(context, data, size, &leaves);
+    tree_hash_root(context, &leaves, NULL);
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stddef.h> // for size_t
+#include <stdint.h> // for uint8_t
+#include <stdio.h>  // for FILE
+
+#include "ft_ssl.h" // for ft_ssl_context_t
+
+/// @brief Tree hash of a stream: the leaves of context->leaf_size bytes are hashed (in parallel for
+///        regular files), then the root is the hash of the concatenated leaf digests
+void tree_hash(ft_ssl_context_t * context, FILE * file);
+
+/// @brief Tree hash of a message in memory (the -s argument)
+void tree_hash_buffer(ft_ssl_context_t * context, const uint8_t * data, size_t size);
@@ -0,0 +1,386 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// linux/fs.h, included by linux/io_uring.h, has a BLOCK_SIZE of its own
+#undef BLOCK_SIZE
+
+#include "digest.h"
+#include "hmac.h"
+#include "uring.h"
+
+/// @brief Operation of a submission, in the low byte of its user data (the slot index is above it)
+typedef enum {
+    URING_OPEN,
+    URING_READ,
+    URING_CLOSE,
+} uring_op_t;
+
+/// @brief Submission and completion rings shared with the kernel
+typedef struct {
+    int fd;                     ///< io_uring file descriptor
+    void * sq_ring;             ///< Mapping of the submission ring
+    size_t sq_ring_size;        ///< Size of the submission ring mapping
+    void * cq_ring;             ///< Mapping of the completion ring (sq_ring itself with a single mapping)
+    size_t cq_ring_size;        ///< Size of the completion ring mapping
+    struct io_uring_sqe * sqes; ///< Submission queue entries
+    size_t sqes_size;           ///< Size of the entries mapping
+    unsigned * sq_head;         ///< First entry not yet consumed by the kernel
+    unsigned * sq_tail;         ///< Entries published to the kernel
+    unsigned * sq_array;        ///< Indices of the published entries
+    unsigned sq_mask;           ///< Mask of the submission ring indices
+    unsigned sq_entries;        ///< Number of submission entries
+    unsigned sq_filled;         ///< Tail of the entries filled so far, published at the next enter
+    unsigned * cq_head;         ///< First completion not yet consumed
+    unsigned * cq_tail;         ///< Completions posted by the kernel
+    unsigned cq_mask;           ///< Mask of the completion ring indices
+    struct io_uring_cqe * cqes; ///< Completion queue entries
+} uring_t;
+
+/// @brief A file in flight
+typedef struct {
+    ft_ssl_job_t * job;                            ///< Job of the file (NULL for an idle slot)
+    int fd;                                        ///< File descriptor, once open (-1 before)
+    int error;                                     ///< errno value of the open
+    uint8_t * buffer;                              ///< Registered buffer of the slot
+    size_t offset;                                 ///< Bytes read so far
+    ft_ssl_digest_t digests[FT_SSL_MAX_ALGORITHMS]; ///< A digest per algorithm of the context
+} uring_slot_t;
+
+/// @brief A ring with a slot, and a buffer, per file in flight
+typedef struct {
+    ft_ssl_context_t * context;   ///< Algorithms of the digests
+    ft_ssl_job_source_t * source; ///< Where the jobs come from and go back to
+    uring_t ring;                 ///< Rings
+    uring_slot_t * slots;         ///< Slots
+    size_t slot_count;            ///< Number of slots (the queue depth)
+    uint8_t * buffers;            ///< Storage of the buffers, one after the other
+    bool fixed;                   ///< The buffers are registered (reads use IORING_OP_READ_FIXED)
+    size_t active;                ///< Number of slots with a job
+    size_t closing;               ///< Number of closes in flight
+} uring_engine_t;
+
+static void * uring_at(void * base, uint32_t offset) {
+    return (uint8_t *)base + offset;
+}
+
+/// @brief Create the rings and map them
+/// @return false if the kernel has no io_uring (or it is disabled)
+static bool uring_setup(uring_t * ring, unsigned entries) {
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd == -1)
+        return false;
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    const bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single && ring->cq_ring_size > ring->sq_ring_size)
+        ring->sq_ring_size = ring->cq_ring_size;
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    ring->cq_ring = single ? ring->sq_ring
+                           : mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        if (ring->sq_ring != MAP_FAILED)
+            munmap(ring->sq_ring, ring->sq_ring_size);
+        if (!single && ring->cq_ring != MAP_FAILED)
+            munmap(ring->cq_ring, ring->cq_ring_size);
+        if (ring->sqes != MAP_FAILED)
+            munmap(ring->sqes, ring->sqes_size);
+        close(ring->fd);
+        return false;
+    }
+
+    ring->sq_head = uring_at(ring->sq_ring, params.sq_off.head);
+    ring->sq_tail = uring_at(ring->sq_ring, params.sq_off.tail);
+    ring->sq_array = uring_at(ring->sq_ring, params.sq_off.array);
+    ring->sq_mask = *(unsigned *)uring_at(ring->sq_ring, params.sq_off.ring_mask);
+    ring->sq_entries = params.sq_entries;
+    ring->sq_filled = *ring->sq_tail;
+    ring->cq_head = uring_at(ring->cq_ring, params.cq_off.head);
+    ring->cq_tail = uring_at(ring->cq_ring, params.cq_off.tail);
+    ring->cq_mask = *(unsigned *)uring_at(ring->cq_ring, params.cq_off.ring_mask);
+    ring->cqes = uring_at(ring->cq_ring, params.cq_off.cqes);
+    return true;
+}
+
+static void uring_teardown(uring_t * ring) {
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring != ring->sq_ring)
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+}
+
+/// @brief Whether the kernel knows every operation of the engine (openat and close came with 5.6)
+static bool uring_supported(const uring_t * ring) {
+
+    const size_t op_count = IORING_OP_LAST;
+    struct io_uring_probe * probe = calloc(1, sizeof(struct io_uring_probe) + op_count * sizeof(struct io_uring_probe_op));
+    if (!probe)
+        return false;
+
+    bool supported = syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PROBE, probe, op_count) == 0;
+    const uint8_t ops[] = {IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_READ_FIXED, IORING_OP_CLOSE};
+    for (size_t i = 0; supported && i < sizeof(ops); i++)
+        supported = ops[i] <= probe->last_op && (probe->ops[ops[i]].flags & IO_URING_OP_SUPPORTED);
+    free(probe);
+    return supported;
+}
+
+/// @brief Publish the entries filled so far, then wait for `min_complete` completions
+static void uring_enter(uring_t * ring, unsigned min_complete) {
+
+    __atomic_store_n(ring->sq_tail, ring->sq_filled, __ATOMIC_RELEASE);
+    for (;;) {
+        // Entries the kernel could not take yet stay in the ring, and are counted again
+        const unsigned to_submit = ring->sq_filled - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+        const unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+        if (syscall(__NR_io_uring_enter, ring->fd, to_submit, min_complete, flags, NULL, 0) != -1)
+            return;
+        if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            perror("io_uring_enter");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+/// @brief Fill the next submission entry, submitting the filled ones first if the ring is full
+static void uring_submit(uring_t * ring, const struct io_uring_sqe * sqe) {
+
+    while (ring->sq_filled - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) == ring->sq_entries)
+        uring_enter(ring, 0);
+
+    const unsigned index = ring->sq_filled & ring->sq_mask;
+    ring->sqes[index] = *sqe;
+    ring->sq_array[index] = index;
+    ring->sq_filled++;
+}
+
+static uint64_t uring_user_data(size_t slot, uring_op_t op) {
+    return (uint64_t)slot << 8 | op;
+}
+
+static void uring_read(uring_engine_t * engine, size_t s) {
+
+    uring_slot_t * slot = &engine->slots[s];
+    struct io_uring_sqe sqe;
+    memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = engine->fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe.fd = slot->fd;
+    sqe.addr = (uint64_t)(uintptr_t)slot->buffer;
+    sqe.len = URING_BUFFER_SIZE;
+    sqe.off = slot->offset;
+    sqe.buf_index = (uint16_t)(engine->fixed ? s : 0);
+    sqe.user_data = uring_user_data(s, URING_READ);
+    uring_submit(&engine->ring, &sqe);
+}
+
+/// @brief Start a file with its open
+static void uring_open(uring_engine_t * engine, size_t s, ft_ssl_job_t * job) {
+
+    uring_slot_t * slot = &engine->slots[s];
+    slot->job = job;
+    slot->fd = -1;
+    slot->error = 0;
+    slot->offset = 0;
+    if (engine->context->hmac)
+        hmac_start(engine->context->hmac, &slot->digests[0]);
+    else
+        ft_ssl_digest_init(&slot->digests[0], engine->context->entry.data);
+    for (size_t i = 1; i < engine->context->algorithm_count; i++)
+        ft_ssl_digest_init(&slot->digests[i], engine->context->algorithms[i]);
+
+    struct io_uring_sqe sqe;
+    memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_OPENAT;
+    sqe.fd = AT_FDCWD;
+    sqe.addr = (uint64_t)(uintptr_t)job->filename;
+    sqe.open_flags = O_RDONLY | O_CLOEXEC;
+    sqe.user_data = uring_user_data(s, URING_OPEN);
+    uring_submit(&engine->ring, &sqe);
+
+    engine->active++;
+}
+
+/// @brief Close the file of a slot, set the digests (or the error) of its job and hand it back
+static void uring_finish(uring_engine_t * engine, size_t s) {
+
+    uring_slot_t * slot = &engine->slots[s];
+    if (slot->fd != -1) {
+        // Nothing waits for the close: the slot takes its next file right away
+        struct io_uring_sqe sqe;
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_CLOSE;
+        sqe.fd = slot->fd;
+        sqe.user_data = uring_user_data(s, URING_CLOSE);
+        uring_submit(&engine->ring, &sqe);
+        engine->closing++;
+    }
+
+    ft_ssl_job_t * job = slot->job;
+    job->error = slot->error;
+    if (!slot->error) {
+        if (engine->context->hmac)
+            hmac_final(engine->context->hmac, &slot->digests[0]);
+        else
+            ft_ssl_digest_final(&slot->digests[0], NULL);
+        memcpy(job->hash, slot->digests[0].hash, sizeof(job->hash));
+        for (size_t i = 1; i < engine->context->algorithm_count; i++) {
+            ft_ssl_digest_final(&slot->digests[i], NULL);
+            memcpy(job->other_hashes[i - 1], slot->digests[i].hash, sizeof(job->other_hashes[i - 1]));
+        }
+    }
+
+    slot->job = NULL;
+    engine->active--;
+    engine->source->done(engine->source->arg, job);
+}
+
+/// @brief Handle a completion: the next submission of its file, or the end of it
+static void uring_complete(uring_engine_t * engine, const struct io_uring_cqe * cqe) {
+
+    const size_t s = (size_t)(cqe->user_data >> 8);
+    const uring_op_t op = (uring_op_t)(cqe->user_data & 0xff);
+    uring_slot_t * slot = &engine->slots[s];
+
+    switch (op) {
+        case URING_OPEN:
+            if (cqe->res < 0) {
+                slot->error = -cqe->res;
+                uring_finish(engine, s);
+            } else {
+                slot->fd = cqe->res;
+                uring_read(engine, s);
+            }
+            return;
+
+        case URING_READ:
+            if (cqe->res == -EINTR || cqe->res == -EAGAIN) {
+                uring_read(engine, s);
+                return;
+            }
+            // Read errors end the input, like they do for fread, and only a read of 0 bytes ends the others: the size
+            // of procfs and sysfs files says 0, and files may grow or shrink while they are read
+            if (cqe->res <= 0) {
+                uring_finish(engine, s);
+                return;
+            }
+            for (size_t i = 0; i < engine->context->algorithm_count; i++)
+                ft_ssl_digest_update(&slot->digests[i], slot->buffer, (size_t)cqe->res);
+            slot->offset += (size_t)cqe->res;
+            uring_read(engine, s);
+            return;
+
+        case URING_CLOSE:
+            engine->closing--;
+            return;
+    }
+}
+
+/// @brief Create the rings, then the slots and their buffers (registered if the kernel takes them)
+/// @return false if io_uring cannot be used
+static bool uring_start(uring_engine_t * engine, ft_ssl_context_t * context, ft_ssl_job_source_t * source) {
+
+    memset(engine, 0, sizeof(uring_engine_t));
+    engine->context = context;
+    engine->source = source;
+    engine->slot_count = context->queue_depth;
+
+    // Up to two submissions per slot: the close of its previous file, then the open of the next one.
+    // The completion ring is twice as large as the submission ring, so that it never overflows
+    const unsigned entries = (unsigned)(2 * engine->slot_count);
+    if (!uring_setup(&engine->ring, entries))
+        return false;
+    if (!uring_supported(&engine->ring)) {
+        uring_teardown(&engine->ring);
+        return false;
+    }
+
+    engine->slots = calloc(engine->slot_count, sizeof(uring_slot_t));
+    engine->buffers = mmap(NULL, engine->slot_count * URING_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    struct iovec * iovecs = calloc(engine->slot_count, sizeof(struct iovec));
+    if (engine->buffers == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+    if (!engine->slots || !iovecs) {
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t s = 0; s < engine->slot_count; s++) {
+        engine->slots[s].buffer = engine->buffers + s * URING_BUFFER_SIZE;
+        iovecs[s] = (struct iovec){engine->slots[s].buffer, URING_BUFFER_SIZE};
+    }
+
+    // Registered buffers are pinned once instead of for every read, plain reads still work without them
+    engine->fixed = syscall(__NR_io_uring_register, engine->ring.fd, IORING_REGISTER_BUFFERS, iovecs, engine->slot_count) == 0;
+    free(iovecs);
+    return true;
+}
+
+/// @brief Wait for a completion, then handle every completion posted (they may fill more submission entries)
+static void uring_reap(uring_engine_t * engine) {
+
+    uring_enter(&engine->ring, 1);
+
+    unsigned head = *engine->ring.cq_head;
+    const unsigned tail = __atomic_load_n(engine->ring.cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+        const struct io_uring_cqe cqe = engine->ring.cqes[head & engine->ring.cq_mask];
+        __atomic_store_n(engine->ring.cq_head, head + 1, __ATOMIC_RELEASE);
+        uring_complete(engine, &cqe);
+    }
+}
+
+static void uring_stop(uring_engine_t * engine) {
+
+    // The last files are only closed once their close completes
+    while (engine->closing)
+        uring_reap(engine);
+    uring_teardown(&engine->ring);
+    munmap(engine->buffers, engine->slot_count * URING_BUFFER_SIZE);
+    free(engine->slots);
+}
+
+bool uring_hash_jobs(ft_ssl_context_t * context, ft_ssl_job_source_t * source) {
+
+    uring_engine_t engine;
+    if (!uring_start(&engine, context, source))
+        return false;
+
+    bool drained = false;
+    while (!drained) {
+
+        // Fill the idle slots, only blocking for a job when every slot is idle
+        for (size_t s = 0; s < engine.slot_count; s++) {
+            if (engine.slots[s].job)
+                continue;
+            ft_ssl_job_t * job = source->next(source->arg, engine.active == 0);
+            if (!job) {
+                drained = engine.active == 0;
+                break;
+            }
+            uring_open(&engine, s, job);
+        }
+        if (!drained)
+            uring_reap(&engine);
+    }
+
+    uring_stop(&engine);
+    return true;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdbool.h> // for bool
+
+#include "ft_ssl.h" // for ft_ssl_context_t, ft_ssl_job_source_t
+
+/// @brief Default number of files in flight per worker with --io-uring
+#define URING_QUEUE_DEPTH 32
+
+/// @brief Upper bound for the --queue-depth option
+#define URING_MAX_QUEUE_DEPTH 4096
+
+/// @brief Size of the registered buffer of each file in flight (128 KiB)
+#define URING_BUFFER_SIZE (128 * 1024)
+
+/// @brief Hash every job of a source with io_uring, keeping context->queue_depth files in flight
+/// @details Each file goes through an openat, reads into its own registered buffer until one returns 0 bytes
+///          (one at a time, each completed buffer fed to the digests while the other files' reads are in
+///          flight), then a close. Read errors end the input, like they do for fread. Several workers each
+///          run their own ring.
+/// @return false, before taking any job, if the kernel has no io_uring or lacks one of the operations
+bool uring_hash_jobs(ft_ssl_context_t * context, ft_ssl_job_source_t * source);
@@ -1,86 +1,645 @@
+#define _GNU_SOURCE // for tee, F_SETPIPE_SZ, F_GETPIPE_SZ
+
+#include "cache.h"
+#include "checkpoint.h"
+#include "digest.h"
+#include "hmac.h"
+#include "output.h"
+#include "pipeline.h"
+#include "stats.h"
+#include "tree.h"
+#include "uring.h"
 #include "utils.h"
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-static void print_hash(ft_ssl_context_t * context) {
-    for (size_t i = 0; i < ((ft_ssl_algorithm_t *)context->entry.data)->word_count; i++)
-        printf("%08x", context->hash[i]);
+static void print_hash(const ft_ssl_algorithm_t * algorithm, const uint32_t * hash) {
+    output_hex(hash, algorithm->word_count);
 }
 
-void ft_ssl_print(ft_ssl_context_t * context, FILE * file) {
+/// @brief Print the name of the algorithm, as HMAC-NAME with a key
+void ft_ssl_format_name(const ft_ssl_context_t * context, const ft_ssl_algorithm_t * algorithm, char name[FT_SSL_NAME_SIZE]) {
+
+    if (!IS_OPTION_TREE(context->options)) {
+        snprintf(name, FT_SSL_NAME_SIZE, "%s%s", context->hmac ? "HMAC-" : "", algorithm->upper_name);
+        return;
+    }
+
+    // A root is not the digest of the file: the label keeps it apart, with what it takes to hash it again
+    size_t leaf_size = context->leaf_size;
+    const char * unit = "";
+    for (const char * units = "KMG"; *units && leaf_size % 1024 == 0; units++) {
+        leaf_size /= 1024;
+        unit = units;
+    }
+    snprintf(name, FT_SSL_NAME_SIZE, "%s-TREE-%zu%.1s", algorithm->upper_name, leaf_size, unit);
+}
+
+static void print_name(const ft_ssl_context_t * context, const ft_ssl_algorithm_t * algorithm) {
+
+    if (IS_OPTION_TREE(context->options)) {
+        char name[FT_SSL_NAME_SIZE];
+        ft_ssl_format_name(context, algorithm, name);
+        output_string(name);
+        return;
+    }
+
+    if (context->hmac)
+        output_write("HMAC-", 5);
+    output_string(algorithm->upper_name);
+}
+
+/// @brief Print the line of one algorithm
+static void print_digest(ft_ssl_context_t * context, FILE * file, const ft_ssl_algorithm_t * algorithm, const uint32_t * hash) {
+
+    // Fixed-size records for machine consumers, nothing else
+    if (IS_OPTION_RAW(context->options)) {
+        output_raw(hash, algorithm->word_count);
+        output_end_record();
+        return;
+    }
 
     if (file == stdin && IS_OPTION_P(context->options)) {
-        print_hash(context);
-        printf("\n");
+        print_hash(algorithm, hash);
     } else if (IS_OPTION_Q(context->options)) {
-        print_hash(context);
-        printf("\n");
+        print_hash(algorithm, hash);
     } else if (IS_OPTION_R(context->options)) {
-        print_hash(context);
-        context->p_message
-        ? printf(" \"%s\"\n", context->p_message)
-        : printf(" *%s\n", context->filename ? context->filename : "stdin");
+        print_hash(algorithm, hash);
+        if (context->p_message) {
+            output_write(" \"", 2);
+            output_string(context->p_message);
+            output_write("\"", 1);
+        } else {
+            output_write(" *", 2);
+            output_string(context->filename ? context->filename : "stdin");
+        }
     } else {
         if (context->filename) {
-            printf("%s(%s)= ", ((ft_ssl_algorithm_t *)context->entry.data)->upper_name, context->filename);
+            print_name(context, algorithm);
+            output_write("(", 1);
+            output_string(context->filename);
+            output_write(")= ", 3);
         } else if (IS_OPTION_S(context->options) && file != stdin) {
-            printf("%s(\"%s\")= ", ((ft_ssl_algorithm_t *)context->entry.data)->upper_name, context->p_message);
+            print_name(context, algorithm);
+            output_write("(\"", 2);
+            output_string(context->p_message);
+            output_write("\")= ", 4);
         } else if (IS_OPTION_P(context->options) && context->p_message) {
-            printf("(\"%s\")= ", context->p_message);
+            output_write("(\"", 2);
+            output_string(context->p_message);
+            output_write("\")= ", 4);
         } else {
-            printf("%s(stdin)= ", ((ft_ssl_algorithm_t *)context->entry.data)->upper_name);
+            print_name(context, algorithm);
+            output_write("(stdin)= ", 9);
         }
-        print_hash(context);
-        printf("\n");
+        print_hash(algorithm, hash);
     }
+    output_write("\n", 1);
+    output_end_record();
 }
 
-void process_input(ft_ssl_context_t * context, FILE * file, void (*pad)(uint8_t *, size_t *, size_t), void (*update)(uint8_t *, size_t, uint32_t *)) {
+void ft_ssl_print(ft_ssl_context_t * context, FILE * file) {
 
-    if (file == stdin && IS_OPTION_P(context->options) && !IS_OPTION_Q(context->options))
-        write(1, "(\"", 2);
+    // One line per algorithm, in the order of the list
+    print_digest(context, file, context->entry.data, context->hash);
+    for (size_t i = 1; i < context->algorithm_count; i++)
+        print_digest(context, file, context->algorithms[i], context->other_hashes[i - 1]);
+}
 
-    size_t read_bytes = 0;
-    bool padding_done = false;
+bool ft_ssl_parse_hash(const char * hex, size_t word_count, uint32_t * words) {
+
+    for (size_t i = 0; i < word_count * 8; i++)
+        if (!isxdigit((unsigned char)hex[i]))
+            return false;
+
+    for (size_t i = 0; i < word_count; i++) {
+        char word[9];
+        memcpy(word, hex + 8 * i, 8);
+        word[8] = '\0';
+        words[i] = (uint32_t)strtoul(word, NULL, 16);
+    }
+    return true;
+}
+
+void ft_ssl_print_error(ft_ssl_context_t * context, const char * filename, int error) {
+
+    // Keep the raw records aligned
+    if (IS_OPTION_RAW(context->options)) {
+        fprintf(stderr, "ft_ssl: %s: %s: %s\n", ((ft_ssl_algorithm_t *)context->entry.data)->lower_name, filename, strerror(error));
+        return;
+    }
+
+    output_write("ft_ssl: ", 8);
+    output_string(((ft_ssl_algorithm_t *)context->entry.data)->lower_name);
+    output_write(": ", 2);
+    output_string(filename);
+    output_write(": ", 2);
+    output_string(strerror(error));
+    output_write("\n", 1);
+    output_end_record();
+}
+
+void ft_ssl_print_job(ft_ssl_context_t * context, ft_ssl_job_t * job) {
+
+    if (job->error) {
+        ft_ssl_print_error(context, job->filename, job->error);
+        return;
+    }
+
+    context->filename = job->filename;
+    context->p_message = NULL;
+    memcpy(context->hash, job->hash, sizeof(job->hash));
+    if (job->other_hashes)
+        memcpy(context->other_hashes, job->other_hashes, (context->algorithm_count - 1) * sizeof(*job->other_hashes));
+    ft_ssl_print(context, NULL);
+}
+
+void ft_ssl_hash_job(ft_ssl_context_t * context, ft_ssl_job_t * job) {
+
+    const ft_ssl_algorithm_t * algorithm = context->entry.data;
+
+    // Setup the context
+    context->message_size = 0;
+    context->filename = job->filename;
+    context->p_message = NULL;
+
+    // Open from file
+    FILE * file = fopen(job->filename, "rb");
+    if (!file) {
+        job->error = errno;
+        return;
+    }
+
+    // Hash the message, unless the cache knows this version of the file
+    struct stat st;
+    const bool cacheable = context->cache && fstat(fileno(file), &st) == 0 && S_ISREG(st.st_mode);
+    if (!cacheable || !cache_lookup(context->cache, &st, algorithm, job->hash)) {
+        ft_ssl_hash(context, file);
+        memcpy(job->hash, context->hash, sizeof(job->hash));
+        if (job->other_hashes)
+            memcpy(job->other_hashes, context->other_hashes, (context->algorithm_count - 1) * sizeof(*job->other_hashes));
+        if (cacheable)
+            cache_store(context->cache, fileno(file), &st, algorithm, job->hash);
+    }
+
+    // Close the file stream
+    fclose(file);
+}
+
+void ft_ssl_hash_jobs(ft_ssl_context_t * context, ft_ssl_job_source_t * source, bool many) {
+
+    const ft_ssl_algorithm_t * algorithm = context->entry.data;
+    if (IS_OPTION_URING(context->options) && uring_hash_jobs(context, source))
+        return;
+    if (many && algorithm->f_many && algorithm->f_many(context, source))
+        return;
+
+    ft_ssl_job_t * job;
+    while ((job = source->next(source->arg, true))) {
+        ft_ssl_hash_job(context, job);
+        source->done(source->arg, job);
+    }
+}
+
+void write_all(int fd, const uint8_t * data, size_t size) {
+    while (size > 0) {
+        const ssize_t written = write(fd, data, size);
+        if (written <= 0)
+            return;
+        data += written;
+        size -= (size_t)written;
+    }
+}
+
+/// @brief Mappings that the SIGBUS handler knows of (a file beyond these is read instead of mapped)
+#define MAP_SLOTS 256
+
+/// @brief Range of a live mapping, written before `start` publishes it to the handler
+typedef struct {
+    int used;        ///< Claimed by a mapping
+    uintptr_t start; ///< First byte of the mapping (0 while the slot is being filled)
+    size_t size;     ///< Size of the mapping
+    int damaged;     ///< Part of the mapping read as zeros past the end of its truncated file
+} map_slot_t;
+
+static map_slot_t map_slots[MAP_SLOTS];
+
+/// @brief Read once before the handler is installed (sysconf is not async-signal-safe)
+static uintptr_t map_page_size;
+
+/// @brief Replace the rest of a mapping whose file was truncated by zero pages, so that the access is retried
+/// @details Any other SIGBUS restores the default action, and the access is retried to die with it
+static void map_fault(int sig, siginfo_t * info, void * ucontext) {
+    (void)ucontext;
+    const uintptr_t address = (uintptr_t)info->si_addr;
+    for (size_t i = 0; info->si_code == BUS_ADRERR && i < MAP_SLOTS; i++) {
+        const uintptr_t start = __atomic_load_n(&map_slots[i].start, __ATOMIC_ACQUIRE);
+        if (!start || address < start || address - start >= map_slots[i].size)
+            continue;
+
+        // One fault per mapping: the other pages past the new end would fault too
+        const uintptr_t page = address & ~(map_page_size - 1);
+        const uintptr_t end = (start + map_slots[i].size + map_page_size - 1) & ~(map_page_size - 1);
+        if (mmap((void *)page, end - page, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED)
+            break;
+        __atomic_store_n(&map_slots[i].damaged, 1, __ATOMIC_RELEASE);
+        return;
+    }
+    signal(sig, SIG_DFL);
+}
+
+static void map_fault_install(void) {
+    map_page_size = (uintptr_t)sysconf(_SC_PAGESIZE);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = map_fault;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGBUS, &action, NULL);
+}
+
+/// @brief Make a mapping known to the SIGBUS handler
+/// @return false if every slot is taken
+static bool map_register(ft_ssl_mapping_t * mapping) {
+    for (size_t i = 0; i < MAP_SLOTS; i++) {
+        int unused = 0;
+        if (!__atomic_compare_exchange_n(&map_slots[i].used, &unused, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            continue;
+        map_slots[i].size = mapping->map_size;
+        map_slots[i].damaged = 0;
+        __atomic_store_n(&map_slots[i].start, (uintptr_t)mapping->map, __ATOMIC_RELEASE);
+        mapping->slot = i;
+        return true;
+    }
+    return false;
+}
+
+bool ft_ssl_map(FILE * file, size_t min_size, ft_ssl_mapping_t * mapping) {
+
+    // A file may shrink while it is hashed, which the fread path survives too
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, map_fault_install);
+
+    const int fd = fileno(file);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) == -1 || !S_ISREG(st.st_mode))
+        return false;
+
+    // Start where the stream is (stdin may already be partly consumed)
+    const off_t offset = lseek(fd, 0, SEEK_CUR);
+    if (offset < 0 || offset > st.st_size || (size_t)(st.st_size - offset) < min_size)
+        return false;
+
+    // mmap refuses empty mappings
+    mapping->size = (size_t)(st.st_size - offset);
+    mapping->offset = offset;
+    mapping->slot = MAP_SLOTS;
+    if (mapping->size == 0) {
+        mapping->map = NULL;
+        mapping->map_size = 0;
+        mapping->data = NULL;
+        return true;
+    }
+
+    const off_t map_offset = offset & ~(off_t)(map_page_size - 1);
+    mapping->map_size = mapping->size + (size_t)(offset - map_offset);
+    mapping->map = mmap(NULL, mapping->map_size, PROT_READ, MAP_PRIVATE, fd, map_offset);
+    if (mapping->map == MAP_FAILED)
+        return false;
+    if (!map_register(mapping)) {
+        munmap(mapping->map, mapping->map_size);
+        return false;
+    }
+    madvise(mapping->map, mapping->map_size, MADV_SEQUENTIAL);
+
+    mapping->data = (const uint8_t *)mapping->map + (offset - map_offset);
+    return true;
+}
+
+bool ft_ssl_map_intact(const ft_ssl_mapping_t * mapping) {
+    return mapping->slot == MAP_SLOTS || !__atomic_load_n(&map_slots[mapping->slot].damaged, __ATOMIC_ACQUIRE);
+}
+
+void ft_ssl_unmap(FILE * file, ft_ssl_mapping_t * mapping) {
+
+    const bool intact = ft_ssl_map_intact(mapping);
+    if (mapping->map)
+        munmap(mapping->map, mapping->map_size);
+    if (mapping->slot != MAP_SLOTS) {
+        __atomic_store_n(&map_slots[mapping->slot].start, 0, __ATOMIC_RELEASE);
+        __atomic_store_n(&map_slots[mapping->slot].used, 0, __ATOMIC_RELEASE);
+    }
+
+    // Back to the first mapped byte if the file has to be read again
+    lseek(fileno(file), intact ? mapping->offset + (off_t)mapping->size : mapping->offset, SEEK_SET);
+}
+
+void ft_ssl_hash(ft_ssl_context_t * context, FILE * file) {
+    if (IS_OPTION_TREE(context->options))
+        tree_hash(context, file);
+    else
+        process_input(context, file);
+}
+
+/// @brief Number of digests computed in one pass over an input
+static size_t process_digest_count(const ft_ssl_context_t * context) {
+    return context->algorithm_count > 1 ? context->algorithm_count : 1;
+}
+
+/// @brief Start a digest per algorithm of the context (from the inner midstate with a key)
+static void process_digests_init(const ft_ssl_context_t * context, ft_ssl_digest_t * digests) {
+    if (context->hmac)
+        hmac_start(context->hmac, &digests[0]);
+    else
+        ft_ssl_digest_init(&digests[0], context->entry.data);
+    for (size_t i = 1; i < process_digest_count(context); i++)
+        ft_ssl_digest_init(&digests[i], context->algorithms[i]);
+}
+
+/// @brief Finalize every digest, leaving the results in context->hash and context->other_hashes
+static void process_digests_final(ft_ssl_context_t * context, ft_ssl_digest_t * digests) {
+    if (context->hmac)
+        hmac_final(context->hmac, &digests[0]);
+    else
+        ft_ssl_digest_final(&digests[0], NULL);
+    memcpy(context->hash, digests[0].hash, sizeof(context->hash));
+    for (size_t i = 1; i < process_digest_count(context); i++) {
+        ft_ssl_digest_final(&digests[i], NULL);
+        memcpy(context->other_hashes[i - 1], digests[i].hash, sizeof(context->other_hashes[i - 1]));
+    }
+}
+
+/// @brief A buffer fed to one digest on its own thread
+typedef struct {
+    ft_ssl_digest_t * digest; ///< Digest to update
+    const void * data;        ///< Bytes of the buffer
+    size_t size;              ///< Size of the buffer
+} process_update_t;
+
+static void * process_update_thread(void * arg) {
+    process_update_t * update = arg;
+    ft_ssl_digest_update(update->digest, update->data, update->size);
+    return NULL;
+}
+
+/// @brief Feed a buffer to every digest: in turn, or on a thread per algorithm for large buffers of a single input
+static void process_update(const ft_ssl_context_t * context, ft_ssl_digest_t * digests, const void * data, size_t size) {
+
+    const size_t count = process_digest_count(context);
+    if (count == 1 || !IS_OPTION_ALGORITHM_THREADS(context->options) || size < ALGORITHM_THREADS_MIN) {
+        for (size_t i = 0; i < count; i++)
+            ft_ssl_digest_update(&digests[i], data, size);
+        return;
+    }
+
+    // The first digest stays on this thread, the others are hashed in place if their thread does not start
+    pthread_t threads[FT_SSL_MAX_ALGORITHMS];
+    process_update_t updates[FT_SSL_MAX_ALGORITHMS];
+    bool started[FT_SSL_MAX_ALGORITHMS] = {false};
+    for (size_t i = 1; i < count; i++) {
+        updates[i] = (process_update_t){&digests[i], data, size};
+        started[i] = pthread_create(&threads[i], NULL, process_update_thread, &updates[i]) == 0;
+    }
+    ft_ssl_digest_update(&digests[0], data, size);
+    for (size_t i = 1; i < count; i++) {
+        if (started[i])
+            pthread_join(threads[i], NULL);
+        else
+            ft_ssl_digest_update(&digests[i], data, size);
+    }
+}
+
+void ft_ssl_hash_string(ft_ssl_context_t * context, const char * message) {
+
+    const size_t size = strlen(message);
+    if (IS_OPTION_TREE(context->options)) {
+        tree_hash_buffer(context, (const uint8_t *)message, size);
+        return;
+    }
+
+    stats_input_t stats;
+    if (context->stats)
+        stats_input_start(&stats);
+
+    ft_ssl_digest_t digests[FT_SSL_MAX_ALGORITHMS];
+    process_digests_init(context, digests);
+    process_update(context, digests, message, size);
+    process_digests_final(context, digests);
+    context->message_size = size;
+
+    if (context->stats) {
+        stats_update(&stats);
+        stats_input_end(context->stats, &stats, "string", size);
+    }
+}
+
+/// @brief Hash a regular file straight from a read-only mapping, copying only the last partial block
+/// @return false if the input should be streamed instead (pipes, memory streams, small files, or a file truncated
+///         while it was hashed, the digests left as they were)
+/// @details The page faults of the mapping are accounted as hashing in the stats
+static bool process_mapped(ft_ssl_context_t * context, FILE * file, ft_ssl_digest_t * digests, stats_input_t * stats) {
+
+    ft_ssl_mapping_t mapping;
+    if (!ft_ssl_map(file, MMAP_THRESHOLD, &mapping))
+        return false;
+
+    ft_ssl_digest_t saved[FT_SSL_MAX_ALGORITHMS];
+    memcpy(saved, digests, process_digest_count(context) * sizeof(*digests));
+
+    if (stats)
+        stats_read(stats);
+
+    process_update(context, digests, mapping.data, mapping.size);
+    if (stats)
+        stats_update(stats);
+
+    // The zeros read past a truncation are not the file: start over from what is left of it
+    if (!ft_ssl_map_intact(&mapping)) {
+        memcpy(digests, saved, process_digest_count(context) * sizeof(*digests));
+        ft_ssl_unmap(file, &mapping);
+        return false;
+    }
+
+    if (file == stdin && IS_OPTION_P(context->options))
+        output_write(mapping.data, mapping.size);
+
+    ft_ssl_unmap(file, &mapping);
+    return true;
+}
+
+/// @brief Hash a file descriptor while a reader thread fetches the next buffers
+/// @return false if the input is not backed by a file descriptor or the reader could not start
+/// @details The time waiting for the reader thread is accounted as I/O in the stats
+static bool process_pipelined(ft_ssl_context_t * context, FILE * file, ft_ssl_digest_t * digests, stats_input_t * stats) {
+
+    const int fd = fileno(file);
+    pipeline_t pipeline;
+    if (fd < 0 || !pipeline_start(&pipeline, fd, context->buffer_size))
+        return false;
+
+    for (;;) {
+        const pipeline_buffer_t * buffer = pipeline_acquire(&pipeline);
 
-    // Process all input in chunks
-    while ((read_bytes = fread(context->chunk, 1, CHUNK_SIZE_READ, file)) > 0) {
-        context->chunk_size = read_bytes;
-        context->message_size += read_bytes;
-        
         if (file == stdin && IS_OPTION_P(context->options))
-            write(1, context->chunk, read_bytes);
-        
-        // Apply padding if this is the final chunk
-        if (read_bytes < CHUNK_SIZE_READ) {
-            pad(context->chunk, &context->chunk_size, context->message_size);
-            padding_done = true;
-            update(context->chunk, context->chunk_size, context->hash);
-        } else {
-            // Process full chunks without padding
-            update(context->chunk, read_bytes, context->hash);
-            
-            // Check if we've reached EOF
-            int c = fgetc(file);
-            if (c == EOF) {
-                // Reset chunk for padding
-                context->chunk_size = 0;
-                pad(context->chunk, &context->chunk_size, context->message_size);
-                padding_done = true;
-                update(context->chunk, context->chunk_size, context->hash);
-            } else {
-                // Put the character back
-                ungetc(c, file);
-            }
+            output_write(buffer->data, buffer->size);
+        if (stats)
+            stats_read(stats);
+
+        // Every buffer but the last holds whole blocks, so nothing is copied before the end
+        process_update(context, digests, buffer->data, buffer->size);
+        if (stats)
+            stats_update(stats);
+
+        const bool eof = buffer->eof;
+        pipeline_release(&pipeline);
+        if (eof)
+            break;
+    }
+
+    pipeline_stop(&pipeline);
+    return true;
+}
+
+/// @brief Echo stdin to stdout with tee(2) when both are pipes, reading the same bytes once more to hash them
+/// @return false if the pipes could not be used, or stopped working (the rest is left to process_stream)
+/// @details The echo never goes through user space: tee only references the pages of the stdin pipe in the
+///          stdout pipe, then a read consumes them. Both pipes are grown first to move larger segments.
+static bool process_teed(ft_ssl_context_t * context, ft_ssl_digest_t * digests, stats_input_t * stats) {
+
+    struct stat in_st;
+    struct stat out_st;
+    if (fstat(STDIN_FILENO, &in_st) == -1 || fstat(STDOUT_FILENO, &out_st) == -1 || !S_ISFIFO(in_st.st_mode) || !S_ISFIFO(out_st.st_mode))
+        return false;
+
+    fcntl(STDIN_FILENO, F_SETPIPE_SZ, ECHO_PIPE_SIZE);
+    fcntl(STDOUT_FILENO, F_SETPIPE_SZ, ECHO_PIPE_SIZE);
+    const int pipe_size = fcntl(STDIN_FILENO, F_GETPIPE_SZ);
+    const size_t segment_size = pipe_size > 0 ? (size_t)pipe_size : CHUNK_SIZE_READ;
+    uint8_t * segment = malloc(segment_size);
+    if (!segment)
+        return false;
+
+    // The opening of the -p line must come out before the echo
+    output_flush();
+
+    bool eof = false;
+    while (!eof) {
+        const ssize_t teed = tee(STDIN_FILENO, STDOUT_FILENO, segment_size, 0);
+        if (teed == -1 && errno == EINTR)
+            continue;
+        if (teed <= 0) {
+            eof = teed == 0;
+            break;
         }
+
+        // The teed bytes are in the pipe already: the reads cannot block
+        size_t size = 0;
+        while (size < (size_t)teed) {
+            const ssize_t read_size = read(STDIN_FILENO, segment + size, (size_t)teed - size);
+            if (read_size == -1 && errno == EINTR)
+                continue;
+            if (read_size <= 0)
+                break;
+            size += (size_t)read_size;
+        }
+        if (stats)
+            stats_read(stats);
+
+        process_update(context, digests, segment, size);
+        if (stats)
+            stats_update(stats);
+        if (size < (size_t)teed)
+            break;
+    }
+
+    free(segment);
+    return eof;
+}
+
+/// @brief Hash any stream by reading it chunk by chunk
+static void process_stream(ft_ssl_context_t * context, FILE * file, ft_ssl_digest_t * digests, stats_input_t * stats) {
+
+    size_t read_bytes;
+    while ((read_bytes = fread(context->chunk, 1, CHUNK_SIZE_READ, file)) > 0) {
+        if (file == stdin && IS_OPTION_P(context->options))
+            output_write(context->chunk, read_bytes);
+        if (stats)
+            stats_read(stats);
+        process_update(context, digests, context->chunk, read_bytes);
+        if (stats)
+            stats_update(stats);
+    }
+}
+
+/// @brief Skip the part of the file argument covered by the --resume midstate
+static void process_resume(ft_ssl_context_t * context, FILE * file, ft_ssl_digest_t * digest) {
+
+    const ft_ssl_algorithm_t * algorithm = context->entry.data;
+    struct stat st;
+
+    // An append-only file can only have grown since the checkpoint
+    if (fstat(fileno(file), &st) == -1 || !S_ISREG(st.st_mode) || (size_t)st.st_size < context->resume_offset
+        || fseeko(file, (off_t)context->resume_offset, SEEK_SET) == -1) {
+        fprintf(stderr, "ft_ssl: %s: %s: cannot resume at byte %zu\n", algorithm->lower_name, context->filename, context->resume_offset);
+        exit(EXIT_FAILURE);
     }
 
-    // Handle empty files or final padding for files where we didn't hit EOF within the read
-    if (!padding_done) {
-        context->chunk_size = 0;
-        pad(context->chunk, &context->chunk_size, context->message_size);
-        update(context->chunk, context->chunk_size, context->hash);
+    ft_ssl_digest_resume(digest, algorithm, context->resume_hash, context->resume_offset);
+}
+
+void process_input(ft_ssl_context_t * context, FILE * file) {
+
+    // Only measured with --stats, a NULL check per read otherwise
+    stats_input_t stats_input;
+    stats_input_t * stats = context->stats ? &stats_input : NULL;
+    if (stats)
+        stats_input_start(stats);
+
+    // A digest per algorithm, all fed from the same reads
+    ft_ssl_digest_t digests[FT_SSL_MAX_ALGORITHMS];
+    ft_ssl_digest_t * digest = &digests[0];
+    process_digests_init(context, digests);
+    if (context->filename && IS_OPTION_RESUME(context->options))
+        process_resume(context, file, digest);
+    const size_t start_offset = digest->message_size;
+
+    if (file == stdin && IS_OPTION_P(context->options) && !IS_OPTION_Q(context->options))
+        output_write("(\"", 2);
+
+    if (file == stdin && IS_OPTION_P(context->options)) {
+        if (!process_teed(context, digests, stats))
+            process_stream(context, file, digests, stats);
+    } else if (IS_OPTION_PIPELINE(context->options)) {
+        if (!process_pipelined(context, file, digests, stats))
+            process_stream(context, file, digests, stats);
+    } else if (!process_mapped(context, file, digests, stats)) {
+        process_stream(context, file, digests, stats);
     }
 
     if (file == stdin && IS_OPTION_P(context->options) && !IS_OPTION_Q(context->options))
-        write(1, "\")= ", 4);
-}
\ No newline at end of file
+        output_write("\")= ", 4);
+
+    // The midstate after the last full block, before padding
+    if (context->filename && context->checkpoint
+        && !checkpoint_save(context->checkpoint, digest->algorithm, digest->hash, digest->message_size - digest->block_size))
+        fprintf(stderr, "ft_ssl: %s: %s\n", context->checkpoint, strerror(errno));
+
+    const size_t message_size = digest->message_size;
+    process_digests_final(context, digests);
+    context->message_size = message_size;
+
+    if (stats) {
+        stats_update(stats);
+        stats_input_end(context->stats, stats, context->filename ? context->filename : "stdin", message_size - start_offset);
+    }
+}
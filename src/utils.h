@@ -4,15 +4,68 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <sys/types.h>
 #include <unistd.h>
 
+/// @brief Read-only mapping of the rest of a regular file
+typedef struct {
+    void * map;           ///< Start of the mapping (NULL for an empty file)
+    size_t map_size;      ///< Size of the mapping
+    const uint8_t * data; ///< First byte not yet read from the stream
+    size_t size;          ///< Number of bytes left in the file
+    off_t offset;         ///< File offset of `data`
+    size_t slot;          ///< Entry of the mapping in the table of the SIGBUS handler
+} ft_ssl_mapping_t;
+
+/// @brief Size of the buffer of ft_ssl_format_name
+#define FT_SSL_NAME_SIZE 64
+
+/// @brief Name that starts a digest line: "SHA256", "HMAC-SHA256" with a key, "SHA256-TREE-4M" for a tree hash
+///        (with the leaf size, in the largest K, M or G unit that divides it, as --leaf-size reads it)
+void ft_ssl_format_name(const ft_ssl_context_t * context, const ft_ssl_algorithm_t * algorithm, char name[FT_SSL_NAME_SIZE]);
+
 /// @brief Print hash result with appropriate formatting based on context options
 void ft_ssl_print(ft_ssl_context_t * context, FILE * file);
 
+/// @brief Parse the hex digest printed by ft_ssl_print (exactly 8 digits per word)
+/// @return false if one of the word_count * 8 characters is not a hex digit
+bool ft_ssl_parse_hash(const char * hex, size_t word_count, uint32_t * words);
+
+/// @brief Print the error line for a file that could not be hashed
+void ft_ssl_print_error(ft_ssl_context_t * context, const char * filename, int error);
+
+/// @brief Print the result of a job: its hash, or its error line
+void ft_ssl_print_job(ft_ssl_context_t * context, ft_ssl_job_t * job);
+
+/// @brief Hash the file of a job (or set its error), using the cache if there is one
+void ft_ssl_hash_job(ft_ssl_context_t * context, ft_ssl_job_t * job);
+
+/// @brief Hash every job of a source (through io_uring with --io-uring if the kernel has it,
+///        or with the multi-buffer engine if `many` and the algorithm has one)
+void ft_ssl_hash_jobs(ft_ssl_context_t * context, ft_ssl_job_source_t * source, bool many);
+
+/// @brief Hash a stream with the algorithm of the context (tree hash if enabled), leaving the result in context->hash
+void ft_ssl_hash(ft_ssl_context_t * context, FILE * file);
+
+/// @brief Hash a NUL-terminated string (the -s argument), leaving the result in context->hash
+void ft_ssl_hash_string(ft_ssl_context_t * context, const char * message);
+
+/// @brief Map the rest of a regular file of at least `min_size` bytes
+/// @details A page past the end of a file truncated while it is mapped reads as zeros instead of raising SIGBUS:
+///          check ft_ssl_map_intact before trusting what was read from the mapping
+/// @return false for other inputs (pipes, memory streams...) or if the mapping failed
+bool ft_ssl_map(FILE * file, size_t min_size, ft_ssl_mapping_t * mapping);
+
+/// @brief Whether no page of this mapping has read as zeros past the end of its truncated file
+/// @note Only this mapping is checked: the truncation of a file mapped by another thread does not affect it
+bool ft_ssl_map_intact(const ft_ssl_mapping_t * mapping);
+
+/// @brief Release a mapping and move the stream past the mapped bytes, or back to the first one if the mapping
+///        is not intact, so that the file can be read again
+void ft_ssl_unmap(FILE * file, ft_ssl_mapping_t * mapping);
+
+/// @brief Write the whole buffer, even if the output (a pipe) takes it in several parts
+void write_all(int fd, const uint8_t * data, size_t size);
+
 /// @brief Process input data and compute hash
-void process_input(
-    ft_ssl_context_t * context,
-    FILE * file,
-    void (*pad)(uint8_t *, size_t *, size_t),
-    void (*update)(uint8_t *, size_t, uint32_t *)
-);
\ No newline at end of file
+void process_input(ft_ssl_context_t * context, FILE * file);
\ No newline at end of file
@@ -0,0 +1,273 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fnmatch.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "pool.h"
+#include "utils.h"
+#include "walk.h"
+
+static void * walk_alloc(void * ptr, size_t size) {
+    ptr = realloc(ptr, size);
+    if (!ptr) {
+        perror("realloc");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+static char * walk_join(const char * dir, const char * name) {
+    const size_t dir_size = strlen(dir);
+    const size_t name_size = strlen(name);
+    const bool slash = dir_size && dir[dir_size - 1] != '/';
+    char * path = walk_alloc(NULL, dir_size + slash + name_size + 1);
+    memcpy(path, dir, dir_size);
+    if (slash)
+        path[dir_size] = '/';
+    memcpy(path + dir_size + slash, name, name_size + 1);
+    return path;
+}
+
+static char * walk_strdup(const char * str) {
+    return walk_join("", str);
+}
+
+static int walk_compare(const void * a, const void * b) {
+    return strcmp(((const walk_entry_t *)a)->name, ((const walk_entry_t *)b)->name);
+}
+
+/// @brief A glob with a slash matches the whole path, otherwise the name
+static bool walk_match(char * const * globs, size_t count, const char * name, const char * path) {
+    for (size_t i = 0; i < count; i++)
+        if (fnmatch(globs[i], strchr(globs[i], '/') ? path : name, 0) == 0)
+            return true;
+    return false;
+}
+
+/// @brief Read and sort a directory, and push it on the stack
+/// @return 0, or the errno value if the directory could not be read
+static int walk_push(walk_t * walk, const char * path, const struct stat * st) {
+
+    DIR * dir = opendir(path);
+    if (!dir)
+        return errno;
+
+    walk_entry_t * entries = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+
+    struct dirent * dirent;
+    errno = 0;
+    while ((dirent = readdir(dir))) {
+        if (strcmp(dirent->d_name, ".") == 0 || strcmp(dirent->d_name, "..") == 0)
+            continue;
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            entries = walk_alloc(entries, capacity * sizeof(walk_entry_t));
+        }
+        entries[count].name = walk_strdup(dirent->d_name);
+        entries[count].type = dirent->d_type;
+        count++;
+    }
+    const int error = errno;
+    closedir(dir);
+
+    if (error) {
+        for (size_t i = 0; i < count; i++)
+            free(entries[i].name);
+        free(entries);
+        return error;
+    }
+
+    qsort(entries, count, sizeof(walk_entry_t), walk_compare);
+
+    if (walk->depth == walk->capacity) {
+        walk->capacity = walk->capacity ? walk->capacity * 2 : 16;
+        walk->dirs = walk_alloc(walk->dirs, walk->capacity * sizeof(walk_dir_t));
+    }
+    walk->dirs[walk->depth++] = (walk_dir_t){walk_strdup(path), entries, count, 0, st->st_dev, st->st_ino};
+    return 0;
+}
+
+static void walk_pop(walk_t * walk) {
+    walk_dir_t * dir = &walk->dirs[--walk->depth];
+    for (size_t i = dir->next; i < dir->count; i++)
+        free(dir->entries[i].name);
+    free(dir->entries);
+    free(dir->path);
+}
+
+/// @brief The directory is already on the stack (a symlink loop)
+static bool walk_is_ancestor(const walk_t * walk, const struct stat * st) {
+    for (size_t i = 0; i < walk->depth; i++)
+        if (walk->dirs[i].dev == st->st_dev && walk->dirs[i].ino == st->st_ino)
+            return true;
+    return false;
+}
+
+void walk_start(walk_t * walk, const ft_ssl_context_t * context, char ** roots, size_t root_count) {
+    memset(walk, 0, sizeof(walk_t));
+    walk->context = context;
+    walk->roots = roots;
+    walk->root_count = root_count;
+}
+
+bool walk_next(walk_t * walk, char ** path, int * error) {
+
+    const ft_ssl_context_t * context = walk->context;
+    *error = 0;
+
+    for (;;) {
+
+        // File arguments are always hashed, directories are walked
+        if (walk->depth == 0) {
+            if (walk->next_root == walk->root_count)
+                return false;
+            *path = walk_strdup(walk->roots[walk->next_root++]);
+            struct stat st;
+            if (stat(*path, &st) == -1) {
+                *error = errno;
+                return true;
+            }
+            if (!S_ISDIR(st.st_mode))
+                return true;
+            walk->root_dev = st.st_dev;
+            *error = walk_push(walk, *path, &st);
+            if (*error)
+                return true;
+            free(*path);
+            continue;
+        }
+
+        walk_dir_t * dir = &walk->dirs[walk->depth - 1];
+        if (dir->next == dir->count) {
+            walk_pop(walk);
+            continue;
+        }
+
+        // The entry is consumed here (walk_pop only frees the names not visited yet)
+        walk_entry_t * entry = &dir->entries[dir->next++];
+        char * name = entry->name;
+        unsigned char type = entry->type;
+        const bool is_link = type == DT_LNK;
+        *path = walk_join(dir->path, name);
+        const bool excluded = walk_match(context->exclude_globs, context->exclude_count, name, *path);
+        const bool skipped = excluded || (is_link && !IS_OPTION_FOLLOW(context->options));
+
+        // Regular files need no stat, the readdir type is enough
+        struct stat st;
+        if (!skipped && (type == DT_UNKNOWN || type == DT_DIR || is_link)) {
+            const bool follow = is_link || (type == DT_UNKNOWN && IS_OPTION_FOLLOW(context->options));
+            if ((follow ? stat(*path, &st) : lstat(*path, &st)) == -1) {
+                *error = errno;
+                free(name);
+                return true;
+            }
+            type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+        }
+
+        if (!skipped && type == DT_DIR) {
+            // Stay on the device of the file argument, and do not loop through symlinks
+            const bool other_fs = IS_OPTION_ONE_FILESYSTEM(context->options) && st.st_dev != walk->root_dev;
+            if (!other_fs && !walk_is_ancestor(walk, &st))
+                *error = walk_push(walk, *path, &st);
+            if (*error) {
+                free(name);
+                return true;
+            }
+        } else if (!skipped && type == DT_REG
+                   && (!context->include_count || walk_match(context->include_globs, context->include_count, name, *path))) {
+            free(name);
+            return true;
+        }
+
+        // Directories, filtered out files, and anything but regular files
+        free(name);
+        free(*path);
+    }
+}
+
+void walk_stop(walk_t * walk) {
+    while (walk->depth)
+        walk_pop(walk);
+    free(walk->dirs);
+}
+
+/// @brief Main loop of the pool workers
+static void walk_worker(pool_worker_t * worker) {
+    ft_ssl_job_source_t source = pool_source(worker);
+    ft_ssl_hash_jobs(&worker->context, &source, false);
+}
+
+void walk_hash(ft_ssl_context_t * context, char ** roots, size_t root_count) {
+
+    walk_t walk;
+    walk_start(&walk, context, roots, root_count);
+
+    // A ring of the files in flight: the walk runs ahead while the oldest ones are hashed
+    // (with io_uring, far enough ahead to keep every queue full)
+    const bool uring = IS_OPTION_URING(context->options);
+    const size_t per_worker = uring && 2 * context->queue_depth > WALK_JOBS_PER_WORKER ? 2 * context->queue_depth : WALK_JOBS_PER_WORKER;
+    const size_t window = context->worker_count * per_worker;
+    ft_ssl_job_t * jobs = calloc(window, sizeof(ft_ssl_job_t));
+    const size_t other_count = context->algorithm_count - 1;
+    uint32_t (*other_hashes)[FT_SSL_MAX_STATE_WORDS] = other_count ? calloc(window * other_count, sizeof(*other_hashes)) : NULL;
+    if (!jobs || (other_count && !other_hashes)) {
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+
+    // The io_uring engine takes its files from a worker, even a single one, while this thread walks and prints
+    pool_t pool;
+    const bool parallel = context->worker_count > 1 || uring;
+    if (parallel)
+        pool_start(&pool, context->worker_count, context, walk_worker);
+
+    size_t head = 0;
+    size_t in_flight = 0;
+    bool walking = true;
+
+    for (;;) {
+
+        while (walking && in_flight < window) {
+            const size_t slot = (head + in_flight) % window;
+            ft_ssl_job_t * job = &jobs[slot];
+            memset(job, 0, sizeof(ft_ssl_job_t));
+            if (other_hashes)
+                job->other_hashes = other_hashes + slot * other_count;
+            walking = walk_next(&walk, &job->filename, &job->error);
+            if (!walking)
+                break;
+            in_flight++;
+
+            // Paths that could not be walked are printed as errors, in order
+            if (job->error)
+                job->done = true;
+            else if (parallel)
+                pool_submit(&pool, job);
+            else
+                ft_ssl_hash_job(context, job);
+        }
+
+        if (in_flight == 0)
+            break;
+
+        ft_ssl_job_t * job = &jobs[head];
+        if (parallel)
+            pool_wait(&pool, job);
+        ft_ssl_print_job(context, job);
+        free(job->filename);
+        head = (head + 1) % window;
+        in_flight--;
+    }
+
+    if (parallel)
+        pool_stop(&pool);
+    walk_stop(&walk);
+    free(other_hashes);
+    free(jobs);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdbool.h>   // for bool
+#include <stddef.h>    // for size_t
+#include <sys/types.h> // for dev_t, ino_t
+
+#include "ft_ssl.h" // for ft_ssl_context_t
+
+/// @brief Files in flight per worker while hashing a tree (bounds how far the walk runs ahead)
+#define WALK_JOBS_PER_WORKER 64
+
+/// @brief A directory entry, as listed by readdir
+typedef struct {
+    char * name;        ///< Entry name
+    unsigned char type; ///< d_type (DT_UNKNOWN if the filesystem does not tell)
+} walk_entry_t;
+
+/// @brief A directory being walked, with its entries sorted by name
+typedef struct {
+    char * path;            ///< Path of the directory
+    walk_entry_t * entries; ///< Sorted entries
+    size_t count;           ///< Number of entries
+    size_t next;            ///< Next entry to visit
+    dev_t dev;              ///< Device of the directory (to detect symlink loops)
+    ino_t ino;              ///< Inode of the directory
+} walk_dir_t;
+
+/// @brief Depth-first walk of the file arguments, in a deterministic order
+typedef struct {
+    const ft_ssl_context_t * context; ///< Walk options and globs
+    char ** roots;                    ///< File arguments
+    size_t root_count;                ///< Number of file arguments
+    size_t next_root;                 ///< Next file argument to walk
+    walk_dir_t * dirs;                ///< Stack of open directories
+    size_t depth;                     ///< Number of directories in the stack
+    size_t capacity;                  ///< Capacity of the stack
+    dev_t root_dev;                   ///< Device of the current file argument (for --one-file-system)
+} walk_t;
+
+/// @brief Start walking the file arguments
+void walk_start(walk_t * walk, const ft_ssl_context_t * context, char ** roots, size_t root_count);
+
+/// @brief Next regular file of the walk: file arguments in order, directory entries sorted by name
+/// @param path Set to the path (to free), also when it could not be walked
+/// @param error Set to the errno value if the path could not be walked, 0 otherwise
+/// @return false once the walk is over
+bool walk_next(walk_t * walk, char ** path, int * error);
+
+/// @brief Free the directories left on the stack
+void walk_stop(walk_t * walk);
+
+/// @brief Hash every regular file under the file arguments on context->worker_count threads, printing in walk order
+void walk_hash(ft_ssl_context_t * context, char ** roots, size_t root_count);
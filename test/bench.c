@@ -0,0 +1,283 @@
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "digest.h"
+#include "ft_ssl.h"
+#include "md5.h"
+#include "output.h"
+#include "sha256.h"
+#include "utils.h"
+
+/// @brief Default number of timed repetitions of each benchmark
+#define BENCH_REPETITIONS 21
+
+/// @brief Minimum time of one repetition, in seconds (the batch of calls grows until it is reached)
+#define BENCH_MIN_TIME 0.005
+
+/// @brief Default regression threshold, in percent of the baseline median
+#define BENCH_THRESHOLD 10.0
+
+/// @brief Bytes hashed per call by the update benchmarks
+#define BENCH_UPDATE_SIZE (16 * 1024)
+
+/// @brief Message tail padded by the pad benchmarks (the longest tail that pads to a single block)
+#define BENCH_PAD_TAIL 55
+
+/// @brief Longest benchmark name
+#define BENCH_NAME_SIZE 32
+
+/// @brief Inputs shared by the benchmarks
+typedef struct {
+    uint8_t data[BENCH_UPDATE_SIZE];  ///< Message for the update benchmarks
+    uint8_t chunk[CHUNK_SIZE_TOTAL];  ///< Tail for the pad benchmarks
+    uint32_t hash[8];                 ///< State, kept live across calls
+    ft_ssl_context_t context;         ///< Digest and filename for ft_ssl_print
+} bench_state_t;
+
+/// @brief A function under test, called `count` times in a row
+typedef struct {
+    const char * name;                               ///< Benchmark name, as in the JSON output
+    size_t bytes_per_op;                             ///< Bytes processed per call, 0 if throughput is meaningless
+    void (*run)(bench_state_t * state, uint64_t count);
+} bench_t;
+
+/// @brief Statistics of one benchmark, in calls per second
+typedef struct {
+    const bench_t * bench;
+    double median;
+    double p10;
+    double p90;
+    double min;
+    double max;
+} bench_result_t;
+
+static void bench_md5_update(bench_state_t * state, uint64_t count) {
+    for (uint64_t i = 0; i < count; i++)
+        md5_update(state->data, BENCH_UPDATE_SIZE, state->hash);
+}
+
+static void bench_sha256_update(bench_state_t * state, uint64_t count) {
+    for (uint64_t i = 0; i < count; i++)
+        sha256_update(state->data, BENCH_UPDATE_SIZE, state->hash);
+}
+
+static void bench_md5_pad(bench_state_t * state, uint64_t count) {
+    for (uint64_t i = 0; i < count; i++) {
+        size_t chunk_size = BENCH_PAD_TAIL;
+        md5_pad(state->chunk, &chunk_size, BENCH_PAD_TAIL + i);
+        __asm__ volatile("" : : "r"(state->chunk) : "memory");
+    }
+}
+
+static void bench_sha256_pad(bench_state_t * state, uint64_t count) {
+    for (uint64_t i = 0; i < count; i++) {
+        size_t chunk_size = BENCH_PAD_TAIL;
+        sha256_pad(state->chunk, &chunk_size, BENCH_PAD_TAIL + i);
+        __asm__ volatile("" : : "r"(state->chunk) : "memory");
+    }
+}
+
+/// @brief Formatting into the 1 MiB standard output buffer, with a write to /dev/null each time it fills up
+static void bench_ft_ssl_print(bench_state_t * state, uint64_t count) {
+    for (uint64_t i = 0; i < count; i++)
+        ft_ssl_print(&state->context, NULL);
+}
+
+static const bench_t benches[] = {
+    {"md5_update", BENCH_UPDATE_SIZE, bench_md5_update},
+    {"sha256_update", BENCH_UPDATE_SIZE, bench_sha256_update},
+    {"md5_pad", 0, bench_md5_pad},
+    {"sha256_pad", 0, bench_sha256_pad},
+    {"ft_ssl_print", 0, bench_ft_ssl_print},
+};
+
+#define BENCH_COUNT (sizeof(benches) / sizeof(benches[0]))
+
+static void bench_usage(const char * prog_name) {
+    fprintf(stderr, "Usage: %s [-n repetitions] [-o output] [-b baseline] [-t threshold]\n", prog_name);
+    fprintf(stderr, "  -n repetitions  timed repetitions of each benchmark (default %d)\n", BENCH_REPETITIONS);
+    fprintf(stderr, "  -o output       write the JSON report to output instead of stdout\n");
+    fprintf(stderr, "  -b baseline     compare the medians to a previous report\n");
+    fprintf(stderr, "  -t threshold    fail when a median drops by more than threshold percent (default %.0f)\n", BENCH_THRESHOLD);
+}
+
+static double bench_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+static int bench_compare(const void * a, const void * b) {
+    const double x = *(const double *)a;
+    const double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/// @brief Nearest-rank percentile of sorted values
+static double bench_percentile(const double * sorted, size_t count, double percent) {
+    size_t rank = (size_t)(percent / 100.0 * (double)count + 0.5);
+    if (rank > 0)
+        rank--;
+    return sorted[rank < count ? rank : count - 1];
+}
+
+/// @brief Time `repetitions` batches of calls, after growing the batch to BENCH_MIN_TIME (which also warms up)
+static bench_result_t bench_run(const bench_t * bench, bench_state_t * state, size_t repetitions, double * samples) {
+
+    uint64_t batch = 1;
+    for (;;) {
+        const double start = bench_now();
+        bench->run(state, batch);
+        if (bench_now() - start >= BENCH_MIN_TIME)
+            break;
+        batch *= 2;
+    }
+
+    for (size_t i = 0; i < repetitions; i++) {
+        const double start = bench_now();
+        bench->run(state, batch);
+        samples[i] = (double)batch / (bench_now() - start);
+    }
+
+    qsort(samples, repetitions, sizeof(double), bench_compare);
+    return (bench_result_t){bench, bench_percentile(samples, repetitions, 50), bench_percentile(samples, repetitions, 10),
+                            bench_percentile(samples, repetitions, 90), samples[0], samples[repetitions - 1]};
+}
+
+static void bench_print(FILE * output, const bench_result_t * results, size_t repetitions) {
+
+    fprintf(output, "{\n  \"repetitions\": %zu,\n  \"output_buffer_bytes\": %d,\n  \"benchmarks\": [\n", repetitions, OUTPUT_BUFFER_SIZE);
+    for (size_t i = 0; i < BENCH_COUNT; i++) {
+        const bench_result_t * result = &results[i];
+        fprintf(output, "    {\"name\": \"%s\", \"bytes_per_op\": %zu, \"median_ops_per_s\": %.1f, \"p10_ops_per_s\": %.1f, "
+                        "\"p90_ops_per_s\": %.1f, \"min_ops_per_s\": %.1f, \"max_ops_per_s\": %.1f, \"median_ns_per_op\": %.3f, \"median_mb_per_s\": %.3f}%s\n",
+                result->bench->name, result->bench->bytes_per_op, result->median, result->p10, result->p90, result->min, result->max,
+                1e9 / result->median, result->median * (double)result->bench->bytes_per_op / 1e6, i + 1 < BENCH_COUNT ? "," : "");
+    }
+    fprintf(output, "  ]\n}\n");
+}
+
+/// @brief Compare the medians to a report written by bench_print (one benchmark per line)
+/// @return false if a benchmark regressed past the threshold, or the baseline could not be read
+static bool bench_check(const char * path, const bench_result_t * results, double threshold) {
+
+    FILE * baseline = fopen(path, "r");
+    if (!baseline) {
+        perror(path);
+        return false;
+    }
+
+    bool ok = true;
+    char * line = NULL;
+    size_t line_capacity = 0;
+    while (getline(&line, &line_capacity, baseline) != -1) {
+
+        char name[BENCH_NAME_SIZE];
+        double median;
+        const char * fields = strstr(line, "\"name\": \"");
+        const char * median_field = strstr(line, "\"median_ops_per_s\": ");
+        if (!fields || !median_field || sscanf(fields, "\"name\": \"%31[^\"]\"", name) != 1
+            || sscanf(median_field, "\"median_ops_per_s\": %lf", &median) != 1 || median <= 0)
+            continue;
+
+        // Benchmarks missing from either side are not compared
+        for (size_t i = 0; i < BENCH_COUNT; i++) {
+            if (strcmp(results[i].bench->name, name) != 0)
+                continue;
+            const double change = (results[i].median / median - 1) * 100;
+            const bool regressed = change < -threshold;
+            fprintf(stderr, "%-16s %+7.1f%% %s\n", name, change, regressed ? "REGRESSION" : "ok");
+            ok = ok && !regressed;
+        }
+    }
+
+    free(line);
+    fclose(baseline);
+    return ok;
+}
+
+int main(int ac, char ** av) {
+
+    size_t repetitions = BENCH_REPETITIONS;
+    const char * output_path = NULL;
+    const char * baseline_path = NULL;
+    double threshold = BENCH_THRESHOLD;
+
+    int opt;
+    while ((opt = getopt(ac, av, "n:o:b:t:")) != -1) {
+        switch (opt) {
+            case 'n': {
+                const long value = atol(optarg);
+                if (value < 1 || value > 10000) {
+                    bench_usage(av[0]);
+                    return EXIT_FAILURE;
+                }
+                repetitions = (size_t)value;
+                break;
+            }
+            case 'o': output_path = optarg; break;
+            case 'b': baseline_path = optarg; break;
+            case 't': threshold = atof(optarg); break;
+            default:
+                bench_usage(av[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    bench_state_t * state = calloc(1, sizeof(bench_state_t));
+    double * samples = calloc(repetitions, sizeof(double));
+    if (!state || !samples) {
+        perror("calloc");
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < BENCH_UPDATE_SIZE; i++)
+        state->data[i] = (uint8_t)(i * 131 + 7);
+    memcpy(state->chunk, state->data, BENCH_PAD_TAIL);
+    sha256_init(state->hash);
+    static char filename[] = "input/file.txt";
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wcast-qual"
+    state->context.entry.data = (ft_ssl_algorithm_t *)&ft_ssl_algorithms[0];
+    #pragma GCC diagnostic pop
+    state->context.filename = filename;
+
+    // ft_ssl_print writes to the output buffer of stdout: send it to /dev/null
+    const int saved_stdout = dup(STDOUT_FILENO);
+    const int null_fd = open("/dev/null", O_WRONLY);
+    if (saved_stdout == -1 || null_fd == -1) {
+        perror("/dev/null");
+        return EXIT_FAILURE;
+    }
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+
+    bench_result_t results[BENCH_COUNT];
+    for (size_t i = 0; i < BENCH_COUNT; i++)
+        results[i] = bench_run(&benches[i], state, repetitions, samples);
+
+    output_flush();
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+
+    FILE * output = output_path ? fopen(output_path, "w") : stdout;
+    if (!output) {
+        perror(output_path);
+        return EXIT_FAILURE;
+    }
+    bench_print(output, results, repetitions);
+    if (output != stdout)
+        fclose(output);
+
+    const bool ok = !baseline_path || bench_check(baseline_path, results, threshold);
+
+    free(samples);
+    free(state);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,895 @@
+import hashlib
+import hmac
+import json
+import os
+import pytest
+import random
+import signal
+import socket
+import struct
+import subprocess
+import time
+from tester import FtSslLibrary, FtSslTester
+
+
+@pytest.fixture
+def test_files(tester: FtSslTester):
+    """Create a set of files around the block boundaries and clean up afterward."""
+    files = tester.generate_test_files()
+    yield files
+    for file_path in files:
+        if os.path.exists(file_path):
+            os.remove(file_path)
+
+
+class TestParallelFiles:
+    """Tests for hashing file arguments on several threads (-j)."""
+
+    def test_jobs_keep_argument_order(self, tester: FtSslTester, test_files):
+        """Test that -j prints the same lines, in the same order, as a single worker."""
+        files = " ".join(test_files + ["missing_file"] + test_files[:3])
+        expected = tester.run_command(f"{tester.ft_ssl_path} {tester.algorithm} -j 1 {files}")
+        for jobs in [2, 3, 8]:
+            actual = tester.run_command(f"{tester.ft_ssl_path} {tester.algorithm} -j {jobs} {files}")
+            assert actual == expected, f"-j {jobs} output differs from -j 1"
+
+    def test_jobs_match_openssl(self, tester: FtSslTester, test_files):
+        """Test that every hash computed in parallel matches openssl."""
+        output = tester.run_command(f"{tester.ft_ssl_path} {tester.algorithm} -r -j 4 {' '.join(test_files)}")
+        for line, file_path in zip(output.split('\n'), test_files):
+            expected = tester.run_command(f"openssl {tester.algorithm} -r {file_path} | cut -d ' ' -f1")
+            assert line == f"{expected} *{file_path}", f"Hash mismatch for {file_path}"
+
+    def test_jobs_missing_file(self, tester: FtSslTester):
+        """Test that unopenable files keep their error line."""
+        actual = tester.run_command(f"{tester.ft_ssl_path} {tester.algorithm} -j 2 missing_a missing_b")
+        expected = "\n".join(f"ft_ssl: {tester.algorithm}: {name}: No such file or directory" for name in ["missing_a", "missing_b"])
+        assert actual == expected, "Error lines differ"
+
+    def test_many_files_many_jobs(self, tester: FtSslTester, tmp_path):
+        """Test that many files on many more workers than CPUs always finish (workers outlive the ones joined first)."""
+        names = []
+        for i in range(300):
+            (tmp_path / f"f{i}").write_bytes(os.urandom(i * 7))
+            names.append(str(tmp_path / f"f{i}"))
+        expected = [hashlib.new(tester.algorithm, (tmp_path / f"f{i}").read_bytes()).hexdigest() for i in range(300)]
+        for _ in range(20):
+            for jobs in ["16", "64"]:
+                result = subprocess.run([tester.ft_ssl_path, tester.algorithm, "-q", "-j", jobs, *names], capture_output=True, text=True, timeout=20)
+                assert result.stdout.split() == expected
+
+    def test_invalid_jobs(self, tester: FtSslTester):
+        """Test that -j rejects non positive counts."""
+        for value in ["0", "-1", "abc"]:
+            exit_code, _, _ = tester.run_with_timeout(f"{tester.ft_ssl_path} {tester.algorithm} -j {value} file")
+            assert exit_code != 0, f"-j {value} should fail"
+
+
+class TestMapping:
+    """Tests for the large files hashed from a memory mapping."""
+
+    def test_file_truncated_while_hashed(self, tester: FtSslTester, tmp_path):
+        """Test that a file shrinking under its mapping hashes as what is left of it, without a SIGBUS."""
+        path = tmp_path / "shrinking"
+        for options in [[], ["--tree", "-j", "4"]]:
+            for delay in [0.01, 0.05, 0.2]:
+                path.write_bytes(os.urandom(1 << 20) * 512)
+                process = subprocess.Popen([tester.ft_ssl_path, tester.algorithm, "-q", *options, str(path)], stdout=subprocess.PIPE, text=True)
+                time.sleep(delay)
+                os.truncate(path, 1 << 20)
+                output, _ = process.communicate(timeout=60)
+                assert process.returncode == 0, f"Exit code {process.returncode} ({options}, {delay}s)"
+                expected = subprocess.run([tester.ft_ssl_path, tester.algorithm, "-q", *options, str(path)], capture_output=True, text=True).stdout
+                assert output == expected, f"The hash is not the one of the truncated file ({options}, {delay}s)"
+
+
+def tree_hash(algorithm: str, data: bytes, leaf_size: int) -> str:
+    """Reference tree hash: the hash of the concatenated leaf digests."""
+    leaves = [data[i:i + leaf_size] for i in range(0, len(data), leaf_size)] or [b""]
+    return hashlib.new(algorithm, b"".join(hashlib.new(algorithm, leaf).digest() for leaf in leaves)).hexdigest()
+
+
+class TestTreeHash:
+    """Tests for the tree hash mode (--tree)."""
+
+    def test_tree_matches_reference(self, tester: FtSslTester, test_files):
+        """Test the root hash of files and of stdin for several leaf sizes."""
+        for leaf_size in [1, 64, 100, 4096]:
+            for file_path in test_files:
+                with open(file_path, "rb") as file:
+                    expected = tree_hash(tester.algorithm, file.read(), leaf_size)
+                actual = tester.run_command(f"{tester.ft_ssl_path} {tester.algorithm} -q --tree --leaf-size {leaf_size} {file_path}")
+                assert actual == expected, f"Tree hash mismatch for {file_path} with {leaf_size} byte leaves"
+                actual = tester.run_command(f"cat {file_path} | {tester.ft_ssl_path} {tester.algorithm} -q --tree --leaf-size {leaf_size}")
+                assert actual == expected, f"Tree hash mismatch for piped {file_path} with {leaf_size} byte leaves"
+
+    def test_tree_independent_of_jobs(self, tester: FtSslTester, test_files):
+        """Test that the number of workers does not change the root hash."""
+        files = " ".join(test_files)
+        expected = tester.run_command(f"{tester.ft_ssl_path} {tester.algorithm} --tree --leaf-size 64 -j 1 {files}")
+        for jobs in [2, 8]:
+            actual = tester.run_command(f"{tester.ft_ssl_path} {tester.algorithm} --tree --leaf-size 64 -j {jobs} {files}")
+            assert actual == expected, f"-j {jobs} tree output differs from -j 1"
+
+    def test_tree_manifest(self, tester: FtSslTester, tmp_path):
+        """Test that the manifest lists the digest, offset and size of every leaf."""
+        data = bytes(range(256)) * 3
+        input_path = tmp_path / "input"
+        input_path.write_bytes(data)
+        manifest_path = tmp_path / "manifest"
+        tester.run_command(f"{tester.ft_ssl_path} {tester.algorithm} --tree --leaf-size 300 --manifest {manifest_path} {input_path}")
+        expected = [f"{hashlib.new(tester.algorithm, data[offset:offset + 300]).hexdigest()} {offset} {len(data[offset:offset + 300])} {input_path}"
+                    for offset in range(0, len(data), 300)]
+        assert manifest_path.read_text().splitlines() == expected, "Manifest lines differ"
+
+    def test_tree_label(self, tester: FtSslTester, test_files):
+        """Test that a root is labelled with its leaf size, so that it cannot pass for a digest of the file."""
+        name = tester.algorithm.upper()
+        for leaf_size, label in [("4096", "4K"), ("3000", "3000"), ("2M", "2M"), ("1048576K", "1G")]:
+            expected = tester.run_command(f"{tester.ft_ssl_path} {tester.algorithm} -q --tree --leaf-size {leaf_size} {test_files[0]}")
+            actual = tester.run_command(f"{tester.ft_ssl_path} {tester.algorithm} --tree --leaf-size {leaf_size} {test_files[0]}")
+            assert actual == f"{name}-TREE-{label}({test_files[0]})= {expected}", f"Unexpected root line with {leaf_size} byte leaves"
+
+    def test_tree_check(self, tester: FtSslTester, test_files, tmp_path):
+        """Test that -c verifies roots with --tree and their leaf size, and refuses them as plain digests or with another leaf size."""
+        files = " ".join(test_files)
+        manifest_path = tmp_path / "manifest"
+        manifest_path.write_text(tester.run_command(f"{tester.ft_ssl_path} {tester.algorithm} --tree --leaf-size 64 {files}") + "\n")
+        exit_code, output, _ = tester.run_with_timeout(f"{tester.ft_ssl_path} {tester.algorithm} -c --tree --leaf-size 64 {manifest_path}")
+        assert exit_code == 0, "Roots should verify with their leaf size"
+        assert output.strip().split("\n") == [f"{file_path}: OK" for file_path in test_files], "Unexpected results"
+        for options in ["", "--tree", "--tree --leaf-size 128"]:
+            exit_code, output, errors = tester.run_with_timeout(f"{tester.ft_ssl_path} {tester.algorithm} -c {options} {manifest_path}")
+            assert exit_code != 0 and output == "", f"Roots should not verify with '{options}'"
+            assert "another mode" in errors, f"The refusal with '{options}' should say why"
+
+
+class TestLibrary:
+    """Tests for the incremental API of libft_ssl.so."""
+
+    def test_chunked_updates(self, tester: FtSslTester):
+        """Test that splitting the message anywhere does not change the digest."""
+        library = FtSslLibrary()
+        rng = random.Random(42)
+        for size in [0, 1, 55, 56, 63, 64, 65, 127, 128, 1000, 100000]:
+            data = rng.randbytes(size)
+            expected = hashlib.new(tester.algorithm, data).hexdigest()
+            assert library.hexdigest(tester.algorithm, [data]) == expected, f"Digest mismatch for {size} bytes"
+            cuts = sorted(rng.randrange(size + 1) for _ in range(8))
+            chunks = [data[start:end] for start, end in zip([0] + cuts, cuts + [size])]
+            assert library.hexdigest(tester.algorithm, chunks) == expected, f"Chunked digest mismatch for {size} bytes"
+
+    def test_unknown_algorithm(self, tester: FtSslTester):
+        """Test that an unknown algorithm name is rejected."""
+        with pytest.raises(ValueError):
+            FtSslLibrary().hexdigest("md4", [b""])
+
+
+class TestCheckpoint:
+    """Tests for resuming the hash of an append-only file (--checkpoint, --resume)."""
+
+    def test_resume_after_append(self, tester: FtSslTester, tmp_path):
+        """Test that resuming from a checkpoint gives the hash of the whole grown file."""
+        log_path = tmp_path / "log"
+        checkpoint_path = tmp_path / "checkpoint"
+        data = os.urandom(200003)
+        log_path.write_bytes(data)
+        tester.run_command(f"{tester.ft_ssl_path} {tester.algorithm} -q --checkpoint {checkpoint_path} {log_path}")
+        for appended in [os.urandom(70001), b"", os.urandom(5)]:
+            data += appended
+            with open(log_path, "ab") as log:
+                log.write(appended)
+            for options in ["", "--pipeline --buffer-size 4K"]:
+                actual = tester.run_command(f"{tester.ft_ssl_path} {tester.algorithm} -q {options} --resume {checkpoint_path} {log_path}")
+                assert actual == hashlib.new(tester.algorithm, data).hexdigest(), f"Resumed hash mismatch ({options or 'default'})"
+            tester.run_command(f"{tester.ft_ssl_path} {tester.algorithm} -q --resume {checkpoint_path} --checkpoint {checkpoint_path} {log_path}")
+
+    def test_resume_rejects_shorter_file(self, tester: FtSslTester, tmp_path):
+        """Test that a file shorter than the checkpoint offset is an error."""
+        log_path = tmp_path / "log"
+        checkpoint_path = tmp_path / "checkpoint"
+        log_path.write_bytes(os.urandom(4096))
+        tester.run_command(f"{tester.ft_ssl_path} {tester.algorithm} --checkpoint {checkpoint_path} {log_path}")
+        log_path.write_bytes(os.urandom(100))
+        exit_code, _, _ = tester.run_with_timeout(f"{tester.ft_ssl_path} {tester.algorithm} --resume {checkpoint_path} {log_path}")
+        assert exit_code != 0, "Resuming past the end of the file should fail"
+
+    def test_checkpoint_needs_single_file(self, tester: FtSslTester, tmp_path):
+        """Test that a checkpoint is refused for several inputs."""
+        exit_code, _, _ = tester.run_with_timeout(f"{tester.ft_ssl_path} {tester.algorithm} --checkpoint {tmp_path / 'checkpoint'} a b")
+        assert exit_code != 0, "--checkpoint with two files should fail"
+
+
+class TestCache:
+    """Tests for the persistent digest cache (--cache)."""
+
+    def write_files(self, tmp_path, count: int):
+        directory = tmp_path / "files"
+        directory.mkdir()
+        paths = []
+        for i in range(count):
+            path = directory / f"f{i}"
+            path.write_bytes(os.urandom(i % 300))
+            paths.append(path)
+        return paths
+
+    def run(self, tester: FtSslTester, options, paths) -> str:
+        # Too many paths for a shell command line
+        command = [tester.ft_ssl_path, tester.algorithm] + options + list(map(str, paths))
+        return subprocess.run(command, stdin=subprocess.DEVNULL, capture_output=True, text=True, timeout=20).stdout.strip()
+
+    def expected_output(self, tester: FtSslTester, paths) -> str:
+        return "\n".join(f"{hashlib.new(tester.algorithm, path.read_bytes()).hexdigest()} *{path}" for path in paths)
+
+    def test_cache_hits_and_refresh(self, tester: FtSslTester, tmp_path):
+        """Test that cached digests are reused, and refreshed when a file changes."""
+        paths = self.write_files(tmp_path, 5000)
+        cache_path = tmp_path / "cache"
+        options = ["-r", "--cache", str(cache_path)]
+        assert self.run(tester, options, paths) == self.expected_output(tester, paths), "First run mismatch"
+        assert self.run(tester, options, paths) == self.expected_output(tester, paths), "Cached run mismatch"
+        paths[7].write_bytes(b"changed")
+        assert self.run(tester, options, paths) == self.expected_output(tester, paths), "Stale entry was not refreshed"
+
+        # Entries are looked up, not recomputed: a forged digest shows up in the output
+        data = bytearray(cache_path.read_bytes())
+        capacity, count = struct.unpack_from("<QQ", data, 16)
+        assert count == len(paths), "Unexpected number of entries"
+        entry_size = struct.unpack_from("<I", data, 8)[0]
+        assert entry_size % 64 == 0, "Entries straddle cache lines"
+        for i in range(capacity):
+            if struct.unpack_from("<I", data, 64 + entry_size * i + 4)[0]:
+                data[64 + entry_size * i + 48:64 + entry_size * i + 48 + 64] = bytes(64)
+        cache_path.write_bytes(bytes(data))
+        output = tester.run_command(f"{tester.ft_ssl_path} {tester.algorithm} -q --cache {cache_path} {paths[0]}")
+        assert output == "0" * len(hashlib.new(tester.algorithm).hexdigest()), "The cache was not used"
+
+    def test_cache_concurrent_processes(self, tester: FtSslTester, tmp_path):
+        """Test that processes filling the same cache at once all print correct digests."""
+        paths = self.write_files(tmp_path, 3000)
+        cache_path = tmp_path / "cache"
+        command = [tester.ft_ssl_path, tester.algorithm, "-r", "-j", "4", "--cache", str(cache_path)] + list(map(str, paths))
+        processes = [subprocess.Popen(command, stdin=subprocess.DEVNULL, stdout=subprocess.PIPE, text=True) for _ in range(6)]
+        for process in processes:
+            output, _ = process.communicate(timeout=20)
+            assert output.strip() == self.expected_output(tester, paths), "Concurrent run mismatch"
+
+    def test_cache_rejects_foreign_file(self, tester: FtSslTester, tmp_path):
+        """Test that a file which is not a cache is left alone."""
+        cache_path = tmp_path / "cache"
+        cache_path.write_text("not a cache")
+        exit_code, _, _ = tester.run_with_timeout(f"{tester.ft_ssl_path} {tester.algorithm} --cache {cache_path} {cache_path}")
+        assert exit_code != 0, "A foreign file should be rejected"
+        assert cache_path.read_text() == "not a cache", "The foreign file was modified"
+
+
+class TestCheck:
+    """Tests for verifying manifests (-c)."""
+
+    def test_check_both_formats(self, tester: FtSslTester, test_files, tmp_path):
+        """Test that manifests written by ft_ssl, with and without -r, verify."""
+        files = " ".join(test_files)
+        for options in ["", "-r"]:
+            manifest_path = tmp_path / f"manifest{options}"
+            manifest_path.write_text(tester.run_command(f"{tester.ft_ssl_path} {tester.algorithm} {options} {files}") + "\n")
+            exit_code, output, _ = tester.run_with_timeout(f"{tester.ft_ssl_path} {tester.algorithm} -c {manifest_path}")
+            assert exit_code == 0, f"Manifest written with '{options}' does not verify"
+            assert output.strip().split("\n") == [f"{file_path}: OK" for file_path in test_files], "Unexpected results"
+
+    def test_check_failures_in_order(self, tester: FtSslTester, test_files, tmp_path):
+        """Test that mismatches, unreadable files and malformed lines are reported in order, for any -j."""
+        digest_size = len(hashlib.new(tester.algorithm).hexdigest())
+        lines = [tester.run_command(f"{tester.ft_ssl_path} {tester.algorithm} -r {file_path}") for file_path in test_files]
+        lines[1] = "0" * digest_size + lines[1][digest_size:]
+        lines.insert(3, "not a digest line")
+        lines.insert(5, "0" * digest_size + " *missing_file")
+        manifest_path = tmp_path / "manifest"
+        manifest_path.write_text("\n".join(lines) + "\n")
+
+        expected = [f"{file_path}: OK" for file_path in test_files]
+        expected[1] = f"{test_files[1]}: FAILED"
+        expected.insert(4, "missing_file: FAILED open or read")
+        for jobs in [1, 3, 8]:
+            exit_code, output, _ = tester.run_with_timeout(f"{tester.ft_ssl_path} {tester.algorithm} -c -j {jobs} {manifest_path}")
+            assert exit_code != 0, "Failures should set the exit status"
+            assert output.strip().split("\n") == expected, f"Unexpected results with -j {jobs}"
+
+    def test_check_quiet_and_stdin(self, tester: FtSslTester, test_files):
+        """Test that -q only prints failures, and that the manifest can come from stdin."""
+        files = " ".join(test_files)
+        exit_code, output, _ = tester.run_with_timeout(f"{tester.ft_ssl_path} {tester.algorithm} -r {files} | {tester.ft_ssl_path} {tester.algorithm} -c -q")
+        assert exit_code == 0 and output == "", "Quiet check of a valid manifest should print nothing"
+
+    def test_check_without_digest_lines(self, tester: FtSslTester, tmp_path):
+        """Test that a manifest without any digest line fails."""
+        manifest_path = tmp_path / "manifest"
+        manifest_path.write_text("hello\n")
+        exit_code, _, _ = tester.run_with_timeout(f"{tester.ft_ssl_path} {tester.algorithm} -c {manifest_path}")
+        assert exit_code != 0, "An empty manifest should fail"
+
+    def test_check_rejects_strings_and_stdin(self, tester: FtSslTester, test_files, tmp_path):
+        """Test that -s and -p are refused with -c instead of being ignored."""
+        manifest_path = tmp_path / "manifest"
+        manifest_path.write_text(tester.run_command(f"{tester.ft_ssl_path} {tester.algorithm} {test_files[0]}") + "\n")
+        for options in ["-s abc", "-p"]:
+            exit_code, output, _ = tester.run_with_timeout(f"{tester.ft_ssl_path} {tester.algorithm} -c {options} {manifest_path} < /dev/null")
+            assert exit_code != 0 and output == "", f"-c with {options} should be refused"
+
+
+class TestRecursive:
+    """Tests for hashing directory trees (-R)."""
+
+    @pytest.fixture
+    def tree(self, tmp_path):
+        """A small tree with nested directories, symlinks and a symlink loop."""
+        root = tmp_path / "tree"
+        for relative, content in [("a/x", b"1"), ("a/b/y.txt", b"2"), ("c/z.txt", b"3"), ("top", b"4"), ("a.d/k", b"5")]:
+            (root / relative).parent.mkdir(parents=True, exist_ok=True)
+            (root / relative).write_bytes(content)
+        (root / "a" / "linkc").symlink_to("../c")
+        (root / "c" / "loop").symlink_to("..")
+        return root
+
+    def expected(self, tester: FtSslTester, root, relatives) -> str:
+        return "\n".join(f"{hashlib.new(tester.algorithm, (root / r).read_bytes()).hexdigest()} *{root / r}" for r in relatives)
+
+    def test_recursive_sorted(self, tester: FtSslTester, tree):
+        """Test that directory entries are hashed in name order, skipping symlinks, for any -j."""
+        expected = self.expected(tester, tree, ["a/b/y.txt", "a/x", "a.d/k", "c/z.txt", "top"])
+        for jobs in [1, 4]:
+            actual = tester.run_command(f"{tester.ft_ssl_path} {tester.algorithm} -r -R -j {jobs} {tree}")
+            assert actual == expected, f"Unexpected walk with -j {jobs}"
+
+    def test_recursive_follow_symlinks(self, tester: FtSslTester, tree):
+        """Test that symlinks are followed on request, without looping."""
+        expected = self.expected(tester, tree, ["a/b/y.txt", "a/linkc/z.txt", "a/x", "a.d/k", "c/z.txt", "top"])
+        actual = tester.run_command(f"{tester.ft_ssl_path} {tester.algorithm} -r -R --follow-symlinks {tree}")
+        assert actual == expected, "Unexpected walk when following symlinks"
+
+    def test_recursive_globs(self, tester: FtSslTester, tree):
+        """Test the include and exclude globs."""
+        actual = tester.run_command(f"{tester.ft_ssl_path} {tester.algorithm} -r -R --include '*.txt' --exclude b {tree}")
+        assert actual == self.expected(tester, tree, ["c/z.txt"]), "Unexpected walk with globs"
+        actual = tester.run_command(f"{tester.ft_ssl_path} {tester.algorithm} -r -R --exclude '{tree}/a*' {tree}")
+        assert actual == self.expected(tester, tree, ["c/z.txt", "top"]), "Unexpected walk with a path glob"
+
+    def test_recursive_missing_argument(self, tester: FtSslTester, tree):
+        """Test that missing arguments keep their place in the output."""
+        actual = tester.run_command(f"{tester.ft_ssl_path} {tester.algorithm} -r -R missing_dir {tree / 'top'}")
+        expected = f"ft_ssl: {tester.algorithm}: missing_dir: No such file or directory\n" + self.expected(tester, tree, ["top"])
+        assert actual == expected, "Unexpected output for a missing argument"
+
+
+class TestSpeed:
+    """Tests for the speed subcommand."""
+
+    def test_speed_json(self, tester: FtSslTester):
+        """Test that the machine-readable output covers every block size with positive throughputs."""
+        command = [tester.ft_ssl_path, "speed", "--duration", "0.01", "--warmup", "0", "--json", tester.algorithm]
+        report = json.loads(subprocess.run(command, stdin=subprocess.DEVNULL, capture_output=True, text=True, timeout=20).stdout)
+        sizes = [result["block_size"] for result in report["results"]]
+        assert sizes[0] == 16 and sizes[-1] > 16384, "Unexpected block sizes"
+        for result in report["results"]:
+            assert result["algorithm"] == tester.algorithm and result["messages"] > 0 and result["mb_per_s"] > 0
+
+    def test_speed_unknown_algorithm(self, tester: FtSslTester):
+        """Test that unknown algorithms are rejected."""
+        command = [tester.ft_ssl_path, "speed", "--duration", "0.01", "foo"]
+        assert subprocess.run(command, stdin=subprocess.DEVNULL, capture_output=True, timeout=20).returncode != 0
+
+
+class TestStats:
+    """Tests for the --stats report."""
+
+    def test_stats_on_stderr(self, tester: FtSslTester, tmp_path):
+        """Test that the report goes to stderr with the byte and block counts, leaving stdout unchanged."""
+        path = tmp_path / "stats.bin"
+        path.write_bytes(os.urandom(100000))
+        # The padding adds a 0x80 byte and the length (8 bytes with 64-byte blocks, 16 with 128-byte blocks)
+        block_size = hashlib.new(tester.algorithm).block_size
+        blocks = (100000 + 1 + block_size // 8 + block_size - 1) // block_size
+        for options in [[], ["--pipeline"]]:
+            command = [tester.ft_ssl_path, tester.algorithm, "--stats", *options, str(path), str(path)]
+            result = subprocess.run(command, stdin=subprocess.DEVNULL, capture_output=True, text=True, timeout=20)
+            plain = subprocess.run(command[:2] + [str(path), str(path)], stdin=subprocess.DEVNULL, capture_output=True, text=True, timeout=20)
+            assert result.stdout == plain.stdout, "--stats changed the output"
+            lines = result.stderr.splitlines()
+            assert lines[0].startswith(f"ft_ssl: stats: {path}: 100000 bytes, ") and f"{blocks} blocks" in lines[0]
+            assert lines[2].startswith("ft_ssl: stats: total: 2 inputs, 200000 bytes, ") and f"{2 * blocks} blocks" in lines[2]
+
+
+class TestLines:
+    """Tests for hashing every record of the input (--lines and -0)."""
+
+    @pytest.fixture
+    def records(self):
+        """Records around the single-block limit (55 bytes), and a few longer ones."""
+        rng = random.Random(15)
+        sizes = [0, 1, 20, 54, 55, 56, 63, 64, 65, 119, 120, 1000] * 50
+        return [bytes(rng.choice(b"abcdefghij@. ") for _ in range(size)) for size in sizes]
+
+    def test_lines_match_hashlib(self, tester: FtSslTester, records):
+        """Test that every record is hashed on its own, in order, with or without a final delimiter."""
+        expected = "".join(hashlib.new(tester.algorithm, record).hexdigest() + "\n" for record in records)
+        for option, delimiter in [("--lines", b"\n"), ("-0", b"\0")]:
+            for data in [delimiter.join(records), delimiter.join(records) + delimiter]:
+                result = subprocess.run([tester.ft_ssl_path, tester.algorithm, option], input=data, capture_output=True, timeout=20)
+                assert result.stdout.decode() == expected, f"Unexpected digests with {option}"
+
+    def test_lines_files(self, tester: FtSslTester, records, tmp_path):
+        """Test that file arguments are read in order, and missing ones reported."""
+        path = tmp_path / "records.txt"
+        path.write_bytes(b"\n".join(records))
+        command = [tester.ft_ssl_path, tester.algorithm, "--lines", str(path), "missing", str(path)]
+        result = subprocess.run(command, stdin=subprocess.DEVNULL, capture_output=True, text=True, timeout=20)
+        digests = "".join(hashlib.new(tester.algorithm, record).hexdigest() + "\n" for record in records)
+        assert result.stdout == digests + f"ft_ssl: {tester.algorithm}: missing: No such file or directory\n" + digests
+        assert result.returncode != 0
+
+
+class TestRaw:
+    """Tests for the bare digest output (--raw)."""
+
+    def test_raw_digests(self, tester: FtSslTester, test_files):
+        """Test that every input prints its digest bytes only, in order, in file and lines modes."""
+        command = [tester.ft_ssl_path, tester.algorithm, "--raw", "-s", "abc", *test_files[:3]]
+        result = subprocess.run(command, stdin=subprocess.DEVNULL, capture_output=True, timeout=20)
+        expected = hashlib.new(tester.algorithm, b"abc").digest()
+        expected += b"".join(hashlib.new(tester.algorithm, open(path, "rb").read()).digest() for path in test_files[:3])
+        assert result.stdout == expected
+        result = subprocess.run([tester.ft_ssl_path, tester.algorithm, "--raw", "--lines", "missing"], input=b"", capture_output=True, timeout=20)
+        assert result.stdout == b"" and b"missing" in result.stderr, "Errors must stay off the raw output"
+        result = subprocess.run([tester.ft_ssl_path, tester.algorithm, "--raw", "--lines"], input=b"a\nbc", capture_output=True, timeout=20)
+        assert result.stdout == hashlib.new(tester.algorithm, b"a").digest() + hashlib.new(tester.algorithm, b"bc").digest()
+
+
+class TestServe:
+    """Tests for the hashing daemon (serve) and its client."""
+
+    @pytest.fixture
+    def server(self, tester: FtSslTester, tmp_path):
+        """Start a server on a socket of the temporary directory, and stop it afterward."""
+        path = tmp_path / "ft_ssl.sock"
+        process = subprocess.Popen([tester.ft_ssl_path, "serve", "--socket", str(path), "-j", "2"])
+        for _ in range(200):
+            if path.exists():
+                break
+            time.sleep(0.01)
+        yield path
+        process.send_signal(signal.SIGTERM)
+        assert process.wait(timeout=5) == 0
+        assert not path.exists(), "The socket was not removed"
+
+    def test_client_files_and_string(self, tester: FtSslTester, test_files, server):
+        """Test that the client prints the lines of ft_ssl itself (default, -r and -q), in order, with the errors on stderr."""
+        for options in [[], ["-r"], ["-q"]]:
+            command = [tester.ft_ssl_path, "client", "--socket", str(server), tester.algorithm, *options, "-s", "abc", *test_files, "missing"]
+            result = subprocess.run(command, stdin=subprocess.DEVNULL, capture_output=True, text=True, timeout=20)
+            local = subprocess.run([tester.ft_ssl_path, tester.algorithm, *options, "-s", "abc", *test_files], stdin=subprocess.DEVNULL, capture_output=True, text=True, timeout=20)
+            assert result.stdout == local.stdout, f"client {options}"
+            assert result.stderr == f"ft_ssl: {tester.algorithm}: missing: No such file or directory\n"
+            assert result.returncode != 0
+        for options in [[], ["-r"], ["-q"]]:
+            command = [tester.ft_ssl_path, "client", "--socket", str(server), tester.algorithm, *options]
+            result = subprocess.run(command, input="abc", capture_output=True, text=True, timeout=20)
+            local = subprocess.run([tester.ft_ssl_path, tester.algorithm, *options], input="abc", capture_output=True, text=True, timeout=20)
+            assert result.stdout == local.stdout, f"client {options} from stdin"
+
+    def test_pipelined_requests(self, tester: FtSslTester, server):
+        """Test that pipelined requests, split anywhere, are answered in order on each connection."""
+        payloads = [os.urandom(size) for size in [0, 3, 64, 1000, 100000]]
+        stream = b"".join(f"{tester.algorithm} data {len(payload)}\n".encode() + payload for payload in payloads)
+        stream += b"nope data 1\nx" + f"{tester.algorithm} file /nonexistent\n".encode() + b"bogus\n"
+        expected = "".join(hashlib.new(tester.algorithm, payload).hexdigest() + "\n" for payload in payloads)
+        expected += "error: unknown algorithm\nerror: No such file or directory\nerror: malformed request\n"
+        clients = [socket.socket(socket.AF_UNIX) for _ in range(4)]
+        for client in clients:
+            client.connect(str(server))
+        for i in range(0, len(stream), 4096):
+            for client in clients:
+                client.sendall(stream[i:i + 4096])
+        for client in clients:
+            answers = b""
+            while not answers.endswith(b"malformed request\n"):
+                data = client.recv(65536)
+                assert data, "Connection closed early"
+                answers += data
+            assert answers.decode() == expected
+            client.close()
+
+
+class TestSha512Family:
+    """Tests for the 64-bit-word algorithms (128-byte blocks, 128-bit lengths)."""
+
+    ALGORITHMS = {"sha384": "sha384", "sha512": "sha512", "sha512-256": "sha512_256"}
+
+    def test_digests_match_hashlib(self, tester: FtSslTester, tmp_path):
+        """Test sizes around the 128-byte block and the 112-byte padding limit, from files, stdin, strings and lines."""
+        for name, hashlib_name in self.ALGORITHMS.items():
+            for size in [0, 1, 111, 112, 113, 127, 128, 129, 239, 240, 256, 100000]:
+                data = os.urandom(size)
+                path = tmp_path / f"data{size}"
+                path.write_bytes(data)
+                expected = hashlib.new(hashlib_name, data).hexdigest()
+                result = subprocess.run([tester.ft_ssl_path, name, "-r", str(path)], capture_output=True, text=True, timeout=20)
+                assert result.stdout == f"{expected} *{path}\n"
+                result = subprocess.run([tester.ft_ssl_path, name, "-q"], input=data, capture_output=True, timeout=20)
+                assert result.stdout.decode() == expected + "\n"
+            result = subprocess.run([tester.ft_ssl_path, name, "-s", "abc"], input="", capture_output=True, text=True, timeout=20)
+            assert result.stdout.splitlines()[-1] == f'{name.upper()}("abc")= {hashlib.new(hashlib_name, b"abc").hexdigest()}'
+            result = subprocess.run([tester.ft_ssl_path, name, "--lines"], input=b"a\n" + b"x" * 300, capture_output=True, timeout=20)
+            assert result.stdout.decode().split() == [hashlib.new(hashlib_name, record).hexdigest() for record in [b"a", b"x" * 300]]
+
+    def test_resume_sha384(self, tester: FtSslTester, tmp_path):
+        """Test that a truncated digest still saves its whole midstate."""
+        path = tmp_path / "log.bin"
+        path.write_bytes(os.urandom(10000))
+        checkpoint = tmp_path / "log.ckpt"
+        subprocess.run([tester.ft_ssl_path, "sha384", "--checkpoint", str(checkpoint), str(path)], capture_output=True, timeout=20)
+        with open(path, "ab") as file:
+            file.write(os.urandom(333))
+        result = subprocess.run([tester.ft_ssl_path, "sha384", "-q", "--resume", str(checkpoint), str(path)], capture_output=True, text=True, timeout=20)
+        assert result.stdout == hashlib.sha384(path.read_bytes()).hexdigest() + "\n"
+
+
+class TestBlake3:
+    """Tests for BLAKE3 (a chunk tree instead of a padded chain of blocks)."""
+
+    # Official test vectors: the first bytes of the output for an input of `length` bytes i % 251
+    VECTORS = {
+        0: "af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262",
+        1: "2d3adedff11b61f14c886e35afa036736dcd87a74d27b5c1510225d0f592e213",
+        1023: "10108970eeda3eb932baac1428c7a2163b0e924c9a9e25b35bba72b28f70bd11",
+        1024: "42214739f095a406f3fc83deb889744ac00df831c10daa55189b5d121c855af7",
+        1025: "d00278ae47eb27b34faecf67b4fe263f82d5412916c1ffd97c8cb7fb814b8444",
+        2048: "e776b6028c7cd22a4d0ba182a8bf62205d2ef576467e838ed6f2529b85fba24a",
+        2049: "5f4d72f40d7a5f82b15ca2b2e44b1de3c2ef86c426c95c1af0b6879522563030",
+        3072: "b98cb0ff3623be03326b373de6b9095218513e64f1ee2edd2525c7ad1e5cffd2",
+        3073: "7124b49501012f81cc7f11ca069ec9226cecb8a2c850cfe644e327d22d3e1cd3",
+        8193: "bab6c09cb8ce8cf459261398d2e7aef35700bf488116ceb94a36d0f5f1b7bc3b",
+        16384: "f875d6646de28985646f34ee13be9a576fd515f76b5b0a26bb324735041ddde4",
+        31744: "62b6960e1a44bcc1eb1a611a8d6235b6b4b78f32e7abc4fb4c6cdcce94895c47",
+        102400: "bc3e3d41a1146b069abffad3c0d44860cf664390afce4d9661f7902e7943e085",
+    }
+
+    @staticmethod
+    def vector_input(length: int) -> bytes:
+        return bytes(i % 251 for i in range(length))
+
+    def test_vectors(self, tester: FtSslTester, tmp_path):
+        """Test the official vectors from files (mapped in one piece) and from stdin (streamed in small reads)."""
+        for length, expected in self.VECTORS.items():
+            data = self.vector_input(length)
+            path = tmp_path / f"vector{length}"
+            path.write_bytes(data)
+            result = subprocess.run([tester.ft_ssl_path, "blake3", "-r", str(path)], capture_output=True, text=True, timeout=20)
+            assert result.stdout == f"{expected} *{path}\n"
+            result = subprocess.run([tester.ft_ssl_path, "blake3", "-q"], input=data, capture_output=True, timeout=20)
+            assert result.stdout.decode() == expected + "\n"
+
+    def test_vectors_one_lane(self, tester: FtSslTester, tmp_path):
+        """Test the portable one-lane path (CPUs without SSE4.1) on 2 and 3 chunks, where the left half is a single chunk."""
+        for length in [1025, 2048, 2049, 3072, 3073, 8193]:
+            data = self.vector_input(length)
+            path = tmp_path / f"vector{length}"
+            path.write_bytes(data)
+            result = subprocess.run([tester.ft_ssl_path, "blake3", "--engine", "reference", "-q", str(path)], capture_output=True, text=True, timeout=20)
+            assert result.stdout == self.VECTORS[length] + "\n", f"{length} bytes from a file"
+            result = subprocess.run([tester.ft_ssl_path, "blake3", "--engine", "reference", "-q"], input=data, capture_output=True, timeout=20)
+            assert result.stdout.decode() == self.VECTORS[length] + "\n", f"{length} bytes from stdin"
+
+    def test_output_options(self, tester: FtSslTester):
+        """Test -s, -p and -q with the usual formats."""
+        abc = "6437b3ac38465133ffb63b75273a8db548c558465d79db03fd359c6cd5bd9d85"
+        result = subprocess.run([tester.ft_ssl_path, "blake3", "-s", "abc"], input="", capture_output=True, text=True, timeout=20)
+        assert result.stdout.splitlines()[-1] == f'BLAKE3("abc")= {abc}'
+        result = subprocess.run([tester.ft_ssl_path, "blake3", "-p", "-q"], input="abc", capture_output=True, text=True, timeout=20)
+        assert result.stdout == f"abc{abc}\n"
+
+    def test_large_file_on_threads(self, tester: FtSslTester, tmp_path):
+        """Test that splitting the chunk tree between threads gives the same digest, with a partial last chunk."""
+        path = tmp_path / "large.bin"
+        path.write_bytes(self.vector_input(3 * 1024 * 1024 + 1))
+        expected = "fd984eaa20053d346cc7c79a175338f91556e68b871d877b23568a4587d9875b"
+        for workers in ["1", "3", "8"]:
+            result = subprocess.run([tester.ft_ssl_path, "blake3", "-q", "-j", workers, str(path)], capture_output=True, text=True, timeout=20)
+            assert result.stdout == expected + "\n"
+        result = subprocess.run([tester.ft_ssl_path, "blake3", "-q", "--pipeline", "--buffer-size", "100000", str(path)], capture_output=True, text=True, timeout=20)
+        assert result.stdout == expected + "\n"
+
+    def test_checkpoint_rejected(self, tester: FtSslTester, tmp_path):
+        """Test that --checkpoint is refused, BLAKE3 having no linear midstate."""
+        path = tmp_path / "data"
+        path.write_bytes(b"data")
+        result = subprocess.run([tester.ft_ssl_path, "blake3", "--checkpoint", str(tmp_path / "ckpt"), str(path)], capture_output=True, text=True, timeout=20)
+        assert result.returncode != 0
+        assert "midstate" in result.stderr
+
+
+class TestAlgorithmList:
+    """Tests for comma-separated lists of algorithms hashed in one pass."""
+
+    def test_one_line_per_algorithm(self, tester: FtSslTester, tmp_path):
+        """Test that every input gets a line per algorithm, in the order of the list, errors once."""
+        paths = []
+        for i, size in enumerate([0, 1000, 300000]):
+            paths.append(tmp_path / f"file{i}")
+            paths[-1].write_bytes(os.urandom(size))
+        missing = tmp_path / "missing"
+        result = subprocess.run([tester.ft_ssl_path, "sha256,md5", *map(str, paths), str(missing)], capture_output=True, text=True, timeout=20)
+        expected = ""
+        for path in paths:
+            expected += f"SHA256({path})= {hashlib.sha256(path.read_bytes()).hexdigest()}\n"
+            expected += f"MD5({path})= {hashlib.md5(path.read_bytes()).hexdigest()}\n"
+        expected += f"ft_ssl: sha256: {missing}: No such file or directory\n"
+        assert result.stdout == expected
+
+    def test_threads_and_inputs(self, tester: FtSslTester, tmp_path):
+        """Test a single large file (one thread per algorithm), stdin, strings and directories."""
+        data = os.urandom(3 * 1024 * 1024 + 5)
+        path = tmp_path / "large.bin"
+        path.write_bytes(data)
+        expected = [hashlib.md5(data).hexdigest(), hashlib.sha512(data).hexdigest()]
+        for options in [["-j", "1"], ["-j", "4"], ["-j", "4", "--pipeline", "--buffer-size", "512K"]]:
+            result = subprocess.run([tester.ft_ssl_path, "md5,sha512", "-q", *options, str(path)], capture_output=True, text=True, timeout=20)
+            assert result.stdout.split() == expected
+        result = subprocess.run([tester.ft_ssl_path, "md5,sha512", "-q"], input=data, capture_output=True, timeout=20)
+        assert result.stdout.decode().split() == expected
+        result = subprocess.run([tester.ft_ssl_path, "md5,sha256", "-r", "-s", "abc", str(path)], input="", capture_output=True, text=True, timeout=20)
+        assert result.stdout.splitlines()[-4:] == [
+            f'{hashlib.md5(b"abc").hexdigest()} "abc"', f'{hashlib.sha256(b"abc").hexdigest()} "abc"',
+            f"{expected[0]} *{path}", f"{hashlib.sha256(data).hexdigest()} *{path}"]
+        result = subprocess.run([tester.ft_ssl_path, "md5,sha256", "-R", "-q", "-j", "2", str(tmp_path)], capture_output=True, text=True, timeout=20)
+        assert result.stdout.split() == [expected[0], hashlib.sha256(data).hexdigest()]
+
+    def test_rejected_combinations(self, tester: FtSslTester, tmp_path):
+        """Test that unknown names and modes with a single digest per input are refused."""
+        path = tmp_path / "data"
+        path.write_bytes(b"data")
+        for args in [["md5,nope"], ["md5,md5"], ["md5,sha256,md5"], ["md5,sha256", "-p"], ["md5,sha256", "--tree"], ["md5,sha256", "-c"], ["md5,sha256", "--lines"]]:
+            result = subprocess.run([tester.ft_ssl_path, *args, str(path)], input="", capture_output=True, text=True, timeout=20)
+            assert result.returncode != 0
+            assert result.stdout == ""
+
+
+class TestEngine:
+    """Tests for the kernel registry (--engine)."""
+
+    ENGINES = {
+        "md5": ["reference", "unrolled", "sse2", "avx2"],
+        "sha256": ["reference", "unrolled", "sse2", "avx2", "shani"],
+        "sha512": ["reference", "unrolled"],
+        "blake3": ["reference", "sse41", "avx2"],
+    }
+
+    def test_every_engine_matches(self, tester: FtSslTester, tmp_path):
+        """Test that every engine the CPU runs gives the same digests, on a file and on stdin."""
+        data = os.urandom(100000 + 7)
+        path = tmp_path / "data"
+        path.write_bytes(data)
+        for algorithm, engines in self.ENGINES.items():
+            expected = hashlib.new(algorithm, data).hexdigest() if algorithm != "blake3" else None
+            digests = set()
+            for engine in engines:
+                result = subprocess.run([tester.ft_ssl_path, algorithm, "--engine", engine, "-q", str(path)], capture_output=True, text=True, timeout=20)
+                if "does not have" in result.stderr:
+                    continue
+                assert result.returncode == 0, result.stderr
+                digests.add(result.stdout)
+                result = subprocess.run([tester.ft_ssl_path, algorithm, "--engine", engine, "-q"], input=data, capture_output=True, timeout=20)
+                digests.add(result.stdout.decode())
+            assert len(digests) == 1
+            if expected:
+                assert digests == {expected + "\n"}
+
+    def test_multi_buffer_files_match(self, tester: FtSslTester, tmp_path):
+        """Test that many files hashed side by side in forced SIMD lanes match the scalar kernels, missing ones included."""
+        sizes = [0, 1, 55, 56, 63, 64, 65, 1000, 4095, 4096, 4097, 65536, 100007, 300000] * 3
+        paths = []
+        for i, size in enumerate(sizes):
+            (tmp_path / f"f{i}").write_bytes(os.urandom(size))
+            paths.append(str(tmp_path / f"f{i}"))
+        paths.insert(5, str(tmp_path / "missing"))
+        expected = subprocess.run([tester.ft_ssl_path, "sha256", "--engine", "reference", "-r", *paths], capture_output=True, text=True, timeout=20)
+        assert expected.stdout.split()[0] == hashlib.sha256(b"").hexdigest()
+        for engine in ["sse2", "avx2"]:
+            for jobs in ["1", "2"]:
+                result = subprocess.run([tester.ft_ssl_path, "sha256", "--engine", engine, "-r", "-j", jobs, *paths], capture_output=True, text=True, timeout=20)
+                if "does not have" in result.stderr:
+                    continue
+                assert (result.stdout, result.stderr) == (expected.stdout, expected.stderr), f"--engine {engine} -j {jobs}"
+
+    def test_every_engine_matches_lines(self, tester: FtSslTester):
+        """Test that the records of --lines, hashed side by side in SIMD lanes or not, have the same digests with every engine."""
+        rng = random.Random(21)
+        records = [bytes(rng.choice(b"abcdefghij") for _ in range(rng.randrange(80))) for _ in range(500)]
+        for algorithm in ["md5", "sha256"]:
+            expected = "".join(hashlib.new(algorithm, record).hexdigest() + "\n" for record in records)
+            for engine in self.ENGINES[algorithm]:
+                result = subprocess.run([tester.ft_ssl_path, algorithm, "--engine", engine, "--lines"], input=b"\n".join(records), capture_output=True, timeout=20)
+                if b"does not have" in result.stderr:
+                    continue
+                assert result.stdout.decode() == expected, f"{algorithm} --engine {engine}"
+
+    def test_engine_applies_to_a_list(self, tester: FtSslTester):
+        """Test that a name shared by every algorithm of a list selects them all."""
+        result = subprocess.run([tester.ft_ssl_path, "md5,sha256,sha384", "--engine", "reference", "-q", "-s", "abc"], input="", capture_output=True, text=True, timeout=20)
+        assert result.stdout.split()[-3:] == [hashlib.md5(b"abc").hexdigest(), hashlib.sha256(b"abc").hexdigest(), hashlib.sha384(b"abc").hexdigest()]
+
+    def test_unknown_engine(self, tester: FtSslTester):
+        """Test that an unknown name fails and lists the engines of the algorithm."""
+        result = subprocess.run([tester.ft_ssl_path, "md5", "--engine", "nope", "-s", "abc"], input="", capture_output=True, text=True, timeout=20)
+        assert result.returncode != 0
+        assert result.stdout == ""
+        assert "reference unrolled" in result.stderr
+        result = subprocess.run([tester.ft_ssl_path, "speed", "--engine", "shani", "md5"], capture_output=True, text=True, timeout=20)
+        assert result.returncode != 0
+
+
+class TestEcho:
+    """Tests for -p between two pipes (echoed with tee instead of being written back)."""
+
+    def test_large_echo_is_identical(self, tester: FtSslTester):
+        """Test the framing and the echoed bytes of a stream larger than a pipe, with and without -q."""
+        data = os.urandom(3 * 1024 * 1024 + 11)
+        digest = hashlib.sha256(data).hexdigest()
+        result = subprocess.run([tester.ft_ssl_path, "sha256", "-p"], input=data, capture_output=True, timeout=20)
+        assert result.stdout == b'("' + data + b'")= ' + digest.encode() + b"\n"
+        result = subprocess.run([tester.ft_ssl_path, "sha256", "-p", "-q"], input=data, capture_output=True, timeout=20)
+        assert result.stdout == data + digest.encode() + b"\n"
+
+    def test_slow_writer(self, tester: FtSslTester):
+        """Test a writer that sends small pieces with pauses, so that every segment is short."""
+        pieces = [os.urandom(random.randint(1, 5000)) for _ in range(20)]
+        process = subprocess.Popen([tester.ft_ssl_path, "md5", "-p", "-s", "abc"], stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+        for piece in pieces:
+            process.stdin.write(piece)
+            process.stdin.flush()
+            time.sleep(0.01)
+        process.stdin.close()
+        output = process.stdout.read()
+        process.wait(timeout=20)
+        data = b"".join(pieces)
+        assert output.startswith(b'("' + data + b'")= ' + hashlib.md5(data).hexdigest().encode() + b"\n")
+
+
+class TestFindDupes:
+    """Tests for --find-dupes (size, then prefix, then full digest)."""
+
+    @pytest.fixture
+    def pool(self, tmp_path):
+        """A tree with copies, a file differing in its last byte only, a hard link, and files of unique sizes."""
+        big = os.urandom(100000)
+        (tmp_path / "a").mkdir()
+        (tmp_path / "b").mkdir()
+        (tmp_path / "a" / "big").write_bytes(big)
+        (tmp_path / "b" / "big.copy").write_bytes(big)
+        (tmp_path / "b" / "big.last").write_bytes(big[:-1] + bytes([big[-1] ^ 1]))
+        os.link(tmp_path / "a" / "big", tmp_path / "b" / "big.link")
+        (tmp_path / "a" / "small").write_bytes(b"same\n")
+        (tmp_path / "b" / "small.copy").write_bytes(b"same\n")
+        (tmp_path / "b" / "small.other").write_bytes(b"diff\n")
+        (tmp_path / "b" / "unique").write_bytes(os.urandom(7777))
+        return tmp_path, big
+
+    def test_groups_and_summary(self, tester: FtSslTester, pool):
+        """Test the groups (largest first, walk order inside), and that the unique sizes are never read."""
+        root, big = pool
+        for jobs in ["1", "4"]:
+            result = subprocess.run([tester.ft_ssl_path, "sha256", "--find-dupes", "-r", "-j", jobs, str(root)], capture_output=True, text=True, timeout=20)
+            assert result.returncode == 0
+            assert result.stdout == (f"{hashlib.sha256(big).hexdigest()} *{root}/a/big\n"
+                                     f"{hashlib.sha256(big).hexdigest()} *{root}/b/big.copy\n"
+                                     "\n"
+                                     f"{hashlib.sha256(b'same' + bytes([10])).hexdigest()} *{root}/a/small\n"
+                                     f"{hashlib.sha256(b'same' + bytes([10])).hexdigest()} *{root}/b/small.copy\n")
+            # The hard link is the same file, the unique size is skipped, the three large files are read in full
+            assert "7 files, 2 groups of duplicates (2 redundant files, 100005 bytes)" in result.stderr
+            assert f"read {3 * 100000 + 3 * 5} of {3 * 100000 + 3 * 5 + 7777} bytes (7777 skipped)" in result.stderr
+
+    def test_summary_adds_up(self, tester: FtSslTester, pool):
+        """Test that every algorithm (resumed after the prefix or not) reads each byte once, the others being skipped."""
+        root, big = pool
+        (root / "a" / "big.prefix").write_bytes(bytes([big[0] ^ 1]) + big[1:])
+        for algorithm in ["md5", "sha256", "sha512", "blake3"]:
+            result = subprocess.run([tester.ft_ssl_path, algorithm, "--find-dupes", "-q", str(root)], capture_output=True, text=True, timeout=20)
+            assert result.returncode == 0
+            if algorithm != "blake3":
+                assert result.stdout.split()[0] == hashlib.new(algorithm, big).hexdigest()
+            total = 4 * 100000 + 3 * 5 + 7777
+            assert f"read {3 * 100000 + 4096 + 3 * 5} of {total} bytes ({100000 - 4096 + 7777} skipped)" in result.stderr
+
+    def test_errors_and_rejected_combinations(self, tester: FtSslTester, pool):
+        """Test that missing files fail the run without hiding the groups, and that other modes are refused."""
+        root, _ = pool
+        result = subprocess.run([tester.ft_ssl_path, "md5", "--find-dupes", "-q", str(root), str(root / "missing")], capture_output=True, text=True, timeout=20)
+        assert result.returncode != 0
+        assert len(result.stdout.split()) == 4
+        assert "missing: No such file or directory" in result.stderr
+        for args in [["md5"], ["md5", "-c", str(root)], ["md5,sha256", str(root)], ["md5", "--tree", str(root)], ["md5", "-s", "abc", str(root)]]:
+            result = subprocess.run([tester.ft_ssl_path, args[0], "--find-dupes", *args[1:]], input="", capture_output=True, text=True, timeout=20)
+            assert result.returncode != 0
+            assert result.stdout == ""
+
+
+class TestIoUring:
+    """Tests for --io-uring (the same output as the synchronous reads, or a fallback to them)."""
+
+    @pytest.fixture
+    def files(self, tmp_path):
+        """Files around the 128 KiB buffer size, empty ones, a directory and a missing file."""
+        names = []
+        for i, size in enumerate([0, 1, 64, 4096, 131071, 131072, 131073, 300000, 0, 999]):
+            (tmp_path / f"f{i}").write_bytes(os.urandom(size))
+            names.append(str(tmp_path / f"f{i}"))
+        (tmp_path / "dir").mkdir()
+        (tmp_path / "dir" / "inner").write_bytes(b"inner\n")
+        # procfs files report a size of 0, and are only read to their end
+        return tmp_path, names + [str(tmp_path / "dir"), str(tmp_path / "missing"), "/proc/version", "/proc/self/mounts"]
+
+    def test_same_output(self, tester: FtSslTester, files):
+        """Test that every queue depth and job count prints what the synchronous reads print, in argument order."""
+        _, names = files
+        for args in [["md5"], ["sha256", "-r"], ["sha512,blake3", "-q"]]:
+            expected = subprocess.run([tester.ft_ssl_path, *args, *names], capture_output=True, text=True, timeout=20)
+            for extra in [[], ["--queue-depth", "1"], ["--queue-depth", "3", "-j", "2"]]:
+                result = subprocess.run([tester.ft_ssl_path, *args, "--io-uring", *extra, *names], capture_output=True, text=True, timeout=20)
+                assert (result.stdout, result.stderr) == (expected.stdout, expected.stderr)
+
+    def test_recursive(self, tester: FtSslTester, files):
+        """Test the walk with the engine on a worker of its own."""
+        root, _ = files
+        expected = subprocess.run([tester.ft_ssl_path, "sha256", "-R", str(root)], capture_output=True, text=True, timeout=20)
+        for jobs in ["1", "3"]:
+            result = subprocess.run([tester.ft_ssl_path, "sha256", "-R", "--io-uring", "--queue-depth", "2", "-j", jobs, str(root)],
+                                    capture_output=True, text=True, timeout=20)
+            assert result.stdout == expected.stdout
+
+    def test_rejected_options(self, tester: FtSslTester, files):
+        """Test the invalid queue depths and the modes the engine does not serve."""
+        root, names = files
+        for args in [["--queue-depth", "0"], ["--queue-depth", "x"], ["--queue-depth", "5000"], ["--tree"], ["--stats"],
+                     ["--cache", str(root / "cache")], ["--find-dupes"]]:
+            result = subprocess.run([tester.ft_ssl_path, "md5", "--io-uring", *args, names[1]], capture_output=True, text=True, timeout=20)
+            assert result.returncode != 0
+            assert result.stdout == ""
+
+
+class TestHmac:
+    """Tests for --hmac and --hmac-keyfile against Python's hmac."""
+
+    def test_matches_hmac(self, tester: FtSslTester, tmp_path):
+        """Test files, strings and records, with keys shorter, as long as and longer than a block."""
+        messages = [b"", b"abc", os.urandom(1000), os.urandom(200000)]
+        names = []
+        for i, message in enumerate(messages):
+            (tmp_path / f"m{i}").write_bytes(message)
+            names.append(str(tmp_path / f"m{i}"))
+        for name in ["md5", "sha256", "sha384"]:
+            for key in [b"key", bytes(range(64)), os.urandom(300)]:
+                (tmp_path / "key").write_bytes(key)
+                expected = [hmac.new(key, message, name).hexdigest() for message in messages]
+                for extra in [[], ["-j", "2"], ["--io-uring"]]:
+                    result = subprocess.run([tester.ft_ssl_path, name, "-q", "--hmac-keyfile", str(tmp_path / "key"), *extra, *names],
+                                            capture_output=True, text=True, timeout=20)
+                    assert result.stdout.split() == expected
+            result = subprocess.run([tester.ft_ssl_path, name, "--hmac", "key", "-s", "what do ya want for nothing?"], input="",
+                                    capture_output=True, text=True, timeout=20)
+            assert f"HMAC-{name.upper()}(\"what do ya want for nothing?\")= {hmac.new(b'key', b'what do ya want for nothing?', name).hexdigest()}\n" in result.stdout
+            result = subprocess.run([tester.ft_ssl_path, name, "--hmac", "key", "--lines"], input="a\nbb\n" + "c" * 300 + "\n",
+                                    capture_output=True, text=True, timeout=20)
+            assert result.stdout.split() == [hmac.new(b"key", line.encode(), name).hexdigest() for line in ["a", "bb", "c" * 300]]
+
+    def test_check_and_rejected_combinations(self, tester: FtSslTester, tmp_path):
+        """Test that -c verifies the HMAC lines with the same key only, and the modes refused with a key."""
+        (tmp_path / "a").write_bytes(b"signed\n")
+        manifest = subprocess.run([tester.ft_ssl_path, "sha256", "--hmac", "key", str(tmp_path / "a")], capture_output=True, text=True, timeout=20).stdout
+        assert manifest.startswith("HMAC-SHA256(")
+        (tmp_path / "manifest").write_text(manifest)
+        for key, code in [("key", 0), ("other", 1)]:
+            result = subprocess.run([tester.ft_ssl_path, "sha256", "--hmac", key, "-c", str(tmp_path / "manifest")], capture_output=True, text=True, timeout=20)
+            assert result.returncode == code
+        for args in [["blake3"], ["md5,sha256"], ["md5", "--tree"], ["md5", "--find-dupes"], ["md5", "--checkpoint", str(tmp_path / "cp")]]:
+            result = subprocess.run([tester.ft_ssl_path, args[0], "--hmac", "key", *args[1:], str(tmp_path / "a")], capture_output=True, text=True, timeout=20)
+            assert result.returncode != 0
+            assert result.stdout == ""
@@ -1,3 +1,4 @@
+import ctypes
 import os
 import random
 import string
@@ -14,6 +15,33 @@ ALGORITHM_DISPLAY_NAMES = {
 }
 
 
+class FtSslLibrary:
+    """In-process access to the hashing API of libft_ssl.so, without a fork/exec per hash."""
+
+    def __init__(self, path: str = "../libft_ssl.so"):
+        self.lib = ctypes.CDLL(os.path.abspath(path))
+        self.lib.ft_ssl_digest_new.restype = ctypes.c_void_p
+        self.lib.ft_ssl_digest_new.argtypes = [ctypes.c_char_p]
+        self.lib.ft_ssl_digest_update.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_size_t]
+        self.lib.ft_ssl_digest_final.restype = ctypes.c_size_t
+        self.lib.ft_ssl_digest_final.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+        self.lib.ft_ssl_digest_free.argtypes = [ctypes.c_void_p]
+
+    def hexdigest(self, algorithm: str, chunks: List[bytes]) -> str:
+        """Hash the concatenation of the chunks, fed one update at a time."""
+        digest = self.lib.ft_ssl_digest_new(algorithm.encode())
+        if not digest:
+            raise ValueError(f"unknown algorithm: {algorithm}")
+        try:
+            for chunk in chunks:
+                self.lib.ft_ssl_digest_update(digest, chunk, len(chunk))
+            out = ctypes.create_string_buffer(64)
+            size = self.lib.ft_ssl_digest_final(digest, out)
+            return out.raw[:size].hex()
+        finally:
+            self.lib.ft_ssl_digest_free(digest)
+
+
 class FtSslTester:
     """A tester class for ft_ssl combining basic testing and fuzzing capabilities."""
     